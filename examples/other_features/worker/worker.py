@@ -0,0 +1,21 @@
+import json
+import sys
+
+
+def main(args):
+    print(f"Hello, {args[0]}!")
+    return 0
+
+
+if __name__ == "__main__":
+    # Read requests from stdin until Tuw closes it.
+    for line in sys.stdin:
+        args = json.loads(line)["args"]
+        try:
+            code = main(args)
+        except Exception as e:
+            print(e, file=sys.stderr)
+            code = 1
+        sys.stderr.flush()
+        # Tell Tuw that the request is done.
+        print(f"\x1e{code}", flush=True)
@@ -0,0 +1,103 @@
+// Functions to make commands from a sub definition.
+// The GUI and the "run" command share them.
+
+#pragma once
+#include "json.h"
+#include "exec.h"
+#include "string_utils.h"
+#include "noex/vector.hpp"
+
+// Interface to get values of components.
+class ComponentValues {
+ public:
+    virtual ~ComponentValues() noexcept {}
+    // id is an index of "components".
+    // use_quotes is false when the command doesn't use shell.
+    virtual noex::string GetString(int id, bool use_quotes) noexcept = 0;
+    // Returns the value without prefix, suffix, and quotes.
+    virtual noex::string GetRawString(int id) noexcept = 0;
+};
+
+// Makes a command string from "command_splitted" and "command_ids".
+// Paths of resources are quoted. err will be an error of extracting resources.
+noex::string BuildCommand(const tuwjson::Value& sub_definition,
+                          ComponentValues& values, noex::string* err = nullptr) noexcept;
+// Makes command arguments from "command_argv" for "shell": false
+noex::vector<noex::string> BuildCommandArgs(const tuwjson::Value& sub_definition,
+                                            ComponentValues& values,
+                                            noex::string* err = nullptr) noexcept;
+// Makes arguments of each command from "pipeline".
+// Returns false when the sub definition doesn't have "pipeline" or on Windows.
+// (Windows runs the joined command via shell.)
+bool BuildPipeline(const tuwjson::Value& sub_definition,
+                   ComponentValues& values, Pipeline* pipeline,
+                   noex::string* err = nullptr) noexcept;
+// Gets the content for stdin from the component of "stdin".
+// Returns false when the sub definition doesn't have "stdin".
+bool BuildStdin(const tuwjson::Value& sub_definition,
+                ComponentValues& values, StdinContent* input) noexcept;
+
+// Time between SIGTERM and SIGKILL when "kill_grace_ms" is not specified.
+#define DEFAULT_KILL_GRACE_MS 2000
+
+// Gets "nice", "cpu_affinity", "memory_limit_mb", "cpu_limit", "timeout_ms", and "kill_grace_ms".
+// Returns false when the sub definition has none of them.
+bool GetProcessLimits(const tuwjson::Value& sub_definition, ProcessLimits* limits) noexcept;
+
+// Returns true when "codepage" is "utf8".
+bool UseUtf8OnWindows(const tuwjson::Value& sub_definition) noexcept;
+
+// Runs the command with worker, shell, or argv mode,
+// prints its stats, and writes "history" if needed.
+// worker will be allocated when the sub definition uses "worker".
+// Free it with noex::del_ref().
+// log will store full outputs when the sub definition has "output_log".
+// on_progress will be called when the sub definition has "progress_regex".
+// pipeline will be used instead of cmd and args if it's not null.
+// input will be sent to stdin if it's not null.
+// Process limits in the sub definition will be applied to the command.
+ExecuteResult ExecuteSubDefinition(const tuwjson::Value& sub_definition,
+                                   const noex::string& cmd,
+                                   const noex::vector<noex::string>& args,
+                                   const Pipeline* pipeline,
+                                   const StdinContent* input,
+                                   Worker** worker,
+                                   OutputLog* log = nullptr,
+                                   ProgressCallback on_progress = nullptr,
+                                   void* progress_data = nullptr) noexcept;
+
+// Prints stats of the result, and writes "history" if needed.
+void ReportResult(const tuwjson::Value& sub_definition,
+                  const noex::string& cmd, const ExecuteResult& result) noexcept;
+
+// Appends the result to "history" if the sub definition has it.
+void WriteHistory(const tuwjson::Value& sub_definition,
+                  const noex::string& cmd, const ExecuteResult& result) noexcept;
+
+// Join arguments for logging
+noex::string ArgsToString(const noex::vector<noex::string>& args) noexcept;
+
+// Values made from a config JSON without GUI components.
+// Missing values fall back to "default" in the definition, as the GUI does.
+class ConfigValues : public ComponentValues {
+ private:
+    const tuwjson::Value& m_components;
+    const tuwjson::Value& m_config;
+
+ public:
+    ConfigValues(const tuwjson::Value& sub_definition,
+                 const tuwjson::Value& config) noexcept :
+        m_components(sub_definition["components"]), m_config(config) {}
+
+    noex::string GetRawString(int id) noexcept override;
+    noex::string GetString(int id, bool use_quotes) noexcept override;
+
+    // Returns an error message when some values are invalid.
+    noex::string Validate() noexcept;
+};
+
+// Stores a value of "id=value" to the config.
+// It accepts item values or labels for combo boxes, radio buttons, and check arrays.
+// (e.g. "options=item1,item3" for check arrays)
+noex::string SetConfigValue(const tuwjson::Value& sub_definition,
+                            tuwjson::Value& config, const char* id_value) noexcept;
@@ -2,11 +2,10 @@
 #include "json.h"
 #include "ui.h"
 #include "string_utils.h"
+#include "noex/alloc.hpp"
 #include "noex/vector.hpp"
 #include "validator.h"
 
-#define UNUSED(x) (void)(x)
-
 // Base class for GUI components (file picker, combo box, etc.)
 class Component {
  protected:
@@ -23,18 +22,26 @@ class Component {
 
  private:
     bool m_add_quotes;
+    // sizeof the derived class for noex::dealloc()
+    size_t m_alloc_size;
+
+    template <typename CompT>
+    friend Component* NewComp(uiBox* box, const tuwjson::Value& j) noexcept;
 
  public:
     explicit Component(const tuwjson::Value& j) noexcept;
     virtual ~Component() noexcept {}
     virtual noex::string GetRawString() noexcept { return "";}
-    noex::string GetString() noexcept;
+    // use_quotes is false when the command doesn't use shell.
+    noex::string GetString(bool use_quotes = true) noexcept;
     const char* GetID() const noexcept { return m_id; }
 
     virtual void SetConfig(const tuwjson::Value& config) noexcept { UNUSED(config); }
     virtual void GetConfig(tuwjson::Value& config) noexcept { UNUSED(config); }
 
     bool HasString() const noexcept { return m_has_string; }
+    // Returns true when GetRawString() returns a path.
+    virtual bool IsPath() const noexcept { return false; }
     bool IsWide() const noexcept { return m_is_wide; }
 
     bool Validate(bool* redraw_flag) noexcept;
@@ -42,6 +49,8 @@ class Component {
     void PutErrorWidget(uiBox* box) noexcept;
 
     static Component* PutComponent(uiBox* box, const tuwjson::Value& j) noexcept;
+    // Destroys a component that PutComponent() made.
+    static void Delete(Component* comp) noexcept;
 };
 
 class EmptyComponent : public Component {
@@ -89,6 +98,7 @@ class FilePicker : public StringComponentBase {
  public:
     noex::string GetRawString() noexcept override;
     FilePicker(uiBox* box, const tuwjson::Value& j) noexcept;
+    bool IsPath() const noexcept override { return true; }
     void SetConfig(const tuwjson::Value& config) noexcept override;
     void OpenFile() noexcept;
 };
@@ -97,6 +107,7 @@ class DirPicker : public StringComponentBase {
  public:
     noex::string GetRawString() noexcept override;
     DirPicker(uiBox* box, const tuwjson::Value& j) noexcept;
+    bool IsPath() const noexcept override { return true; }
     void SetConfig(const tuwjson::Value& config) noexcept override;
     void OpenFolder() noexcept;
 };
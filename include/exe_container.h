@@ -2,24 +2,77 @@
 #include "json.h"
 #include "json_utils.h"
 #include "string_utils.h"
+#include "noex/vector.hpp"
+
+// File embedded in the executable. ("merge -r name=path")
+struct Resource {
+    noex::string name;
+    // A file to embed. Empty for resources in the executable.
+    noex::string path;
+    // Offset in the executable
+    uint64_t offset;
+    uint64_t size;
+    // XXH64 of the file
+    uint64_t hash;
+};
+
+class FileView;
 
 class ExeContainer {
  private:
     noex::string m_exe_path;
-    uint32_t m_exe_size;
+    // Size of the original exe without resources and json
+    uint64_t m_base_size;
+    // Offset of the json header. It's the exe size for old versions of Tuw.
+    uint64_t m_exe_size;
     tuwjson::Value m_json;
+    bool m_compress;
+    noex::vector<Resource> m_resources;
+    // True when resources are added or removed after reading the exe.
+    bool m_resources_changed;
+    // XXH64 of the original exe. It's recorded in the json header.
+    uint64_t m_base_hash;
+    bool m_has_base_hash;
+
+    noex::string ReadData(const noex::string& exe_path) noexcept;
+    noex::string ReadResourceTable(FileView& file) noexcept;
 
  public:
     ExeContainer(): m_exe_path(""),
+                    m_base_size(0),
                     m_exe_size(0),
-                    m_json() {
+                    m_json(),
+                    m_compress(false),
+                    m_resources(),
+                    m_resources_changed(false),
+                    m_base_hash(0),
+                    m_has_base_hash(false) {
         m_json.SetObject();
     }
 
     // Returns an empty string if succeed. An error message otherwise.
     noex::string Read(const noex::string& exe_path) noexcept;
+    // Copies data that another container read. (to read the exe only once for "merge -b")
+    void CopyFrom(const ExeContainer& other) noexcept;
+    // Updates embedded data in place when exe_path is the file we read.
+    // Otherwise, copies the original exe to a new file.
     noex::string Write(const noex::string& exe_path) noexcept;
 
+    // Returns true when both files have the same exe without embedded data.
+    // It compares sizes and XXH64 of the exe.
+    // Hashes recorded by Write() are used as is. Otherwise, it reads the exe to hash it.
+    bool HasSameExe(ExeContainer& other) noexcept;
+
+    // Hashes the exe without embedded data unless the hash is recorded in the file.
+    // Call this before CopyFrom() to hash the exe only once. ("merge -b")
+    // Returns an empty string if succeed. An error message otherwise.
+    noex::string ComputeBaseHash() noexcept;
+
+    // Compresses JSON with an LZ codec when writing it. ("merge --compress")
+    void SetCompression(bool compress) noexcept {
+        m_compress = compress;
+    }
+
     bool HasJson() noexcept {
         return m_json.IsObject() && !m_json.IsEmptyObject();
     }
@@ -37,4 +90,36 @@ class ExeContainer {
         doc.SetObject();
         SetJson(doc);
     }
+
+    // Adds a file to embed. Resources are stored only with JSON.
+    // Names can use alphanumerics, ".", "-", and "_".
+    noex::string AddResource(const char* name, const noex::string& path) noexcept;
+
+    size_t GetResourceCount() const noexcept {
+        return m_resources.size();
+    }
+
+    const Resource& GetResource(size_t id) const noexcept {
+        return m_resources[id];
+    }
+
+    void ClearResources() noexcept {
+        m_resources_changed = m_resources_changed || !m_resources.empty();
+        m_resources.clear();
+    }
+
+    // Writes an embedded resource to a file.
+    // It maps only the pages of the resource.
+    noex::string ExtractResource(const char* name, const noex::string& path) noexcept;
 };
+
+// Returns true when the name can be used for a resource.
+bool IsValidResourceName(const char* name) noexcept;
+
+// Extracts a resource of the running executable to a temporary directory,
+// and returns the path. ("%__resource:name%")
+// Extracted files are reused, and removed when Tuw exits.
+noex::string GetResourcePath(const char* name, noex::string* err) noexcept;
+
+// Uses resources in another executable. (for testing)
+void SetResourceExePath(const noex::string& exe_path) noexcept;
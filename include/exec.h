@@ -1,19 +1,213 @@
 #pragma once
 #include <cstring>
 #include "string_utils.h"
+#include "noex/vector.hpp"
+#include "process.h"
+#include "output_log.h"
+
+// Result of a command in "pipeline"
+struct StageResult {
+    int exit_code;
+    ProcessStats stats;
+};
 
 struct ExecuteResult {
     int exit_code;
     noex::string err_msg;
     noex::string last_line;
+    // Total resource usage of all stages for pipelines
+    ProcessStats stats;
+    // True when the process was stopped by "timeout_ms".
+    bool timed_out;
+    // True when Tuw failed to start the command. err_msg is an error of Tuw then.
+    // Otherwise, err_msg is the last characters of stderr.
+    bool launch_failed;
+    // Results of each command in "pipeline". Empty for other commands.
+    noex::vector<StageResult> stages;
+
+    ExecuteResult(int code, const noex::string& err, const noex::string& line) noexcept :
+        exit_code(code), err_msg(err), last_line(line), stats(), timed_out(false),
+        launch_failed(false), stages() {}
+};
+
+// Makes a result with exit code -1 for commands that Tuw failed to start.
+ExecuteResult LaunchError(const noex::string& err) noexcept;
+
+// Commands connected with pipes. ("pipeline")
+// Arguments of all stages are stored in one vector.
+class Pipeline {
+ private:
+    noex::vector<noex::string> m_args;
+    // End index of each stage in m_args
+    noex::vector<size_t> m_stage_ends;
+
+ public:
+    Pipeline() noexcept : m_args(), m_stage_ends() {}
+
+    void AddStage(const noex::vector<noex::string>& args) noexcept;
+    size_t GetStageCount() const noexcept {
+        return m_stage_ends.size();
+    }
+    noex::vector<noex::string> GetStage(size_t id) const noexcept;
+    void Clear() noexcept {
+        m_args.clear();
+        m_stage_ends.clear();
+    }
+};
+
+typedef void (*ProgressCallback)(int percent, void* data);
+
+// Reports progress of a command from its stdout. ("progress_regex")
+struct ProgressReporter {
+    // Lines that match the pattern should have a percentage. (e.g. "\d+%")
+    const char* regex;
+    // Called when the percentage has changed.
+    ProgressCallback callback;
+    void* data;
+};
+
+// Content streamed to stdin of a command. ("stdin")
+struct StdinContent {
+    // A file path when is_file is true. Otherwise, text to send.
+    noex::string str;
+    bool is_file;
+
+    StdinContent() noexcept : str(), is_file(false) {}
 };
 
 // When use_utf8_on_windows is true,
 // Tuw converts output strings from UTF-8 to UTF-16 on Windows.
+// Full outputs will be appended to log if it's not null.
+// limits will be applied to the process right after spawning it. (best-effort)
 ExecuteResult Execute(const noex::string& cmd,
-                      bool use_utf8_on_windows = false) noexcept;
+                      bool use_utf8_on_windows = false,
+                      OutputLog* log = nullptr,
+                      const ProgressReporter* progress = nullptr,
+                      const StdinContent* input = nullptr,
+                      const ProcessLimits* limits = nullptr) noexcept;
+// Runs a command without shell. Each argument is passed to the process as is.
+ExecuteResult Execute(const noex::vector<noex::string>& args,
+                      bool use_utf8_on_windows = false,
+                      OutputLog* log = nullptr,
+                      const ProgressReporter* progress = nullptr,
+                      const StdinContent* input = nullptr,
+                      const ProcessLimits* limits = nullptr) noexcept;
+// Runs commands connected with pipes without shell.
+// The exit code is from the last command. Results of each command are in "stages".
+// input is sent to the first command, and limits are applied to each command.
+ExecuteResult Execute(const Pipeline& pipeline,
+                      bool use_utf8_on_windows = false,
+                      OutputLog* log = nullptr,
+                      const ProgressReporter* progress = nullptr,
+                      const StdinContent* input = nullptr,
+                      const ProcessLimits* limits = nullptr) noexcept;
 ExecuteResult LaunchDefaultApp(const noex::string& url) noexcept;
 
+class RedirectContext;
+class StdinWriter;
+
+// Runs a command without blocking the caller. (e.g. jobs of the GUI)
+// Call Update() periodically until it returns false, then call Finish().
+class AsyncExecution {
+ private:
+    // The last command of the pipeline, or the command itself
+    ChildProcess m_process;
+    // Other commands of the pipeline
+    ChildProcess* m_stages;
+    size_t m_stage_count;
+    RedirectContext* m_stdout_context;
+    RedirectContext* m_stderr_context;
+    bool m_use_utf8_on_windows;
+    bool m_is_running;
+    OutputLog* m_log;
+    const char* m_progress_regex;
+    StdinContent m_input;
+    bool m_use_input;
+    StdinWriter* m_stdin_writer;
+    ProcessLimits m_limits;
+
+    noex::string Start(const ArgChar* const* argv) noexcept;
+    // Allocates contexts before spawning processes.
+    noex::string NewContexts() noexcept;
+    noex::string Spawn(ChildProcess& process, const ArgChar* const* argv,
+                       bool is_first) noexcept;
+    ChildProcess& GetFirstProcess() noexcept {
+        return m_stage_count ? m_stages[0] : m_process;
+    }
+
+ public:
+    explicit AsyncExecution(bool use_utf8_on_windows = false,
+                            OutputLog* log = nullptr) noexcept;
+    ~AsyncExecution() noexcept;
+
+    // Launches a command via shell. Returns an error message on failure.
+    noex::string Start(const noex::string& cmd) noexcept;
+    // Launches a command without shell.
+    noex::string Start(const noex::vector<noex::string>& args) noexcept;
+    // Launches commands connected with pipes. Not supported on Windows.
+    noex::string Start(const Pipeline& pipeline) noexcept;
+
+    // Redirects outputs to the console. Returns false when the process has exited.
+    bool Update() noexcept;
+
+    // Waits for the process and returns its result.
+    ExecuteResult Finish() noexcept;
+
+    // Kills the process. You still need to call Finish() after this.
+    void Terminate() noexcept;
+
+    // Parses percentages from stdout lines that match the regex.
+    // Call this before Start().
+    void SetProgressRegex(const char* regex) noexcept;
+    // Returns the last percentage or -1.
+    int GetProgress() const noexcept;
+
+    // Streams the content to stdin of the process. Call this before Start().
+    void SetStdin(const StdinContent& input) noexcept;
+    // Returns true when stdin has more data to send right now.
+    bool IsSendingStdin() const noexcept;
+
+    // Sets priority, CPU affinity, resource limits, and a timeout. Call this before Start().
+    // Limits are applied right after spawning the process, so they are best-effort.
+    // (See ChildProcess::ApplyLimits()) Limits that can't be applied are reported as warnings.
+    // Processes with a timeout run in a new process group.
+    void SetLimits(const ProcessLimits& limits) noexcept;
+};
+
+// Stops updating the log window while running commands.
+// Call this when GTK is not initialized. (e.g. the "run" command)
+void ExecuteDisableGui() noexcept;
+
+// Long-lived process for "worker" mode.
+// Tuw sends a request ({"args": ["arg1", "arg2", ...]}\n) to stdin of the worker.
+// The worker should print "\x1e<exit code>\n" to stdout when it finishes the request.
+class Worker {
+ private:
+    ChildProcess m_process;
+    noex::string m_cmd;
+    bool m_is_running;
+
+    noex::string Start(const noex::string& cmd) noexcept;
+
+ public:
+    Worker() noexcept : m_process(), m_cmd(), m_is_running(false) {}
+    ~Worker() noexcept {
+        Stop();
+    }
+
+    // Launches the worker via shell if it's not running, and sends a request.
+    // The worker will be restarted when cmd is changed.
+    ExecuteResult Run(const noex::string& cmd,
+                      const noex::vector<noex::string>& args,
+                      bool use_utf8_on_windows = false,
+                      OutputLog* log = nullptr) noexcept;
+
+    // Closes stdin of the worker and waits for it. Kills it after 1 second.
+    void Stop() noexcept;
+};
+
+#define LAST_CHARS_MAX_LEN 2048
+
 // We use ring buffers to store outputs.
 template <size_t Size>
 class RingStrBuffer {
@@ -33,6 +227,11 @@ class RingStrBuffer {
         return (!m_is_full && m_tail == 0);
     }
 
+    void Clear() noexcept {
+        m_tail = 0;
+        m_is_full = false;
+    }
+
     void PushBack(char value) noexcept {
         m_buffer[m_tail] = value;
 
@@ -82,3 +281,37 @@ class RingStrBuffer {
         return noex::string(m_buffer, Size);
     }
 };
+
+// Splits streamed outputs into lines.
+// It keeps the last line while receiving outputs,
+// so we don't need to rescan buffered outputs to get it.
+class LineSplitter {
+ private:
+    // The current line and the previous non-empty line
+    RingStrBuffer<LAST_CHARS_MAX_LEN> m_lines[2];
+    int m_current;
+    const char* m_progress_regex;
+    int m_progress;
+
+    void EndLine() noexcept;
+
+ public:
+    LineSplitter() noexcept : m_lines(), m_current(0),
+        m_progress_regex(nullptr), m_progress(-1) {}
+
+    // Line feeds (\n and \r) end lines.
+    void Push(const char* buf, size_t size) noexcept;
+
+    // Returns the last non-empty line without line feeds.
+    // Long lines start with "..."
+    noex::string GetLastLine() noexcept;
+
+    // Parses a percentage when a line matches the regex.
+    void SetProgressRegex(const char* regex) noexcept {
+        m_progress_regex = regex;
+    }
+    // Returns the last percentage or -1.
+    int GetProgress() const noexcept {
+        return m_progress;
+    }
+};
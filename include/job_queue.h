@@ -0,0 +1,80 @@
+// FIFO queue to run commands in the background.
+// The GUI polls it with a timer, so users can queue the next job while others run.
+
+#pragma once
+#include "json.h"
+#include "exec.h"
+#include "string_utils.h"
+#include "noex/vector.hpp"
+
+enum JobState : int {
+    JOB_QUEUED = 0,
+    JOB_RUNNING,
+    JOB_FINISHED,
+};
+
+struct Job {
+    int id;
+    JobState state;
+    // Max number of running jobs when this job starts. ("max_parallel")
+    int max_parallel;
+    const tuwjson::Value* sub_definition;
+    // Snapshots of the command at enqueue time
+    noex::string cmd;
+    noex::vector<noex::string> args;
+    noex::string cache_key;
+    StdinContent input;
+    bool use_input;
+    Pipeline pipeline;
+    bool use_pipeline;
+    AsyncExecution* execution;
+    ExecuteResult result;
+
+    Job() noexcept : id(0), state(JOB_QUEUED), max_parallel(1), sub_definition(nullptr),
+        cmd(), args(), cache_key(), input(), use_input(false),
+        pipeline(), use_pipeline(false), execution(nullptr), result(0, "", "") {}
+    ~Job() noexcept;
+};
+
+class JobQueue {
+ private:
+    noex::vector<Job*> m_jobs;
+    int m_next_id;
+
+    void StartJob(Job* job) noexcept;
+
+ public:
+    JobQueue() noexcept : m_jobs(), m_next_id(1) {}
+    ~JobQueue() noexcept {
+        Clear();
+    }
+
+    // Adds a job and returns its id. Returns -1 when it failed to allocate memory.
+    // Commands without shell should have args. Otherwise, args should be empty.
+    // input will be sent to stdin if it's not null.
+    // pipeline will be used instead of cmd and args if it's not null.
+    int Push(const tuwjson::Value& sub_definition,
+             const noex::string& cmd,
+             const noex::vector<noex::string>& args,
+             const noex::string& cache_key,
+             const StdinContent* input = nullptr,
+             const Pipeline* pipeline = nullptr) noexcept;
+
+    // Starts queued jobs in order and redirects outputs of running jobs.
+    // Returns a finished job or nullptr. The caller should free it with DeleteJob().
+    Job* Update() noexcept;
+    static void DeleteJob(Job* job) noexcept;
+
+    size_t GetQueuedCount() const noexcept;
+    size_t GetRunningCount() const noexcept;
+    bool IsEmpty() const noexcept {
+        return m_jobs.empty();
+    }
+    // Returns jobs in the queued order.
+    const noex::vector<Job*>& GetJobs() const noexcept {
+        return m_jobs;
+    }
+
+    // Kills running jobs and removes all jobs.
+    void Clear() noexcept;
+};
@@ -36,7 +36,7 @@ class Item {
     Value* val;
 
     Item() noexcept : key(), val() {
-        val = noex::new_ref<Value>();
+        val = noex::new_ref<Value>(noex::ALLOC_JSON);
     }
     Item(Item&& item) noexcept :
             key(static_cast<noex::string&&>(item.key)), val(item.val) {
@@ -44,7 +44,7 @@ class Item {
     }
 
     ~Item() noexcept {
-        noex::del_ref(val);
+        noex::del_ref(val, noex::ALLOC_JSON);
     }
 };
 
@@ -194,13 +194,19 @@ class Value {
     }
     void SetString() noexcept;
     void SetString(const char* val) noexcept;
+    // Copies size bytes. The string can have null characters.
+    void SetString(const char* val, size_t size) noexcept;
     inline void SetString(const noex::string& str) noexcept {
-        SetString(str.c_str());
+        SetString(str.c_str(), str.size());
     }
     inline const char* GetString() const noexcept {
         assert(m_type == JSON_TYPE_STRING);
         return u.m_string->c_str();
     }
+    inline size_t GetStringSize() const noexcept {
+        assert(m_type == JSON_TYPE_STRING);
+        return u.m_string->size();
+    }
 
     // int
     inline bool IsInt() const noexcept {
@@ -379,7 +385,11 @@ class Writer {
     }
     void WriteIndent() noexcept;
     void WriteLinefeed() noexcept;
-    void WriteString(const char* str) noexcept;
+    // Other control characters than \b, \f, \n, \r, and \t are written as \u00XX.
+    void WriteString(const char* str, size_t size) noexcept;
+    void WriteString(const noex::string& str) noexcept {
+        WriteString(str.c_str(), str.size());
+    }
     void WriteObject(const Object* obj) noexcept;
     void WriteArray(const Array* ary) noexcept;
     void WriteValue(const Value* val) noexcept;
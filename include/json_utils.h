@@ -23,20 +23,27 @@ enum ComponentType: int {
 enum CmdPredefinedIds: int {
     CMD_ID_PERCENT = -1,
     CMD_ID_CURRENT_DIR = -2,
-    CMD_ID_HOME_DIR = -3
+    CMD_ID_HOME_DIR = -3,
+    // CMD_ID_RESOURCE - i is the i-th name in ["resource_names"].
+    CMD_ID_RESOURCE = -4
 };
 
 constexpr char CMD_TOKEN_PERCENT[] = "";
 constexpr char CMD_TOKEN_CURRENT_DIR[] = "__CWD__";
 constexpr char CMD_TOKEN_HOME_DIR[] = "__HOME__";
+constexpr char CMD_TOKEN_RESOURCE[] = "__resource:";
 
 #ifdef _WIN32
 constexpr wchar_t FILE_MODE_READ[] = L"rb";
 constexpr wchar_t FILE_MODE_WRITE[] = L"wb";
+constexpr wchar_t FILE_MODE_APPEND[] = L"ab";
+constexpr wchar_t FILE_MODE_UPDATE[] = L"r+b";
 FILE* FileOpen(const char* path, const wchar_t* mode) noexcept;
 #else
 constexpr char FILE_MODE_READ[] = "rb";
 constexpr char FILE_MODE_WRITE[] = "wb";
+constexpr char FILE_MODE_APPEND[] = "ab";
+constexpr char FILE_MODE_UPDATE[] = "r+b";
 #define FileOpen(path, mode) fopen(path, mode)
 #endif
 noex::string GetFileError(const noex::string& path) noexcept;
@@ -49,7 +56,11 @@ namespace json_utils {
 
 // Returns an empty string if succeed. An error message otherwise.
 noex::string LoadJson(const noex::string& file, tuwjson::Value& json) noexcept;
-noex::string SaveJson(tuwjson::Value& json, const noex::string& file) noexcept;
+// Removes indents and line feeds when compact is true.
+noex::string SaveJson(tuwjson::Value& json, const noex::string& file,
+                      bool compact = false) noexcept;
+// Appends JSON to a file as a line of JSON Lines.
+noex::string AppendJsonLine(tuwjson::Value& json, const noex::string& file) noexcept;
 
 const char* GetString(const tuwjson::Value& json, const char* key, const char* def) noexcept;
 bool GetBool(const tuwjson::Value& json, const char* key, bool def) noexcept;
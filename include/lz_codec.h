@@ -0,0 +1,21 @@
+// Small LZ77 codec to compress embedded JSON. ("merge --compress")
+// The format is similar to LZ4 blocks.
+// Each sequence is [token][literal length][literals][offset][match length].
+// The high and low 4 bits of the token are the literal length and the match length - 4.
+// Lengths of 15 or more continue with extra bytes. (255, 255, ..., the rest)
+// Offsets are 2-byte little endian. The last sequence has only literals.
+
+#pragma once
+#include <stddef.h>
+
+// Max size of compressed data
+inline size_t LzCompressBound(size_t size) noexcept {
+    return size + size / 255 + 16;
+}
+
+// Returns the compressed size, or 0 when dst is too small.
+size_t LzCompress(const char* src, size_t src_size, char* dst, size_t dst_size) noexcept;
+
+// Decodes sequences in order. Returns false when the data is broken
+// or the decompressed size is not dst_size.
+bool LzDecompress(const char* src, size_t src_size, char* dst, size_t dst_size) noexcept;
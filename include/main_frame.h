@@ -4,14 +4,23 @@
 #include "json_utils.h"
 #include "string_utils.h"
 #include "noex/vector.hpp"
+#include "result_cache.h"
+#include "job_queue.h"
+#include "output_log.h"
+#include "output_viewer.h"
 #include "ui.h"
 
 class MainFrame;
+class Worker;
 
 #define EMPTY_JSON tuwjson::Value()
 
 // Get "gui_definition.*"
-const char* GetDefaultJsonPath() noexcept;
+// exists will be true when the file exists. (to avoid probing it again)
+const char* GetDefaultJsonPath(bool* exists = nullptr) noexcept;
+
+// Allocation counters of noex containers as text
+noex::string GetMemoryUsageStr() noexcept;
 
 // Main window
 class MainFrame {
@@ -29,8 +38,25 @@ class MainFrame {
     uiGrid* m_grid;
     uiButton* m_run_button;
     uiMenuItem* m_menu_safe_mode;
+    Worker* m_worker;
+    ResultCache m_result_cache;
+    JobQueue m_job_queue;
+    bool m_is_job_timer_running;
+    bool m_is_updating_jobs;
+    OutputLog m_output_log;
+    OutputViewer m_output_viewer;
 
     void CreateFrame() noexcept;
+    ExecuteResult ExecuteCommand(const tuwjson::Value& sub_definition,
+                                 const noex::string& cmd,
+                                 const noex::vector<noex::string>& args,
+                                 const Pipeline* pipeline,
+                                 const StdinContent* input) noexcept;
+    void HandleResult(const tuwjson::Value& sub_definition,
+                      const ExecuteResult& result,
+                      const noex::string& cache_key,
+                      OutputLog* log = nullptr) noexcept;
+    void UpdateJobStatus() noexcept;
     void CreateMenu() noexcept;
     noex::string CheckDefinition(tuwjson::Value& definition) noexcept;
     void UpdateConfig() noexcept;
@@ -78,6 +104,8 @@ class MainFrame {
         Initialize(EMPTY_JSON, EMPTY_JSON, json_path);
     }
 
+    ~MainFrame() noexcept;
+
     void Initialize(const tuwjson::Value& definition,
                     const tuwjson::Value& config,
                     noex::string json_path) noexcept;
@@ -86,8 +114,24 @@ class MainFrame {
     noex::string OpenURLBase(size_t id) noexcept;
     void OpenURL(size_t id) noexcept;
     bool Validate() noexcept;
-    noex::string GetCommand() noexcept;
+    // err will be an error of extracting resources.
+    noex::string GetCommand(noex::string* err = nullptr) noexcept;
+    noex::vector<noex::string> GetCommandArgs(noex::string* err = nullptr) noexcept;
+    // Returns the command with sizes and timestamps of files from pickers.
+    // Text for stdin is also a part of the key.
+    // args are used instead of cmd when they are not empty. ("shell": false)
+    noex::string GetCacheKey(const noex::string& cmd,
+                             const noex::vector<noex::string>& args,
+                             const StdinContent* input = nullptr) noexcept;
     void RunCommand() noexcept;
+    // Handles finished jobs. Returns false when the queue is empty.
+    bool UpdateJobs() noexcept;
+    // Opens a window to read the output log of the last run.
+    void ShowOutputLog() noexcept;
+    // Shows allocation counters of noex containers. (Debug > Memory Usage)
+    void ShowMemoryUsage() noexcept;
+    // Shows the progress of a running command on the button.
+    void ShowProgress(int percent) noexcept;
     void GetDefinition(tuwjson::Value& json) noexcept;
     void SaveConfig() noexcept;
     void Fit(bool keep_width = false) noexcept;
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+namespace noex {
+
+// Kinds of allocations.
+enum AllocTag : int {
+    ALLOC_STRING = 0,
+    ALLOC_VECTOR,
+    ALLOC_JSON,  // JSON nodes
+    ALLOC_COMPONENT,  // GUI components
+    ALLOC_OTHER,  // new_ref() without tags
+    ALLOC_TAG_MAX,
+};
+
+struct AllocCounter {
+    size_t alloc_count;
+    size_t free_count;
+    // Total bytes allocated so far
+    size_t alloc_bytes;
+    // Bytes not freed yet
+    size_t live_bytes;
+};
+
+struct AllocStats {
+    AllocCounter total;
+    // Max of total.live_bytes
+    size_t peak_live_bytes;
+    AllocCounter tags[ALLOC_TAG_MAX];
+};
+
+// calloc() with counters. All noex containers allocate memory with it.
+// Returns nullptr when it failed.
+void* alloc(size_t count, size_t size, AllocTag tag) noexcept;
+
+// free() with counters. bytes should be count * size of alloc().
+void dealloc(void* ptr, size_t bytes, AllocTag tag) noexcept;
+
+// Gets counters of all threads.
+void get_alloc_stats(AllocStats* stats) noexcept;
+
+const char* get_alloc_tag_name(AllocTag tag) noexcept;
+
+}  // namespace noex
@@ -18,6 +18,7 @@ enum ErrorNo : int {
 };
 
 // Returns the error status for tuwString.
+// The status is thread-local. Errors on other threads are not reported.
 ErrorNo get_error_no() noexcept;
 
 void set_error_no(ErrorNo err) noexcept;
@@ -1,26 +1,55 @@
 #pragma once
 
+#include <new>
+#include "noex/alloc.hpp"
+#include "noex/error.hpp"
+
 namespace noex {
 
-template <typename T>
-T* new_ref() {
-    T* obj = reinterpret_cast<T*>(calloc(1, sizeof(T)));
+// Allocates an object and calls its constructor with args.
+// Returns nullptr and sets NEW_ALLOCATION_ERROR when it failed.
+template <typename T, typename... Args>
+T* new_ref(AllocTag tag = ALLOC_OTHER, Args&&... args) {
+    T* obj = static_cast<T*>(alloc(1, sizeof(T), tag));
     if (obj) {
-        if (std::is_trivial<T>::value)
-            new (obj) T();
+        new (obj) T(static_cast<Args&&>(args)...);
     } else {
         set_error_no(NEW_ALLOCATION_ERROR);
     }
     return obj;
 }
 
+// tag should be the same as new_ref().
 template <typename T>
-void del_ref(T* obj) {
+void del_ref(T* obj, AllocTag tag = ALLOC_OTHER) {
     if (!obj)
         return;
-    if (std::is_trivial<T>::value)
-        obj->~T();
-    free(obj);
+    obj->~T();
+    dealloc(obj, sizeof(T), tag);
+}
+
+// Allocates an array and calls the default constructor of each element.
+// Returns nullptr and sets NEW_ALLOCATION_ERROR when it failed.
+template <typename T>
+T* new_array(size_t count, AllocTag tag = ALLOC_OTHER) {
+    T* arr = static_cast<T*>(alloc(count, sizeof(T), tag));
+    if (!arr) {
+        set_error_no(NEW_ALLOCATION_ERROR);
+        return nullptr;
+    }
+    for (size_t i = 0; i < count; i++)
+        new (arr + i) T();
+    return arr;
+}
+
+// count and tag should be the same as new_array().
+template <typename T>
+void del_array(T* arr, size_t count, AllocTag tag = ALLOC_OTHER) {
+    if (!arr)
+        return;
+    for (size_t i = 0; i < count; i++)
+        arr[i].~T();
+    dealloc(arr, count * sizeof(T), tag);
 }
 
 }  // namespace noex
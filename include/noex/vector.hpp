@@ -6,6 +6,7 @@
 #include <utility>
 #include <new>
 
+#include "noex/alloc.hpp"
 #include "noex/error.hpp"
 
 namespace noex {
@@ -56,7 +57,7 @@ class non_trivial_vector {
     void reserve(size_t capacity) noexcept {
         if (capacity <= m_capacity) return;
 
-        T* data = reinterpret_cast<T*>(calloc(capacity, sizeof(T)));
+        T* data = static_cast<T*>(alloc(capacity, sizeof(T), ALLOC_VECTOR));
         if (!data) {
             set_error_no(VEC_ALLOCATION_ERROR);
             clear();
@@ -69,7 +70,7 @@ class non_trivial_vector {
             m_data[i].~T();
         }
 
-        free(m_data);
+        dealloc(m_data, m_capacity * sizeof(T), ALLOC_VECTOR);
         m_data = data;
         m_capacity = capacity;
     }
@@ -89,7 +90,7 @@ class non_trivial_vector {
         if (m_data) {
             for (size_t i = 0; i < m_size; ++i)
                 m_data[i].~T();
-            free(m_data);
+            dealloc(m_data, m_capacity * sizeof(T), ALLOC_VECTOR);
         }
         m_data = nullptr;
         m_size = 0;
@@ -189,7 +190,7 @@ class non_trivial_vector {
     void shrink_to_fit() noexcept {
         if (m_size >= m_capacity) return;
 
-        T* data = reinterpret_cast<T*>(calloc(m_size, sizeof(T)));
+        T* data = static_cast<T*>(alloc(m_size, sizeof(T), ALLOC_VECTOR));
         if (!data) {
             set_error_no(VEC_ALLOCATION_ERROR);
             return;
@@ -201,7 +202,7 @@ class non_trivial_vector {
             m_data[i].~T();
         }
 
-        free(m_data);
+        dealloc(m_data, m_capacity * sizeof(T), ALLOC_VECTOR);
         m_data = data;
         m_capacity = m_size;
     }
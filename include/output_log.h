@@ -0,0 +1,60 @@
+// Full outputs of a command saved to a file. ("output_log")
+// It builds an index of line offsets while appending outputs,
+// and maps the file to memory to read any line without loading the whole file.
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include "string_utils.h"
+#include "noex/vector.hpp"
+
+class OutputLog {
+ private:
+    noex::string m_path;
+    FILE* m_file;
+    uint64_t m_size;
+    // Start offsets of lines
+    noex::vector<uint64_t> m_line_offsets;
+    // Read-only view of the file
+    const char* m_data;
+    uint64_t m_mapped_size;
+
+    void Unmap() noexcept;
+    // Maps the file again if it has grown. Returns false on failure.
+    bool Map() noexcept;
+
+ public:
+    OutputLog() noexcept : m_path(), m_file(nullptr), m_size(0),
+        m_line_offsets(), m_data(nullptr), m_mapped_size(0) {}
+    ~OutputLog() noexcept;
+
+    // Creates a new log file. Old outputs will be removed.
+    noex::string Open(const char* path) noexcept;
+    void Append(const char* buf, size_t size) noexcept;
+    // Stops writing. You can still read lines after this.
+    void Close() noexcept;
+
+    const noex::string& GetPath() const noexcept {
+        return m_path;
+    }
+    bool IsEmpty() const noexcept {
+        return m_size == 0;
+    }
+    size_t GetLineCount() const noexcept;
+
+    // Returns the line that contains the byte offset. O(log n)
+    size_t FindLineByOffset(uint64_t offset) const noexcept;
+    // Returns lines without line feeds. The last line has no line feed.
+    noex::string GetLines(size_t first, size_t count) noexcept;
+    noex::string GetLine(size_t line) noexcept {
+        return GetLines(line, 1);
+    }
+
+    // Returns the first line that contains the text after the start line.
+    // Returns noex::string::npos when not found.
+    size_t Search(const char* text, size_t start = 0) noexcept;
+
+    // Returns lines around the last line that contains "error",
+    // or the last lines when there are no errors.
+    noex::string GetErrorRegion(size_t max_lines) noexcept;
+};
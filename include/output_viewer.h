@@ -0,0 +1,36 @@
+// Window to read a large output log by pages.
+
+#pragma once
+#include "output_log.h"
+#include "ui.h"
+
+class OutputViewer {
+ private:
+    OutputLog* m_log;
+    uiWindow* m_window;
+    uiEntry* m_search_entry;
+    uiSpinbox* m_line_picker;
+    uiLabel* m_status;
+    uiMultilineEntry* m_text;
+    size_t m_first_line;
+    size_t m_found_line;
+
+    void BuildWindow() noexcept;
+
+ public:
+    OutputViewer() noexcept : m_log(nullptr), m_window(nullptr),
+        m_search_entry(nullptr), m_line_picker(nullptr),
+        m_status(nullptr), m_text(nullptr),
+        m_first_line(0), m_found_line(noex::string::npos) {}
+
+    // Shows the window with the first lines of the log.
+    void Show(OutputLog* log) noexcept;
+    // Shows lines from first_line. (0-indexed)
+    void ShowPage(size_t first_line) noexcept;
+    // Finds the next line that contains the text of the search box.
+    void FindNext() noexcept;
+    void GoToLine() noexcept;
+    void OnClosed() noexcept {
+        m_window = nullptr;
+    }
+};
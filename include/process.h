@@ -0,0 +1,192 @@
+#pragma once
+#include <stdint.h>
+#ifdef _WIN32
+#include "subprocess.h"
+#else
+#include <sys/types.h>
+#endif
+
+#ifdef _WIN32
+typedef wchar_t ArgChar;
+#else
+typedef char ArgChar;
+#endif
+
+// Resource usage of a child process.
+// Unsupported values are zero. (e.g. max_rss_kb on Windows)
+struct ProcessStats {
+    uint64_t wall_time_us;
+    uint64_t user_time_us;
+    uint64_t sys_time_us;
+    uint64_t max_rss_kb;
+    uint64_t read_blocks;  // The number of read operations on Windows
+    uint64_t write_blocks;  // The number of write operations on Windows
+};
+
+// Priority and resource limits of a child process.
+// ("nice", "cpu_affinity", "memory_limit_mb", "cpu_limit", "timeout_ms", and "kill_grace_ms")
+struct ProcessLimits {
+    // Niceness from -20 (highest priority) to 19 (lowest priority).
+    // Windows uses a priority class close to it.
+    int nice;
+    bool use_nice;
+    // Bit mask of CPUs (0 to 63) the process can run on. 0 means all CPUs.
+    uint64_t cpu_mask;
+    // Max memory in MiB. 0 means no limit.
+    int memory_limit_mb;
+    // Max CPU time in percent of one CPU. (e.g. 200 for 2 CPUs) 0 means no limit.
+    int cpu_limit;
+    // Max wall time in milliseconds. 0 means no limit.
+    uint32_t timeout_ms;
+    // Time between SIGTERM and SIGKILL after the timeout.
+    uint32_t kill_grace_ms;
+
+    ProcessLimits() noexcept : nice(0), use_nice(false), cpu_mask(0),
+        memory_limit_mb(0), cpu_limit(0), timeout_ms(0), kill_grace_ms(0) {}
+
+    bool IsEmpty() const noexcept {
+        return !use_nice && !cpu_mask && !memory_limit_mb && !cpu_limit && !timeout_ms;
+    }
+};
+
+// Returns time in microseconds from an arbitrary point. It never goes back.
+uint64_t GetMonotonicTimeUs() noexcept;
+
+enum ProcessOption : int {
+    // Read stdout and stderr of the child process with ReadStdout() and ReadStderr().
+    // The child process inherits them when this option is not set.
+    PROCESS_REDIRECT_OUTPUT = 1,
+    // Send inputs to the child process with WriteStdin().
+    // stdin will be empty when this option is not set.
+    // The caller should ignore SIGPIPE. Otherwise, writing to a dead process kills it.
+    PROCESS_PIPE_STDIN = 2,
+    // Makes the pipe for stdin non-blocking. Use it with PROCESS_PIPE_STDIN.
+    // Ignored on Windows.
+    PROCESS_NONBLOCK_STDIN = 4,
+    // Starts the process in a new process group
+    // so that Terminate() and Interrupt() also stop its descendants.
+    // Windows uses a job object instead.
+    PROCESS_NEW_GROUP = 8,
+};
+
+// Launches a child process and reads its outputs without blocking.
+// Windows uses subprocess.h.
+// Other platforms use posix_spawn, which is implemented with vfork or
+// clone(CLONE_VM|CLONE_VFORK) on major libc implementations.
+// It does not copy page tables of the parent process,
+// so the spawn latency doesn't grow with the RSS of the GUI.
+// When TUW_USE_ZYGOTE is defined and ZygoteStart() succeeded,
+// the zygote process forks children instead. (See zygote.h)
+class ChildProcess {
+ private:
+#ifdef _WIN32
+    struct subprocess_s m_process;
+    bool m_redirect_output;
+    // Job object for memory and CPU limits, or for PROCESS_NEW_GROUP
+    void* m_job;
+#else
+    pid_t m_pid;
+    int m_stdout_fd;
+    int m_stderr_fd;
+    int m_stdin_fd;
+    // stdin given by SetStdinFd(). It will be closed after Spawn().
+    int m_input_fd;
+    int m_exit_code;
+    // Process group for PROCESS_NEW_GROUP. It's still valid after the leader exits.
+    pid_t m_pgid;
+#ifdef __linux__
+    // cgroup for memory and CPU limits. It will be removed after Join().
+    char* m_cgroup_dir;
+#endif
+#ifdef TUW_USE_ZYGOTE
+    // Receives reports from the zygote. -1 when spawned with posix_spawn.
+    int m_status_fd;
+    bool ReadZygoteReport(bool block) noexcept;
+#endif
+#endif
+    bool m_is_running;
+    uint64_t m_start_time_us;
+    ProcessStats m_stats;
+    uint64_t m_timeout_us;
+    uint64_t m_kill_grace_us;
+    bool m_timed_out;
+    bool m_killed;
+
+ public:
+    ChildProcess() noexcept;
+    ~ChildProcess() noexcept;
+
+    // argv should be terminated with a null pointer.
+    // The executable will be searched from PATH.
+    // options is a combination of ProcessOption flags.
+    // Returns false if it failed to launch the process.
+    bool Spawn(const ArgChar* const* argv,
+               int options = PROCESS_REDIRECT_OUTPUT) noexcept;
+
+    // Applies limits to the running process. Children of the process inherit them.
+    // Linux uses setpriority(), sched_setaffinity(), and cgroup v2 if it's writable.
+    // Windows uses a priority class, an affinity mask, and a job object.
+    // Returns an error message, or nullptr when all limits are applied.
+    // It's best-effort because the process is already running.
+    // Children it started before this call (e.g. commands of "sh -c") keep running without them.
+    const char* ApplyLimits(const ProcessLimits& limits) noexcept;
+
+    // Reads available bytes from stdout or stderr. Never blocks.
+    // Returns 0 when there is nothing to read.
+    unsigned ReadStdout(char* buf, unsigned size) noexcept;
+    unsigned ReadStderr(char* buf, unsigned size) noexcept;
+
+    // Writes all bytes to stdin. Blocks until the pipe accepts them.
+    // Returns false if the process closed stdin.
+    bool WriteStdin(const char* buf, unsigned size) noexcept;
+    // Writes bytes to stdin. Never blocks with PROCESS_NONBLOCK_STDIN.
+    // Returns the written size, or -1 on failure. errno is EAGAIN when the pipe is full.
+    int64_t TryWriteStdin(const char* buf, size_t size) noexcept;
+#ifdef __linux__
+    // Moves bytes from a file to stdin with splice(). The data never goes through user space.
+    // Returns the moved size, 0 at the end of the file, or -1 on failure.
+    // errno is EAGAIN when the pipe is full, and EINVAL when the file doesn't support splice().
+    int64_t SpliceToStdin(int fd, size_t size) noexcept;
+#endif
+    // Sends EOF to the process.
+    void CloseStdin() noexcept;
+
+#ifndef _WIN32
+    // Uses fd as stdin of the next process. (e.g. stdout of another process)
+    // It overrides PROCESS_PIPE_STDIN. ChildProcess takes ownership of fd.
+    void SetStdinFd(int fd) noexcept;
+    // Gives the read end of stdout to the caller. It will be blocking.
+    // Use it to connect the process to another one without copying data in Tuw.
+    int ReleaseStdout() noexcept;
+#endif
+
+    bool IsAlive() noexcept;
+
+    // Kills the process. You still need to call Join() after this.
+    // It kills the whole process group with PROCESS_NEW_GROUP.
+    // It does nothing after the process exited.
+    void Terminate() noexcept;
+    // Asks the process to exit with SIGTERM.
+    // Windows kills the process instead since it has no equivalent.
+    void Interrupt() noexcept;
+
+    // Stops the process when it runs longer than timeout_ms.
+    // It sends SIGTERM first, and SIGKILL after kill_grace_ms.
+    // Call this before Spawn(). Spawn() will use PROCESS_NEW_GROUP.
+    void SetTimeout(uint32_t timeout_ms, uint32_t kill_grace_ms) noexcept;
+    // Checks the deadline and stops the process if needed. Call this periodically.
+    // Returns true when the process timed out.
+    bool CheckTimeout() noexcept;
+    bool TimedOut() const noexcept {
+        return m_timed_out;
+    }
+
+    // Waits for the process and closes the pipes.
+    // Returns false if it failed to manage the process.
+    bool Join(int* exit_code) noexcept;
+
+    // Returns resource usage of the process. It's available after Join().
+    const ProcessStats& GetStats() const noexcept {
+        return m_stats;
+    }
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include "json.h"
+#include "exec.h"
+#include "noex/string.hpp"
+#include "noex/vector.hpp"
+
+// Returns "<size>:<mtime>" of a file or a directory.
+// mtime is "<seconds>.<nanoseconds>". The precision depends on the file system.
+// Returns an empty string when the path doesn't exist.
+noex::string GetFileStamp(const char* path) noexcept;
+
+// Joins arguments as "<length>:<arg><length>:<arg>...".
+// Unlike ArgsToString(), different arguments never make the same key.
+noex::string ArgsToCacheKey(const noex::vector<noex::string>& args) noexcept;
+
+// Stores results of commands in a JSON file.
+// Entries are sorted from the least recently used one,
+// and old entries are removed when the cache gets larger than CACHE_SIZE_MAX.
+class ResultCache {
+ private:
+    tuwjson::Value m_entries;
+    noex::string m_path;
+    bool m_is_loaded;
+
+    void Load() noexcept;
+    // Moves an entry to the end and removes old entries.
+    void Touch(size_t id) noexcept;
+    int Find(const noex::string& key) noexcept;
+
+ public:
+    explicit ResultCache(const char* path = "gui_cache.json") noexcept :
+        m_entries(), m_path(path), m_is_loaded(false) {}
+
+    // Returns true and copies the stored result when the key is found.
+    bool Get(const noex::string& key, ExecuteResult* result) noexcept;
+    // Stores a result and saves the cache file.
+    // Returns an empty string if succeed. An error message otherwise.
+    noex::string Put(const noex::string& key, const ExecuteResult& result) noexcept;
+};
@@ -0,0 +1,23 @@
+// Daemon mode for the "serve" command.
+//
+// Clients connect to a Unix domain socket and send one request per connection.
+//   {"mode": 0, "values": {"id": "value", ...}}\n
+// "mode" is an index of "gui", and "values" are the same as "-s id=value" of "run".
+// The server streams outputs and the result as JSON Lines, then closes the connection.
+//   {"stdout": "..."}\n
+//   {"stderr": "..."}\n
+//   {"exit_code": 0, "wall_ms": 1.5}\n
+// Or {"error": "..."}\n when it failed to run the command.
+
+#pragma once
+#include "json.h"
+#include "string_utils.h"
+
+#define SERVE_SOCKET_DEFAULT "tuw.sock"
+#define SERVE_PARALLEL_DEFAULT 4
+
+// Serves requests until SIGINT or SIGTERM.
+// definition should be checked with json_utils::CheckDefinition().
+// Returns an error message if it failed to start the server.
+noex::string Serve(const tuwjson::Value& definition,
+                   const char* socket_path, int max_parallel) noexcept;
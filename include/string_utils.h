@@ -3,17 +3,41 @@
 #include "env_utils.h"
 #include "noex/string.hpp"
 
+#define UNUSED(x) (void)(x)
+
 // Returns only the last line and removes trailing line feeds (\n and \r.)
 noex::string GetLastLine(const noex::string& str) noexcept;
 
 // Convert allocated string with env_utils.h into noex::string
 noex::string envuStr(char *cstr) noexcept;
 
+// Hash of a null-terminated string. (for old versions of embedded JSON)
 uint32_t Fnv1Hash32(const char* str) noexcept;
 inline uint32_t Fnv1Hash32(const noex::string& str) noexcept {
     return Fnv1Hash32(str.c_str());
 }
 
+// 64-bit hash of binary data. (XXH64 with seed 0)
+// It reads 8 bytes at once. Call Update() multiple times to hash data in chunks.
+class XxHash64 {
+ private:
+    uint64_t m_acc[4];
+    uint64_t m_total_size;
+    unsigned char m_buf[32];
+    size_t m_buf_size;
+
+ public:
+    XxHash64() noexcept;
+    void Update(const void* data, size_t size) noexcept;
+    uint64_t Digest() const noexcept;
+
+    static uint64_t Hash(const void* data, size_t size) noexcept {
+        XxHash64 hash;
+        hash.Update(data, size);
+        return hash.Digest();
+    }
+};
+
 #ifdef _WIN32
 noex::string ANSItoUTF8(const noex::string& str) noexcept;
 #else
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstddef>
+
+// Task for RunTasks(). id is in [0, count).
+typedef void (*TaskFunc)(size_t id, void* data);
+
+// Calls func(id, data) for each id with up to max_threads threads, and waits for all tasks.
+// Idle threads take the next task in order, and the calling thread also runs tasks.
+// Tasks should not use noex strings or vectors that other tasks can edit.
+void RunTasks(TaskFunc func, size_t count, int max_threads, void* data) noexcept;
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include "noex/string.hpp"
+
+// Scoped tracing in Chrome trace event format. ("--trace out.json" or TUW_TRACE=out.json)
+// Open the output with chrome://tracing or https://ui.perfetto.dev
+// Each thread records events to its own buffer, and TraceStop() writes them to the file.
+// Define TUW_NO_TRACE (meson option "use_trace=false") to remove tracing at compile time.
+
+#ifdef TUW_NO_TRACE
+
+#define TUW_TRACE_SCOPE(name) (void)0
+inline noex::string TraceStart(const char*) noexcept {
+    return "Tracing is disabled in this build.";
+}
+inline noex::string TraceStop() noexcept { return ""; }
+
+#else  // TUW_NO_TRACE
+
+extern bool g_trace_enabled;
+
+inline bool TraceEnabled() noexcept {
+#ifdef _MSC_VER
+    return *static_cast<volatile bool*>(&g_trace_enabled);
+#else
+    return __atomic_load_n(&g_trace_enabled, __ATOMIC_RELAXED);
+#endif
+}
+
+// Opens the output file and starts recording events.
+noex::string TraceStart(const char* path) noexcept;
+// Stops recording, writes recorded events, and closes the file.
+// It does nothing when tracing is disabled.
+noex::string TraceStop() noexcept;
+// Adds a complete event to the buffer of the current thread.
+// name should be a string literal. Events are dropped when the buffer is full.
+void TraceRecord(const char* name, uint64_t begin_us, uint64_t end_us) noexcept;
+uint64_t TraceNowUs() noexcept;
+
+// Only checks a flag when tracing is disabled at runtime.
+class TraceScope {
+ private:
+    const char* m_name;
+    uint64_t m_begin_us;
+
+ public:
+    explicit TraceScope(const char* name) noexcept
+        : m_name(TraceEnabled() ? name : nullptr),
+          m_begin_us(m_name ? TraceNowUs() : 0) {}
+    ~TraceScope() noexcept {
+        if (m_name)
+            TraceRecord(m_name, m_begin_us, TraceNowUs());
+    }
+};
+
+#define TUW_TRACE_CONCAT_(a, b) a##b
+#define TUW_TRACE_CONCAT(a, b) TUW_TRACE_CONCAT_(a, b)
+// Records the time until the end of the scope.
+#define TUW_TRACE_SCOPE(name) TraceScope TUW_TRACE_CONCAT(tuw_trace_, __LINE__)(name)
+
+#endif  // TUW_NO_TRACE
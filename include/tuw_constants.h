@@ -13,6 +13,9 @@ constexpr char AUTHOR[] = "matyalatte";
 constexpr char VERSION[] = "0.11.0";
 constexpr int VERSION_INT = 1100;
 
+// Interval to check background jobs
+const int JOB_TIMER_MS = 50;
+
 #ifdef _WIN32
 #define TUW_CONSTANTS_OS "win"
 const int GRID_COMP_XSPACE = 2;
@@ -3,6 +3,9 @@
 
 #include "string_utils.h"
 
+// Returns 1 when the pattern has () operators. tiny-str-match doesn't support them.
+int IsUnsupportedPattern(const char *pattern) noexcept;
+
 class Validator {
  private:
     const char* m_regex;
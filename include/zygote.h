@@ -0,0 +1,40 @@
+#pragma once
+#ifdef TUW_USE_ZYGOTE
+// Zygote is a small helper process forked at startup.
+// It forks child processes instead of the GUI process,
+// so the spawn latency doesn't depend on the memory usage of the GUI.
+// Enabled with "meson setup -Duse_zygote=true". (Unix only)
+#include <sys/types.h>
+#include <sys/resource.h>
+
+// Forks the zygote. Call this before the GUI allocates memory.
+// Returns false if failed. Child processes will be spawned by the GUI in that case.
+bool ZygoteStart() noexcept;
+bool ZygoteIsRunning() noexcept;
+
+struct ZygoteChild {
+    pid_t pid;
+    int stdout_fd;  // -1 when output is not redirected
+    int stderr_fd;  // -1 when output is not redirected
+    int stdin_fd;  // -1 when PROCESS_PIPE_STDIN is not set
+    int status_fd;  // Receives ZygoteReport
+};
+
+// A monitor process waits for the child and writes reports to status_fd.
+// The first report is sent when the child is forked. (status is -1.)
+// The second one is sent when the child exits.
+struct ZygoteReport {
+    pid_t pid;
+    int status;
+    struct rusage usage;
+};
+
+// Max number of arguments that the zygote accepts.
+// Use posix_spawn for commands with more arguments.
+#define ZYGOTE_ARGC_MAX 1024
+
+// Asks the zygote to spawn a process with the current working directory.
+// options is a combination of ProcessOption flags.
+// Returns false without asking the zygote when argv has more than ZYGOTE_ARGC_MAX arguments.
+bool ZygoteSpawn(const char* const* argv, int options, ZygoteChild* child) noexcept;
+#endif  // TUW_USE_ZYGOTE
@@ -0,0 +1,494 @@
+#include "command.h"
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "json_utils.h"
+#include "env_utils.h"
+#include "exe_container.h"
+#include "validator.h"
+#include "trace.h"
+#include "noex/new.hpp"
+
+// err will be an error of extracting a resource.
+// It's printed as a warning when err is null.
+static void AppendCommandToken(noex::string& cmd, int id, bool use_quotes,
+                               ComponentValues& values,
+                               const tuwjson::Value* resource_names,
+                               noex::string* err) noexcept {
+    if (id == CMD_ID_PERCENT) {
+        cmd.push_back('%');
+    } else if (id == CMD_ID_CURRENT_DIR) {
+        char* cwd = envuGetCwd();
+        cmd += cwd;
+        envuFree(cwd);
+    } else if (id == CMD_ID_HOME_DIR) {
+        char* home = envuGetHome();
+        cmd += home;
+        envuFree(home);
+    } else if (id <= CMD_ID_RESOURCE) {
+        // Embedded files are extracted to the temporary directory.
+        noex::string res_err;
+        noex::string path =
+            GetResourcePath((*resource_names)[CMD_ID_RESOURCE - id].GetString(), &res_err);
+        if (!res_err.empty()) {
+            if (!err)
+                PrintFmt("[RunCommand] Warning: %s\n", res_err.c_str());
+            else if (err->empty())
+                *err = res_err;
+        }
+        // The temporary directory can have spaces. (e.g. a user name on Windows)
+        if (use_quotes)
+            path = noex::concat_cstr("\"", path.c_str(), "\"");
+        cmd += path;
+    } else {
+        cmd += values.GetString(id, use_quotes);
+    }
+}
+
+noex::string BuildCommand(const tuwjson::Value& sub_definition,
+                          ComponentValues& values, noex::string* err) noexcept {
+    const tuwjson::Value& cmd_ary = sub_definition["command_splitted"];
+    const tuwjson::Value& cmd_ids = sub_definition["command_ids"];
+    const tuwjson::Value* resource_names = sub_definition.GetMemberPtr("resource_names");
+
+    if (cmd_ary.IsEmptyArray())
+        return "";
+
+    noex::string cmd = cmd_ary[0].GetString();
+    for (size_t i = 0; i < cmd_ids.GetArraySize(); i++) {
+        AppendCommandToken(cmd, cmd_ids[i].GetInt(), true, values, resource_names, err);
+        if (i + 1 < cmd_ary.GetArraySize()) {
+            cmd += cmd_ary[i + 1].GetString();
+        }
+    }
+    return cmd;
+}
+
+static noex::vector<noex::string> BuildArgs(const tuwjson::Value& argv,
+                                            ComponentValues& values,
+                                            const tuwjson::Value* resource_names,
+                                            noex::string* err) noexcept {
+    noex::vector<noex::string> args;
+    for (const tuwjson::Value& arg_json : argv) {
+        noex::string arg;
+        bool has_literal = false;
+        for (const tuwjson::Value& token : arg_json) {
+            if (token.IsString()) {
+                arg += token.GetString();
+                has_literal = true;
+            } else {
+                AppendCommandToken(arg, token.GetInt(), false, values, resource_names, err);
+            }
+        }
+        // Skip empty values (e.g. unchecked check boxes) unless they are quoted.
+        if (has_literal || !arg.empty())
+            args.push_back(arg);
+    }
+    return args;
+}
+
+noex::vector<noex::string> BuildCommandArgs(const tuwjson::Value& sub_definition,
+                                            ComponentValues& values,
+                                            noex::string* err) noexcept {
+    tuwjson::Value* argv_ptr = sub_definition.GetMemberPtr("command_argv");
+    if (!argv_ptr)
+        return noex::vector<noex::string>();
+    return BuildArgs(*argv_ptr, values, sub_definition.GetMemberPtr("resource_names"), err);
+}
+
+bool BuildPipeline(const tuwjson::Value& sub_definition,
+                   ComponentValues& values, Pipeline* pipeline,
+                   noex::string* err) noexcept {
+#ifdef _WIN32
+    UNUSED(err);
+    return false;
+#else
+    tuwjson::Value* pipeline_ptr = sub_definition.GetMemberPtr("pipeline_argv");
+    if (!pipeline_ptr)
+        return false;
+    const tuwjson::Value* resource_names = sub_definition.GetMemberPtr("resource_names");
+    pipeline->Clear();
+    for (const tuwjson::Value& argv : *pipeline_ptr)
+        pipeline->AddStage(BuildArgs(argv, values, resource_names, err));
+    return true;
+#endif
+}
+
+bool BuildStdin(const tuwjson::Value& sub_definition,
+                ComponentValues& values, StdinContent* input) noexcept {
+    int id = json_utils::GetInt(sub_definition, "stdin_id", -1);
+    if (id < 0)
+        return false;
+    input->str = values.GetRawString(id);
+    input->is_file =
+        sub_definition["components"][id]["type_int"].GetInt() == COMP_FILE;
+    return true;
+}
+
+noex::string ArgsToString(const noex::vector<noex::string>& args) noexcept {
+    noex::string str;
+    for (const noex::string& arg : args) {
+        if (!str.empty())
+            str.push_back(' ');
+        if (arg.empty() || arg.contains(' '))
+            str += noex::concat_cstr("\"", arg.c_str(), "\"");
+        else
+            str += arg;
+    }
+    return str;
+}
+
+static int ClampToInt(uint64_t num) noexcept {
+    return num > INT_MAX ? INT_MAX : static_cast<int>(num);
+}
+
+// Appends the result to a JSON Lines file.
+static noex::string AppendHistory(const char* file, const char* label,
+                                  const noex::string& cmd,
+                                  const ExecuteResult& result) noexcept {
+    const ProcessStats& stats = result.stats;
+    tuwjson::Value record;
+    record.SetObject();
+    record["time"].SetDouble(static_cast<double>(time(nullptr)));
+    record["label"].SetString(label);
+    record["command"].SetString(cmd);
+    record["exit_code"].SetInt(result.exit_code);
+    record["wall_ms"].SetDouble(stats.wall_time_us / 1000.0);
+    record["user_ms"].SetDouble(stats.user_time_us / 1000.0);
+    record["sys_ms"].SetDouble(stats.sys_time_us / 1000.0);
+    record["max_rss_kb"].SetInt(ClampToInt(stats.max_rss_kb));
+    record["read_blocks"].SetInt(ClampToInt(stats.read_blocks));
+    record["write_blocks"].SetInt(ClampToInt(stats.write_blocks));
+    if (result.timed_out)
+        record["timed_out"].SetBool(true);
+    if (!result.stages.empty()) {
+        tuwjson::Value& stages = record["stages"];
+        stages.SetArray();
+        for (const StageResult& stage : result.stages) {
+            tuwjson::Value stage_json;
+            stage_json.SetObject();
+            stage_json["exit_code"].SetInt(stage.exit_code);
+            stage_json["wall_ms"].SetDouble(stage.stats.wall_time_us / 1000.0);
+            stage_json["user_ms"].SetDouble(stage.stats.user_time_us / 1000.0);
+            stage_json["sys_ms"].SetDouble(stage.stats.sys_time_us / 1000.0);
+            stage_json["max_rss_kb"].SetInt(ClampToInt(stage.stats.max_rss_kb));
+            stages.MoveAndPush(stage_json);
+        }
+    }
+    return json_utils::AppendJsonLine(record, file);
+}
+
+bool GetProcessLimits(const tuwjson::Value& sub_definition, ProcessLimits* limits) noexcept {
+    *limits = ProcessLimits();
+    if (sub_definition.HasMember("nice")) {
+        limits->nice = sub_definition["nice"].GetInt();
+        limits->use_nice = true;
+    }
+    if (sub_definition.HasMember("cpu_affinity")) {
+        for (const tuwjson::Value& cpu : sub_definition["cpu_affinity"])
+            limits->cpu_mask |= 1ULL << cpu.GetInt();
+    }
+    limits->memory_limit_mb = json_utils::GetInt(sub_definition, "memory_limit_mb", 0);
+    limits->cpu_limit = json_utils::GetInt(sub_definition, "cpu_limit", 0);
+    limits->timeout_ms = static_cast<uint32_t>(
+        json_utils::GetInt(sub_definition, "timeout_ms", 0));
+    limits->kill_grace_ms = static_cast<uint32_t>(
+        json_utils::GetInt(sub_definition, "kill_grace_ms", DEFAULT_KILL_GRACE_MS));
+    return !limits->IsEmpty();
+}
+
+bool UseUtf8OnWindows(const tuwjson::Value& sub_definition) noexcept {
+    const char* codepage = json_utils::GetString(sub_definition, "codepage", "");
+    return strcmp(codepage, "utf8") == 0 || strcmp(codepage, "utf-8") == 0;
+}
+
+ExecuteResult ExecuteSubDefinition(const tuwjson::Value& sub_definition,
+                                   const noex::string& cmd,
+                                   const noex::vector<noex::string>& args,
+                                   const Pipeline* pipeline,
+                                   const StdinContent* input,
+                                   Worker** worker,
+                                   OutputLog* log,
+                                   ProgressCallback on_progress,
+                                   void* progress_data) noexcept {
+    TUW_TRACE_SCOPE("Execute");
+    bool use_utf8_on_windows = UseUtf8OnWindows(sub_definition);
+
+    const char* log_path = json_utils::GetString(sub_definition, "output_log", nullptr);
+    if (!log_path)
+        log = nullptr;
+    if (log) {
+        noex::string err = log->Open(log_path);
+        if (!err.empty()) {
+            PrintFmt("[RunCommand] Failed to open output log: %s\n", err.c_str());
+            log = nullptr;
+        }
+    }
+
+    ProgressReporter progress = {
+        json_utils::GetString(sub_definition, "progress_regex", nullptr),
+        on_progress, progress_data
+    };
+    const ProgressReporter* progress_ptr = progress.regex ? &progress : nullptr;
+
+    ProcessLimits limits;
+    const ProcessLimits* limits_ptr =
+        GetProcessLimits(sub_definition, &limits) ? &limits : nullptr;
+
+    const char* worker_cmd = json_utils::GetString(sub_definition, "worker", nullptr);
+    bool use_shell = !worker_cmd && json_utils::GetBool(sub_definition, "shell", true);
+    if (worker_cmd && !*worker)
+        *worker = noex::new_ref<Worker>();
+    ExecuteResult result =
+        (worker_cmd && !*worker) ? LaunchError("Failed to allocate memory for the worker.\n") :
+        worker_cmd ? (*worker)->Run(worker_cmd, args, use_utf8_on_windows, log) :
+        pipeline ? Execute(*pipeline, use_utf8_on_windows, log, progress_ptr, input, limits_ptr) :
+        use_shell ? Execute(cmd, use_utf8_on_windows, log, progress_ptr, input, limits_ptr) :
+        Execute(args, use_utf8_on_windows, log, progress_ptr, input, limits_ptr);
+    if (log)
+        log->Close();
+    ReportResult(sub_definition, cmd, result);
+    return result;
+}
+
+void ReportResult(const tuwjson::Value& sub_definition,
+                  const noex::string& cmd, const ExecuteResult& result) noexcept {
+    const ProcessStats& stats = result.stats;
+    PrintFmt("[RunCommand] Stats: wall %.1fms, user %.1fms, sys %.1fms, "
+             "max RSS %dKB, read blocks %d, write blocks %d\n",
+             stats.wall_time_us / 1000.0, stats.user_time_us / 1000.0,
+             stats.sys_time_us / 1000.0, ClampToInt(stats.max_rss_kb),
+             ClampToInt(stats.read_blocks), ClampToInt(stats.write_blocks));
+    for (size_t i = 0; i < result.stages.size(); i++) {
+        const StageResult& stage = result.stages[i];
+        PrintFmt("[RunCommand] Stage %d: exit code %d, wall %.1fms, user %.1fms, sys %.1fms, "
+                 "max RSS %dKB\n",
+                 static_cast<int>(i + 1), stage.exit_code,
+                 stage.stats.wall_time_us / 1000.0, stage.stats.user_time_us / 1000.0,
+                 stage.stats.sys_time_us / 1000.0, ClampToInt(stage.stats.max_rss_kb));
+    }
+
+    WriteHistory(sub_definition, cmd, result);
+}
+
+void WriteHistory(const tuwjson::Value& sub_definition,
+                  const noex::string& cmd, const ExecuteResult& result) noexcept {
+    const char* history = json_utils::GetString(sub_definition, "history", nullptr);
+    if (!history)
+        return;
+    noex::string err = AppendHistory(
+        history, json_utils::GetString(sub_definition, "label", ""), cmd, result);
+    if (!err.empty())
+        PrintFmt("[RunCommand] Failed to write history: %s\n", err.c_str());
+}
+
+static const char* GetItemValue(const tuwjson::Value& item) noexcept {
+    return json_utils::GetString(item, "value", item["label"].GetString());
+}
+
+// Same format as uiSpinboxValueText()
+static noex::string NumToString(double num, int digits) noexcept {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", digits, num);
+    return buf;
+}
+
+noex::string ConfigValues::GetRawString(int id) noexcept {
+    const tuwjson::Value& comp = m_components[id];
+    const char* comp_id = json_utils::GetString(comp, "id", "");
+    tuwjson::Value* ptr = m_config.GetMemberPtr(comp_id);
+    const tuwjson::Value* items = comp.GetMemberPtr("items");
+    int items_size = items ? static_cast<int>(items->GetArraySize()) : 0;
+    int sel;
+    bool checked;
+    double val;
+    noex::string str;
+
+    switch (comp["type_int"].GetInt()) {
+        case COMP_FILE:
+        case COMP_FOLDER:
+        case COMP_TEXT:
+            if (ptr && ptr->IsString())
+                return ptr->GetString();
+            return json_utils::GetString(comp, "default", "");
+        case COMP_COMBO:
+        case COMP_RADIO:
+            sel = json_utils::GetInt(comp, "default", 0) % items_size;
+            if (ptr && ptr->IsInt() && ptr->GetInt() >= 0 && ptr->GetInt() < items_size)
+                sel = ptr->GetInt();
+            return GetItemValue(items->At(sel));
+        case COMP_CHECK:
+            checked = json_utils::GetBool(comp, "default", false);
+            if (ptr && ptr->IsBool())
+                checked = ptr->GetBool();
+            if (!checked)
+                return "";
+            return json_utils::GetString(comp, "value", comp["label"].GetString());
+        case COMP_CHECK_ARRAY:
+            for (int i = 0; i < items_size; i++) {
+                const tuwjson::Value& item = items->At(i);
+                checked = json_utils::GetBool(item, "default", false);
+                if (ptr && ptr->IsArray() && i < static_cast<int>(ptr->GetArraySize()) &&
+                        ptr->At(i).IsBool())
+                    checked = ptr->At(i).GetBool();
+                if (checked)
+                    str += GetItemValue(item);
+            }
+            return str;
+        case COMP_INT:
+        case COMP_FLOAT: {
+            double min = json_utils::GetDouble(comp, "min", 0.0);
+            double max = json_utils::GetDouble(comp, "max", 100.0);
+            bool is_int = comp["type_int"].GetInt() == COMP_INT;
+            val = json_utils::GetDouble(comp, "default", min);
+            if (ptr && (is_int ? ptr->IsInt() : ptr->IsDouble()))
+                val = ptr->GetDouble();
+            // Spin boxes clamp values.
+            if (val < min)
+                val = min;
+            if (val > max)
+                val = max;
+            return NumToString(val, is_int ? 0 : json_utils::GetInt(comp, "digits", 1));
+        }
+    }
+    return "";
+}
+
+noex::string ConfigValues::GetString(int id, bool use_quotes) noexcept {
+    // The same rules as Component::GetString()
+    const tuwjson::Value& comp = m_components[id];
+    noex::string str = GetRawString(id);
+    if (json_utils::GetBool(comp, "optional", false) && str.empty())
+        return "";
+    if (json_utils::GetBool(comp, "add_quotes", false) && use_quotes)
+        str = noex::concat_cstr("\"", str.c_str(), "\"");
+    return noex::concat_cstr(json_utils::GetString(comp, "prefix", ""), str.c_str(),
+                             json_utils::GetString(comp, "suffix", ""));
+}
+
+noex::string ConfigValues::Validate() noexcept {
+    for (size_t i = 0; i < m_components.GetArraySize(); i++) {
+        const tuwjson::Value& comp = m_components[i];
+        tuwjson::Value* validator_json = comp.GetMemberPtr("validator");
+        if (!validator_json)
+            continue;
+        noex::string str = GetRawString(static_cast<int>(i));
+        if (json_utils::GetBool(comp, "optional", false) && str.empty())
+            continue;
+        Validator validator;
+        validator.Initialize(*validator_json);
+        if (!validator.Validate(str))
+            return noex::concat_cstr(comp["label"].GetString(), ": ",
+                                     validator.GetError().c_str());
+    }
+    return "";
+}
+
+// Returns the index of an item that has the value or the label. -1 if not found.
+static int FindItem(const tuwjson::Value& items, const char* str, size_t len) noexcept {
+    for (int i = 0; i < static_cast<int>(items.GetArraySize()); i++) {
+        const tuwjson::Value& item = items[i];
+        const char* value = GetItemValue(item);
+        const char* label = item["label"].GetString();
+        if ((strlen(value) == len && strncmp(value, str, len) == 0) ||
+            (strlen(label) == len && strncmp(label, str, len) == 0))
+            return i;
+    }
+    return -1;
+}
+
+noex::string SetConfigValue(const tuwjson::Value& sub_definition,
+                            tuwjson::Value& config, const char* id_value) noexcept {
+    const char* eq = strchr(id_value, '=');
+    if (!eq)
+        return noex::concat_cstr("Value should be formatted as id=value. (", id_value, ")");
+    noex::string id(id_value, static_cast<size_t>(eq - id_value));
+    const char* value = eq + 1;
+
+    const tuwjson::Value* comp = nullptr;
+    for (const tuwjson::Value& c : sub_definition["components"]) {
+        if (id == json_utils::GetString(c, "id", "")) {
+            comp = &c;
+            break;
+        }
+    }
+    if (!comp)
+        return noex::concat_cstr("Unknown component id. (", id.c_str(), ")");
+
+    const tuwjson::Value* items = comp->GetMemberPtr("items");
+    tuwjson::Value v;
+    char* end = nullptr;
+    long num;
+    double dnum;
+    int sel;
+    switch ((*comp)["type_int"].GetInt()) {
+        case COMP_FILE:
+        case COMP_FOLDER:
+        case COMP_TEXT:
+            v.SetString(value);
+            config[id.c_str()].MoveFrom(v);
+            return "";
+        case COMP_COMBO:
+        case COMP_RADIO:
+            sel = FindItem(*items, value, strlen(value));
+            if (sel < 0) {
+                // Accept an index as well.
+                num = strtol(value, &end, 10);
+                if (*value && !*end && num >= 0 && num < static_cast<long>(items->GetArraySize()))
+                    sel = static_cast<int>(num);
+            }
+            if (sel < 0)
+                break;
+            v.SetInt(sel);
+            config[id.c_str()].MoveFrom(v);
+            return "";
+        case COMP_CHECK:
+            if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0)
+                v.SetBool(true);
+            else if (strcmp(value, "false") == 0 || strcmp(value, "0") == 0)
+                v.SetBool(false);
+            else
+                break;
+            config[id.c_str()].MoveFrom(v);
+            return "";
+        case COMP_CHECK_ARRAY: {
+            v.SetArray();
+            for (size_t i = 0; i < items->GetArraySize(); i++) {
+                tuwjson::Value b;
+                b.SetBool(false);
+                v.MoveAndPush(b);
+            }
+            const char* token = value;
+            while (*token) {
+                const char* comma = strchr(token, ',');
+                size_t len = comma ? static_cast<size_t>(comma - token) : strlen(token);
+                sel = FindItem(*items, token, len);
+                if (sel < 0)
+                    return noex::concat_cstr("Unknown item for \"", id.c_str(), "\". (") +
+                           noex::string(token, len) + ")";
+                v[sel].SetBool(true);
+                token += len;
+                if (*token)
+                    token++;
+            }
+            config[id.c_str()].MoveFrom(v);
+            return "";
+        }
+        case COMP_INT:
+            num = strtol(value, &end, 10);
+            if (!*value || *end || num < INT_MIN || num > INT_MAX)
+                break;
+            v.SetInt(static_cast<int>(num));
+            config[id.c_str()].MoveFrom(v);
+            return "";
+        case COMP_FLOAT:
+            dnum = strtod(value, &end);
+            if (!*value || *end)
+                break;
+            v.SetDouble(dnum);
+            config[id.c_str()].MoveFrom(v);
+            return "";
+    }
+    return noex::concat_cstr("Invalid value for \"", id.c_str(), "\". (") + value + ")";
+}
@@ -12,6 +12,7 @@ Component::Component(const tuwjson::Value& j) noexcept {
     m_label = j["label"].GetString();
     m_id = json_utils::GetString(j, "id", "");
     m_add_quotes = json_utils::GetBool(j, "add_quotes", false);
+    m_alloc_size = 0;
     tuwjson::Value* ptr = j.GetMemberPtr("validator");
     if (ptr)
         m_validator.Initialize(*ptr);
@@ -20,11 +21,11 @@ Component::Component(const tuwjson::Value& j) noexcept {
     m_suffix = json_utils::GetString(j, "suffix", "");
 }
 
-noex::string Component::GetString() noexcept {
+noex::string Component::GetString(bool use_quotes) noexcept {
     noex::string str = GetRawString();
     if (m_optional && str.empty())
         return "";
-    if (m_add_quotes)
+    if (m_add_quotes && use_quotes)
         str = noex::concat_cstr("\"", str.c_str(), "\"");
     return noex::concat_cstr(m_prefix, str.c_str(), m_suffix);
 }
@@ -65,9 +66,10 @@ void Component::PutErrorWidget(uiBox* box) noexcept {
 
 template <typename CompT>
 Component* NewComp(uiBox* box, const tuwjson::Value& j) noexcept {
-    CompT* comp = reinterpret_cast<CompT*>(calloc(1, sizeof(CompT)));
+    CompT* comp = static_cast<CompT*>(noex::alloc(1, sizeof(CompT), noex::ALLOC_COMPONENT));
     if (comp) {
         new (comp) CompT(box, j);
+        comp->m_alloc_size = sizeof(CompT);
     } else {
         noex::set_error_no(noex::EXTERNAL_ALLOCATION_ERROR);
     }
@@ -103,6 +105,14 @@ Component* Component::PutComponent(uiBox* box, const tuwjson::Value& j) noexcept
     return comp;
 }
 
+void Component::Delete(Component* comp) noexcept {
+    if (!comp)
+        return;
+    size_t size = comp->m_alloc_size;
+    comp->~Component();
+    noex::dealloc(comp, size, noex::ALLOC_COMPONENT);
+}
+
 // Static Text
 StaticText::StaticText(uiBox* box, const tuwjson::Value& j) noexcept
     : Component(j) {
@@ -1,132 +1,809 @@
 #include "exe_container.h"
 #include <cassert>
+#include <cerrno>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
 
+#include "env_utils.h"
 #include "json.h"
+#include "lz_codec.h"
 #include "string_utils.h"
 
+static uint32_t GetUint32(const unsigned char* int_as_bin) noexcept {
+    return static_cast<uint32_t>(int_as_bin[0]) | static_cast<uint32_t>(int_as_bin[1] << 8) |
+           static_cast<uint32_t>(int_as_bin[2] << 16) | static_cast<uint32_t>(int_as_bin[3] << 24);
+}
+
 static uint32_t ReadUint32(FILE* io) noexcept {
     unsigned char int_as_bin[4];
     if (fread(int_as_bin, 1, 4, io) != 4)
         return 0;
-    return static_cast<uint32_t>(int_as_bin[0]) | static_cast<uint32_t>(int_as_bin[1] << 8) |
-           static_cast<uint32_t>(int_as_bin[2] << 16) | static_cast<uint32_t>(int_as_bin[3] << 24);
+    return GetUint32(int_as_bin);
+}
+
+static void SetUint32(unsigned char* int_as_bin, uint32_t num) noexcept {
+    int_as_bin[0] = static_cast<unsigned char>(num & 0xFF);
+    int_as_bin[1] = static_cast<unsigned char>((num >> 8) & 0xFF);
+    int_as_bin[2] = static_cast<unsigned char>((num >> 16) & 0xFF);
+    int_as_bin[3] = static_cast<unsigned char>((num >> 24) & 0xFF);
 }
 
 static void WriteUint32(FILE* io, const uint32_t& num) noexcept {
-    unsigned char int_as_bin[4] = {
-        static_cast<unsigned char>(num & 0xFF),
-        static_cast<unsigned char>((num >> 8) & 0xFF),
-        static_cast<unsigned char>((num >> 16) & 0xFF),
-        static_cast<unsigned char>((num >> 24) & 0xFF)
-    };
+    unsigned char int_as_bin[4];
+    SetUint32(int_as_bin, num);
     fwrite(int_as_bin, 1, 4, io);
 }
 
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
-#define BUF_SIZE 1024
+#define BUF_SIZE (64 * 1024)
 
-static noex::string ReadStr(FILE* io, uint32_t size) noexcept {
-    noex::string str(size);
-    if (fread(str.data(), 1, size, io) != size)
-        return "";
-    return str;
+// ftell() and fseek() with 64-bit offsets
+static int64_t FileTell(FILE* io) noexcept {
+#ifdef _WIN32
+    return _ftelli64(io);
+#else
+    return ftello(io);
+#endif
+}
+
+static int FileSeek(FILE* io, int64_t offset, int origin) noexcept {
+#ifdef _WIN32
+    return _fseeki64(io, offset, origin);
+#else
+    return fseeko(io, static_cast<off_t>(offset), origin);
+#endif
 }
 
 static void WriteStr(FILE* io, const char* str, uint32_t size) noexcept {
     fwrite(str, 1, size, io);
 
     // Zero padding
-    size_t padding = (8 - ftell(io) % 8) % 8;
+    size_t padding = static_cast<size_t>((8 - FileTell(io) % 8) % 8);
     char padding_bytes[8] = { 0 };
     fwrite(padding_bytes, 1, padding, io);
 }
 
-static bool CopyBinary(FILE* reader, FILE* writer, uint32_t size) noexcept {
+#ifdef __linux__
+// Copies bytes without reading them into userspace.
+// Returns the number of copied bytes, which can be smaller than size.
+static uint64_t CopyInKernel(int in_fd, uint64_t in_offset,
+                             int out_fd, uint64_t out_offset, uint64_t size) noexcept {
+#ifdef FICLONE
+    // Share extents with the original file when the filesystem supports reflink.
+    // (e.g. Btrfs and XFS) The embedded data of the original file is truncated.
+    if (in_offset == 0 && out_offset == 0 &&
+        ioctl(out_fd, FICLONE, in_fd) == 0 && ftruncate(out_fd, static_cast<off_t>(size)) == 0)
+        return size;
+#endif
+    uint64_t copied = 0;
+#ifdef SYS_copy_file_range
+    // It can also use reflink or server-side copy on some filesystems.
+    while (copied < size) {
+        loff_t in_off = static_cast<loff_t>(in_offset + copied);
+        loff_t out_off = static_cast<loff_t>(out_offset + copied);
+        long ret = syscall(SYS_copy_file_range, in_fd, &in_off, out_fd, &out_off,
+                           static_cast<size_t>(size - copied), 0u);
+        if (ret <= 0)
+            break;  // Not supported, or the files are on different filesystems.
+        copied += static_cast<uint64_t>(ret);
+    }
+    if (copied == size)
+        return copied;
+#endif
+    // sendfile() writes to the current position of out_fd.
+    if (lseek(out_fd, static_cast<off_t>(out_offset + copied), SEEK_SET) < 0)
+        return copied;
+    off_t in_off = static_cast<off_t>(in_offset + copied);
+    while (copied < size) {
+        // sendfile() transfers at most 0x7ffff000 bytes at once.
+        ssize_t ret = sendfile(out_fd, in_fd, &in_off,
+                               static_cast<size_t>(MIN(size - copied, 0x7ffff000)));
+        if (ret <= 0)
+            break;
+        copied += static_cast<uint64_t>(ret);
+    }
+    return copied;
+}
+#endif  // __linux__
+
+// Copies size bytes at in_offset of reader to the current position of writer.
+// It uses the kernel on Linux, and falls back to userspace copies.
+static bool CopyBinary(FILE* reader, uint64_t in_offset, FILE* writer, uint64_t size) noexcept {
+    int64_t out_offset = FileTell(writer);
+    if (out_offset < 0 || fflush(writer) != 0)
+        return false;
+    uint64_t copied = 0;
+#ifdef __linux__
+    copied = CopyInKernel(fileno(reader), in_offset,
+                          fileno(writer), static_cast<uint64_t>(out_offset), size);
+#endif
+    // Sync the streams with the file offsets.
+    if (FileSeek(reader, static_cast<int64_t>(in_offset + copied), SEEK_SET) != 0 ||
+        FileSeek(writer, out_offset + static_cast<int64_t>(copied), SEEK_SET) != 0)
+        return false;
+    size -= copied;
+
     char buff[BUF_SIZE];
     while (size > 0) {
-        size_t copy_size = MIN(BUF_SIZE, size);
+        size_t copy_size = static_cast<size_t>(MIN(BUF_SIZE, size));
         size_t read_size = fread(buff, 1, copy_size, reader);
         if (read_size != copy_size)
             return false;
-        fwrite(buff, 1, read_size, writer);
-        size -= static_cast<uint32_t>(read_size);
+        if (fwrite(buff, 1, read_size, writer) != read_size)
+            return false;
+        size -= read_size;
     }
     return true;
 }
 
-static uint32_t Length(FILE* io) noexcept {
-    uint32_t cur = ftell(io);
-    fseek(io, 0, SEEK_END);
-    uint32_t len = ftell(io);
-    fseek(io, cur, SEEK_SET);
+// Replaces new_path with old_path.
+static bool RenameFile(const noex::string& old_path, const noex::string& new_path) noexcept {
+#ifdef _WIN32
+    noex::wstring old_wpath = UTF8toUTF16(old_path.c_str());
+    noex::wstring new_wpath = UTF8toUTF16(new_path.c_str());
+    return MoveFileExW(old_wpath.c_str(), new_wpath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(old_path.c_str(), new_path.c_str()) == 0;
+#endif
+}
+
+static void RemoveFile(const noex::string& path) noexcept {
+#ifdef _WIN32
+    _wremove(UTF8toUTF16(path.c_str()).c_str());
+#else
+    remove(path.c_str());
+#endif
+}
+
+// Flushes the stream and waits until the data is stored on the disk.
+static bool SyncFile(FILE* io) noexcept {
+    if (fflush(io) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(io)) == 0;
+#else
+    return fsync(fileno(io)) == 0;
+#endif
+}
+
+static bool TruncateFile(FILE* io, uint64_t size) noexcept {
+    if (fflush(io) != 0)
+        return false;
+#ifdef _WIN32
+    return _chsize_s(_fileno(io), static_cast<int64_t>(size)) == 0;
+#else
+    return ftruncate(fileno(io), static_cast<off_t>(size)) == 0;
+#endif
+}
+
+static int64_t Length(FILE* io) noexcept {
+    int64_t cur = FileTell(io);
+    FileSeek(io, 0, SEEK_END);
+    int64_t len = FileTell(io);
+    FileSeek(io, cur, SEEK_SET);
     return len;
 }
 
-constexpr uint32_t EXE_SIZE_MAX = 20000000;  // Allowed size of exe
+// Gets XXH64 of the first size bytes of the file.
+static bool HashBinary(FILE* io, uint64_t size, uint64_t* hash) noexcept {
+    if (FileSeek(io, 0, SEEK_SET) != 0)
+        return false;
+    XxHash64 xxh;
+    char buff[BUF_SIZE];
+    while (size > 0) {
+        size_t read_size = static_cast<size_t>(MIN(BUF_SIZE, size));
+        if (fread(buff, 1, read_size, io) != read_size)
+            return false;
+        xxh.Update(buff, read_size);
+        size -= read_size;
+    }
+    *hash = xxh.Digest();
+    return true;
+}
+
 constexpr uint32_t JSON_MAGIC = 0x4A534F4E;  // 'J', 'S', 'O', 'N'
 
+// Embedded data is stored at the end of the exe.
+// [exe][magic, json size, hash (low, high)][json][padding][offset to exe end, magic]
+// The offset is stored as a negative 32-bit value as it's smaller than the max json size.
+// The high bit of the json size means the json is compressed. ("merge --compress")
+// Compressed data is [json size][LZ sequences]. The hash is for the uncompressed json.
+// The second bit means the header version 2 that has a 64-bit hash. (XXH64)
+// Old headers have a 32-bit hash (FNV-1) instead. Old versions of Tuw reject new headers
+// as they have too large json size.
+// The third bit means the header is followed by XXH64 of the original exe (low, high).
+// It tells whether two files were made from the same exe without reading them.
+constexpr uint64_t HEADER_SIZE = 16;
+constexpr uint64_t HEADER_SIZE_V1 = 12;
+constexpr uint64_t BASE_HASH_SIZE = 8;
+constexpr uint32_t JSON_COMPRESSED = 0x80000000;
+constexpr uint32_t JSON_HEADER_V2 = 0x40000000;
+constexpr uint32_t JSON_BASE_HASH = 0x20000000;
+constexpr uint64_t TRAILER_SIZE = 8;
+constexpr uint64_t TAIL_SIZE_MAX =
+    HEADER_SIZE + BASE_HASH_SIZE + JSON_SIZE_MAX + 8 + TRAILER_SIZE;
+
+// Resources are stored between the exe and the json header.
+// [exe][padding][resource][padding][resource]...[table of contents][footer][json header]...
+// Each entry of the table is [offset (low, high)][size (low, high)][hash (low, high)]
+// [name size][name][padding]. Hashes are XXH64 of the resources.
+// The footer is [exe size (low, high)][resource count][table size][magic]
+// Old versions of Tuw treat resources as a part of the exe.
+constexpr uint32_t RESOURCE_MAGIC = 0x43525352;  // 'R', 'S', 'R', 'C'
+constexpr uint64_t FOOTER_SIZE = 20;
+constexpr uint64_t TOC_ENTRY_SIZE = 28;
+constexpr uint32_t TOC_SIZE_MAX = 1024 * 1024;
+constexpr size_t RESOURCE_NAME_MAX = 255;
+// Maps more than embedded json to read small tables of contents without pread().
+constexpr uint64_t TAIL_MAP_SIZE = TAIL_SIZE_MAX + 64 * 1024;
+
+static uint64_t Align8(uint64_t n) noexcept {
+    return (n + 7) / 8 * 8;
+}
+
+// Read-only view of a file.
+// It maps only the pages that we need, (e.g. embedded data at the end of the exe)
+// so reading them costs a few page faults even for large executables.
+// It falls back to pread() when the file can't be mapped.
+class FileView {
+ private:
+    FILE* m_io;
+    uint64_t m_file_size;
+    // File offset of m_map
+    uint64_t m_map_offset;
+    const unsigned char* m_map;
+    size_t m_map_size;
+#ifdef _WIN32
+    HANDLE m_mapping;
+#endif
+
+    bool IsMapped(uint64_t offset, size_t size) const noexcept {
+        return m_map && offset >= m_map_offset && offset - m_map_offset <= m_map_size &&
+               size <= m_map_size - (offset - m_map_offset);
+    }
+
+ public:
+    FileView() noexcept : m_io(nullptr), m_file_size(0),
+        m_map_offset(0), m_map(nullptr), m_map_size(0)
+#ifdef _WIN32
+        , m_mapping(nullptr)
+#endif
+        {}
+    ~FileView() noexcept;
+
+    // Returns an empty string if succeed. An error message otherwise.
+    noex::string Open(const noex::string& path) noexcept;
+
+    // Maps a range of the file. Call this only once.
+    // Bytes out of the range will be read with pread().
+    void Map(uint64_t offset, uint64_t size) noexcept;
+
+    uint64_t GetFileSize() const noexcept {
+        return m_file_size;
+    }
+
+    // Copies bytes at the offset. Returns false when they are out of the file.
+    bool Read(uint64_t offset, void* buf, size_t size) noexcept;
+
+    // Returns bytes at the offset, or nullptr when they are out of the file.
+    // It returns mapped pages as is. Otherwise, it copies the bytes to buf.
+    const char* GetData(uint64_t offset, size_t size, noex::string* buf) noexcept;
+};
+
+#ifdef _WIN32
+noex::string FileView::Open(const noex::string& path) noexcept {
+    m_io = FileOpen(path.c_str(), FILE_MODE_READ);
+    if (!m_io)
+        return GetFileError(path);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(m_io))), &size))
+        return "Failed to get the file size: " + path;
+    m_file_size = static_cast<uint64_t>(size.QuadPart);
+    return "";
+}
+
+void FileView::Map(uint64_t offset, uint64_t size) noexcept {
+    if (size == 0 || offset > m_file_size || size > m_file_size - offset)
+        return;
+    HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(m_io)));
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping)
+        return;
+    // Views should start at a multiple of the allocation granularity.
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    uint64_t start = offset / info.dwAllocationGranularity * info.dwAllocationGranularity;
+    size_t map_size = static_cast<size_t>(offset + size - start);
+    void* map = MapViewOfFile(m_mapping, FILE_MAP_READ,
+                              static_cast<DWORD>(start >> 32),
+                              static_cast<DWORD>(start & 0xFFFFFFFF), map_size);
+    if (!map)
+        return;
+    m_map = static_cast<const unsigned char*>(map);
+    m_map_offset = start;
+    m_map_size = map_size;
+}
+
+FileView::~FileView() noexcept {
+    if (m_map)
+        UnmapViewOfFile(m_map);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_io)
+        fclose(m_io);
+}
+#else  // _WIN32
+noex::string FileView::Open(const noex::string& path) noexcept {
+    m_io = FileOpen(path.c_str(), FILE_MODE_READ);
+    if (!m_io)
+        return GetFileError(path);
+    struct stat st;
+    if (fstat(fileno(m_io), &st) != 0)
+        return GetFileError(path);
+    m_file_size = static_cast<uint64_t>(st.st_size);
+    return "";
+}
+
+void FileView::Map(uint64_t offset, uint64_t size) noexcept {
+    if (size == 0 || offset > m_file_size || size > m_file_size - offset)
+        return;
+    // Mappings should start at a multiple of the page size.
+    uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = offset / page_size * page_size;
+    size_t map_size = static_cast<size_t>(offset + size - start);
+    void* map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE,
+                     fileno(m_io), static_cast<off_t>(start));
+    if (map == MAP_FAILED)
+        return;
+    m_map = static_cast<const unsigned char*>(map);
+    m_map_offset = start;
+    m_map_size = map_size;
+}
+
+FileView::~FileView() noexcept {
+    if (m_map)
+        munmap(const_cast<unsigned char*>(m_map), m_map_size);
+    if (m_io)
+        fclose(m_io);
+}
+#endif  // _WIN32
+
+const char* FileView::GetData(uint64_t offset, size_t size, noex::string* buf) noexcept {
+    if (IsMapped(offset, size))
+        return reinterpret_cast<const char*>(m_map + (offset - m_map_offset));
+    *buf = noex::string(size);
+    if (buf->size() != size || !Read(offset, buf->data(), size))
+        return nullptr;
+    return buf->data();
+}
+
+bool FileView::Read(uint64_t offset, void* buf, size_t size) noexcept {
+    if (offset > m_file_size || size > m_file_size - offset)
+        return false;
+    if (IsMapped(offset, size)) {
+        memcpy(buf, m_map + (offset - m_map_offset), size);
+        return true;
+    }
+#ifdef _WIN32
+    if (FileSeek(m_io, static_cast<int64_t>(offset), SEEK_SET) != 0)
+        return false;
+    return fread(buf, 1, size, m_io) == size;
+#else
+    ssize_t read_size = pread(fileno(m_io), buf, size, static_cast<off_t>(offset));
+    return read_size >= 0 && static_cast<size_t>(read_size) == size;
+#endif
+}
+
+// Json data to embed
+struct Payload {
+    const char* data;
+    uint32_t size;
+    // Hash of the uncompressed json
+    uint64_t hash;
+    bool compressed;
+    // Hash of the original exe
+    uint64_t base_hash;
+};
+
+static void WriteJsonData(FILE* io, uint64_t exe_size, const Payload& payload) noexcept {
+    if (payload.size == 0)
+        return;
+    WriteUint32(io, JSON_MAGIC);
+    uint32_t size_and_flags = payload.size | JSON_HEADER_V2 | JSON_BASE_HASH;
+    WriteUint32(io, payload.compressed ? size_and_flags | JSON_COMPRESSED : size_and_flags);
+    WriteUint32(io, static_cast<uint32_t>(payload.hash & 0xFFFFFFFF));
+    WriteUint32(io, static_cast<uint32_t>(payload.hash >> 32));
+    WriteUint32(io, static_cast<uint32_t>(payload.base_hash & 0xFFFFFFFF));
+    WriteUint32(io, static_cast<uint32_t>(payload.base_hash >> 32));
+    WriteStr(io, payload.data, payload.size);
+    WriteUint32(io, static_cast<uint32_t>(exe_size - FileTell(io) - 8));
+    WriteUint32(io, JSON_MAGIC);
+}
+
+// Journal for in-place updates. ("<exe path>.journal")
+// It keeps the old embedded data to restore it when Tuw stops while updating the exe.
+// [magic, exe size (low, high), data size, exe hash (low, high)][data][magic]
+// The hash is XXH64 of the first "exe size" bytes, which the update never changes.
+// It prevents a stale journal from overwriting another file at the same path.
+constexpr uint64_t JOURNAL_HEADER_SIZE = 24;
+
+static noex::string GetJournalPath(const noex::string& exe_path) noexcept {
+    return exe_path + ".journal";
+}
+
+static bool WriteJournal(const noex::string& journal_path, uint64_t exe_size,
+                         uint64_t exe_hash, const noex::string& data) noexcept {
+    FILE* io = FileOpen(journal_path.c_str(), FILE_MODE_WRITE);
+    if (!io)
+        return false;
+    WriteUint32(io, JSON_MAGIC);
+    WriteUint32(io, static_cast<uint32_t>(exe_size & 0xFFFFFFFF));
+    WriteUint32(io, static_cast<uint32_t>(exe_size >> 32));
+    WriteUint32(io, static_cast<uint32_t>(data.size()));
+    WriteUint32(io, static_cast<uint32_t>(exe_hash & 0xFFFFFFFF));
+    WriteUint32(io, static_cast<uint32_t>(exe_hash >> 32));
+    fwrite(data.data(), 1, data.size(), io);
+    WriteUint32(io, JSON_MAGIC);
+    bool ok = !ferror(io) && SyncFile(io);
+    fclose(io);
+    return ok;
+}
+
+// Restores embedded data from the journal. Returns true if succeeded.
+// The journal is kept until the caller reads the restored exe.
+// Incomplete journals are removed as the exe was not modified yet,
+// and so are journals of other files. (The size or the hash of the exe doesn't match.)
+static bool RecoverFromJournal(const noex::string& exe_path) noexcept {
+    noex::string journal_path = GetJournalPath(exe_path);
+    FILE* io = FileOpen(journal_path.c_str(), FILE_MODE_READ);
+    if (!io)
+        return false;
+    uint32_t magic = ReadUint32(io);
+    uint64_t exe_size = ReadUint32(io);
+    exe_size |= static_cast<uint64_t>(ReadUint32(io)) << 32;
+    uint32_t data_size = ReadUint32(io);
+    uint64_t exe_hash = ReadUint32(io);
+    exe_hash |= static_cast<uint64_t>(ReadUint32(io)) << 32;
+    bool ok = magic == JSON_MAGIC && data_size <= TAIL_SIZE_MAX &&
+              Length(io) == static_cast<int64_t>(JOURNAL_HEADER_SIZE + data_size + 4);
+    noex::string data;
+    if (ok) {
+        data = noex::string(data_size);
+        ok = data.size() == data_size &&
+             fread(data.data(), 1, data_size, io) == data_size &&
+             ReadUint32(io) == JSON_MAGIC;
+    }
+    fclose(io);
+
+    if (ok) {
+        io = FileOpen(exe_path.c_str(), FILE_MODE_UPDATE);
+        if (!io)
+            return false;
+        // The update only rewrites data after exe_size.
+        int64_t len = Length(io);
+        uint64_t hash = 0;
+        ok = len >= static_cast<int64_t>(exe_size) &&
+             static_cast<uint64_t>(len) - exe_size <= TAIL_SIZE_MAX &&
+             HashBinary(io, exe_size, &hash) && hash == exe_hash;
+        if (ok) {
+            bool restored = TruncateFile(io, exe_size) &&
+                            FileSeek(io, static_cast<int64_t>(exe_size), SEEK_SET) == 0 &&
+                            fwrite(data.data(), 1, data_size, io) == data_size &&
+                            SyncFile(io);
+            fclose(io);
+            return restored;
+        }
+        fclose(io);
+    }
+    RemoveFile(journal_path);
+    return false;
+}
+
+// Rewrites only embedded data. The old data is kept in the journal while updating.
+static noex::string UpdateExe(FILE* io, const noex::string& exe_path, uint64_t exe_size,
+                              const Payload& payload) noexcept {
+    int64_t end_off = Length(io);
+    if (end_off < static_cast<int64_t>(exe_size) ||
+        static_cast<uint64_t>(end_off) - exe_size > TAIL_SIZE_MAX)
+        return "Unexpected exe size: " + noex::to_string(static_cast<size_t>(exe_size));
+
+    noex::string old_data(static_cast<size_t>(static_cast<uint64_t>(end_off) - exe_size));
+    if (FileSeek(io, static_cast<int64_t>(exe_size), SEEK_SET) != 0 ||
+        fread(old_data.data(), 1, old_data.size(), io) != old_data.size())
+        return "Failed to read the executable: " + exe_path;
+    if (!old_data.empty()) {
+        uint32_t magic = GetUint32(reinterpret_cast<const unsigned char*>(old_data.data()));
+        if (magic != JSON_MAGIC)
+            return "Invalid magic: " + noex::to_string(magic);
+    }
+
+    uint64_t exe_hash;
+    if (!HashBinary(io, exe_size, &exe_hash))
+        return "Failed to read the executable: " + exe_path;
+    noex::string journal_path = GetJournalPath(exe_path);
+    if (!WriteJournal(journal_path, exe_size, exe_hash, old_data)) {
+        RemoveFile(journal_path);
+        return "Failed to write " + journal_path;
+    }
+    if (!TruncateFile(io, exe_size) ||
+        FileSeek(io, static_cast<int64_t>(exe_size), SEEK_SET) != 0)
+        return "Failed to truncate the executable: " + exe_path;
+    WriteJsonData(io, exe_size, payload);
+    if (ferror(io) || !SyncFile(io))
+        return "Failed to write the executable: " + exe_path;
+    RemoveFile(journal_path);
+    return "";
+}
+
 noex::string ExeContainer::Read(const noex::string& exe_path) noexcept {
     if (noex::get_error_no() != noex::OK) {
         // Reject the operation as the exe_path might have an unexpected value.
         return "Fatal error has occurred while editing strings or vectors.";
     }
 
-    m_exe_path = exe_path;
-    FILE* file_io = FileOpen(exe_path.c_str(), FILE_MODE_READ);
-    if (!file_io)
-        return GetFileError(exe_path);
+    noex::string err = ReadData(exe_path);
+    // Tuw might have stopped while updating the exe.
+    if ((!err.empty() || !HasJson()) && RecoverFromJournal(exe_path)) {
+        err = ReadData(exe_path);
+        if (err.empty())
+            RemoveFile(GetJournalPath(exe_path));
+    }
+    return err;
+}
+
+void ExeContainer::CopyFrom(const ExeContainer& other) noexcept {
+    m_exe_path = other.m_exe_path;
+    m_base_size = other.m_base_size;
+    m_exe_size = other.m_exe_size;
+    m_json.CopyFrom(other.m_json);
+    m_compress = other.m_compress;
+    m_resources.clear();
+    for (const Resource& res : other.m_resources)
+        m_resources.push_back(res);
+    m_resources_changed = other.m_resources_changed;
+    m_base_hash = other.m_base_hash;
+    m_has_base_hash = other.m_has_base_hash;
+}
 
-    // Read the last 4 bytes
-    fseek(file_io, 0, SEEK_END);
-    uint32_t end_off = ftell(file_io);
-    fseek(file_io, -4, SEEK_CUR);
-    uint32_t magic = ReadUint32(file_io);
+noex::string ExeContainer::ReadData(const noex::string& exe_path) noexcept {
+    m_exe_path = exe_path;
+    m_resources.clear();
+    m_resources_changed = false;
+    m_base_hash = 0;
+    m_has_base_hash = false;
+    FileView file;
+    noex::string err = file.Open(exe_path);
+    if (!err.empty())
+        return err;
 
-    if (magic != JSON_MAGIC) {
+    // Read the trailer
+    uint64_t end_off = file.GetFileSize();
+    m_base_size = end_off;
+    file.Map(end_off - MIN(end_off, TAIL_MAP_SIZE), MIN(end_off, TAIL_MAP_SIZE));
+    unsigned char trailer[TRAILER_SIZE];
+    if (end_off < TRAILER_SIZE + HEADER_SIZE_V1 ||
+        !file.Read(end_off - TRAILER_SIZE, trailer, TRAILER_SIZE) ||
+        GetUint32(trailer + 4) != JSON_MAGIC) {
         // Json data not found
         m_exe_size = end_off;
-        fclose(file_io);
         return "";
     }
 
-    // Read exe size
-    fseek(file_io, -8, SEEK_CUR);
-    m_exe_size = end_off + ReadUint32(file_io);
-    if (EXE_SIZE_MAX <= m_exe_size || end_off < m_exe_size) {
-        fclose(file_io);
-        return "Unexpected exe size: " + noex::to_string(m_exe_size);
-    }
-    fseek(file_io, m_exe_size, SEEK_SET);
+    // Get exe size
+    uint64_t tail_size = static_cast<uint32_t>(0u - GetUint32(trailer));
+    if (end_off < tail_size || TAIL_SIZE_MAX < tail_size)
+        return "Unexpected exe size: " + noex::to_string(static_cast<size_t>(end_off - tail_size));
+    m_exe_size = end_off - tail_size;
+    m_base_size = m_exe_size;
 
     // Read a header for json data
-    magic = ReadUint32(file_io);
-    if (magic != JSON_MAGIC) {
-        fclose(file_io);
+    unsigned char header[HEADER_SIZE + BASE_HASH_SIZE];
+    if (!file.Read(m_exe_size, header, HEADER_SIZE))
+        return "Unexpected exe size: " + noex::to_string(static_cast<size_t>(m_exe_size));
+    uint32_t magic = GetUint32(header);
+    if (magic != JSON_MAGIC)
         return "Invalid magic: " + noex::to_string(magic);
-    }
 
-    uint32_t json_size = ReadUint32(file_io);
-    uint32_t stored_hash = ReadUint32(file_io);
-    if (JSON_SIZE_MAX <= json_size || end_off < m_exe_size + json_size + 20) {
-        fclose(file_io);
-        return "Unexpected json size: " + noex::to_string(json_size);
+    uint32_t json_size = GetUint32(header + 4);
+    bool compressed = (json_size & JSON_COMPRESSED) != 0;
+    bool is_v2 = (json_size & JSON_HEADER_V2) != 0;
+    bool has_base_hash = is_v2 && (json_size & JSON_BASE_HASH) != 0;
+    json_size &= ~(JSON_COMPRESSED | JSON_HEADER_V2 | (is_v2 ? JSON_BASE_HASH : 0));
+    uint64_t header_size = is_v2 ? HEADER_SIZE : HEADER_SIZE_V1;
+    uint64_t stored_hash = GetUint32(header + 8);
+    if (is_v2)
+        stored_hash |= static_cast<uint64_t>(GetUint32(header + 12)) << 32;
+    if (has_base_hash) {
+        if (!file.Read(m_exe_size + HEADER_SIZE, header + HEADER_SIZE, BASE_HASH_SIZE))
+            return "Unexpected exe size: " + noex::to_string(static_cast<size_t>(m_exe_size));
+        header_size += BASE_HASH_SIZE;
     }
+    if (JSON_SIZE_MAX <= json_size || (compressed && json_size < 4) ||
+        end_off < m_exe_size + json_size + header_size + TRAILER_SIZE)
+        return "Unexpected json size: " + noex::to_string(json_size);
 
-    // Read json data
-    noex::string json_str = ReadStr(file_io, json_size);
-    fclose(file_io);
+    // Read json data. Compressed data is decoded from mapped pages to the json buffer.
+    noex::string buf;
+    const char* data = file.GetData(m_exe_size + header_size, json_size, &buf);
+    if (!data)
+        return "Failed to read JSON data: " + exe_path;
 
-    if (json_str.length() != json_size)
-        return "Unexpected char detected.";
+    noex::string json_str;
+    if (compressed) {
+        uint32_t raw_size = GetUint32(reinterpret_cast<const unsigned char*>(data));
+        if (JSON_SIZE_MAX <= raw_size)
+            return "Unexpected json size: " + noex::to_string(raw_size);
+        json_str = noex::string(raw_size);
+        if (json_str.length() != raw_size)
+            return "Unexpected char detected.";
+        if (!LzDecompress(data + 4, json_size - 4, json_str.data(), raw_size))
+            return "Failed to decompress JSON data: " + exe_path;
+    } else {
+        json_str = noex::string(data, json_size);
+        if (json_str.length() != json_size)
+            return "Unexpected char detected.";
+    }
 
-    if (stored_hash != Fnv1Hash32(json_str))
-        return "Invalid JSON hash: " + noex::to_string(stored_hash);
+    uint64_t hash = is_v2 ? XxHash64::Hash(json_str.data(), json_str.size())
+                          : Fnv1Hash32(json_str);
+    if (stored_hash != hash)
+        return "Invalid JSON hash: " + noex::to_string(static_cast<size_t>(stored_hash));
 
     tuwjson::Parser parser;
     parser.ParseJson(json_str, &m_json);
     if (parser.HasError())
         return noex::concat_cstr("Failed to parse JSON: ", parser.GetErrMsg());
 
+    // HasSameExe() compares the recorded hash without reading the exe.
+    if (has_base_hash) {
+        m_base_hash = GetUint32(header + 16) | static_cast<uint64_t>(GetUint32(header + 20)) << 32;
+        m_has_base_hash = true;
+    }
+    return ReadResourceTable(file);
+}
+
+noex::string ExeContainer::ReadResourceTable(FileView& file) noexcept {
+    // Read the footer of resources
+    unsigned char footer[FOOTER_SIZE];
+    if (m_exe_size < FOOTER_SIZE ||
+        !file.Read(m_exe_size - FOOTER_SIZE, footer, FOOTER_SIZE) ||
+        GetUint32(footer + 16) != RESOURCE_MAGIC)
+        return "";  // No resources
+
+    uint64_t base_size = GetUint32(footer) | static_cast<uint64_t>(GetUint32(footer + 4)) << 32;
+    uint32_t count = GetUint32(footer + 8);
+    uint32_t toc_size = GetUint32(footer + 12);
+    if (TOC_SIZE_MAX < toc_size || m_exe_size - FOOTER_SIZE < toc_size ||
+        m_exe_size - FOOTER_SIZE - toc_size < base_size ||
+        toc_size / TOC_ENTRY_SIZE < count)
+        return "Invalid resource table: " + m_exe_path;
+    uint64_t toc_offset = m_exe_size - FOOTER_SIZE - toc_size;
+
+    noex::string buf;
+    const unsigned char* toc = reinterpret_cast<const unsigned char*>(
+        file.GetData(toc_offset, toc_size, &buf));
+    if (!toc)
+        return "Failed to read the resource table: " + m_exe_path;
+
+    uint64_t pos = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (toc_size - pos < TOC_ENTRY_SIZE)
+            return "Invalid resource table: " + m_exe_path;
+        const unsigned char* entry = toc + pos;
+        Resource res;
+        res.offset = GetUint32(entry) | static_cast<uint64_t>(GetUint32(entry + 4)) << 32;
+        res.size = GetUint32(entry + 8) | static_cast<uint64_t>(GetUint32(entry + 12)) << 32;
+        res.hash = GetUint32(entry + 16) | static_cast<uint64_t>(GetUint32(entry + 20)) << 32;
+        uint32_t name_size = GetUint32(entry + 24);
+        pos += TOC_ENTRY_SIZE;
+        if (RESOURCE_NAME_MAX < name_size || toc_size < Align8(pos + name_size) ||
+            res.offset < base_size || toc_offset < res.offset ||
+            toc_offset - res.offset < res.size)
+            return "Invalid resource table: " + m_exe_path;
+        res.name = noex::string(reinterpret_cast<const char*>(toc + pos), name_size);
+        if (!IsValidResourceName(res.name.c_str()))
+            return "Invalid resource name: " + res.name;
+        pos = Align8(pos + name_size);
+        m_resources.emplace_back(res);
+    }
+    m_base_size = base_size;
+    return "";
+}
+
+static void WritePadding(FILE* io) noexcept {
+    static const char zeros[8] = {};
+    int64_t pos = FileTell(io);
+    if (pos >= 0)
+        fwrite(zeros, 1, static_cast<size_t>(Align8(static_cast<uint64_t>(pos)) - pos), io);
+}
+
+// Copies the original exe and appends resources and json data.
+// Resources are copied from their files or the original exe.
+// new_offsets will have offsets of the resources, and json_offset will have the header offset.
+static noex::string WriteExe(FILE* old_io, FILE* new_io, uint64_t base_size, uint64_t exe_size,
+                             const noex::vector<Resource>& resources,
+                             noex::vector<uint64_t>* new_offsets, uint64_t* json_offset,
+                             const Payload& payload) noexcept {
+    if (static_cast<int64_t>(exe_size) != Length(old_io)) {
+        if (FileSeek(old_io, static_cast<int64_t>(exe_size), SEEK_SET) != 0)
+            return "Failed to read the original executable.";
+        uint32_t magic = ReadUint32(old_io);
+        if (magic != JSON_MAGIC)
+            return "Invalid magic: " + noex::to_string(magic);
+    }
+
+    if (!CopyBinary(old_io, 0, new_io, base_size))
+        return "Failed to copy the original executable.";
+
+    // Resources are meaningless without json.
+    if (payload.size == 0 || resources.empty()) {
+        *json_offset = base_size;
+        WriteJsonData(new_io, base_size, payload);
+        if (ferror(new_io))
+            return "Failed to write the executable.";
+        return "";
+    }
+
+    for (const Resource& res : resources) {
+        WritePadding(new_io);
+        new_offsets->push_back(static_cast<uint64_t>(FileTell(new_io)));
+        bool ok;
+        if (res.path.empty()) {
+            ok = CopyBinary(old_io, res.offset, new_io, res.size);
+        } else {
+            FILE* res_io = FileOpen(res.path.c_str(), FILE_MODE_READ);
+            if (!res_io)
+                return GetFileError(res.path);
+            ok = Length(res_io) == static_cast<int64_t>(res.size) &&
+                 CopyBinary(res_io, 0, new_io, res.size);
+            fclose(res_io);
+        }
+        if (!ok)
+            return "Failed to copy the resource: " + res.name;
+    }
+
+    // Write the table of contents and the footer.
+    WritePadding(new_io);
+    int64_t toc_offset = FileTell(new_io);
+    for (size_t i = 0; i < resources.size(); i++) {
+        const Resource& res = resources[i];
+        uint64_t offset = (*new_offsets)[i];
+        uint32_t name_size = static_cast<uint32_t>(res.name.size());
+        WriteUint32(new_io, static_cast<uint32_t>(offset & 0xFFFFFFFF));
+        WriteUint32(new_io, static_cast<uint32_t>(offset >> 32));
+        WriteUint32(new_io, static_cast<uint32_t>(res.size & 0xFFFFFFFF));
+        WriteUint32(new_io, static_cast<uint32_t>(res.size >> 32));
+        WriteUint32(new_io, static_cast<uint32_t>(res.hash & 0xFFFFFFFF));
+        WriteUint32(new_io, static_cast<uint32_t>(res.hash >> 32));
+        WriteUint32(new_io, name_size);
+        WriteStr(new_io, res.name.data(), name_size);
+        WritePadding(new_io);
+    }
+    int64_t toc_size = FileTell(new_io) - toc_offset;
+    if (toc_size > static_cast<int64_t>(TOC_SIZE_MAX))
+        return "Too many resources: " + noex::to_string(resources.size());
+    WriteUint32(new_io, static_cast<uint32_t>(base_size & 0xFFFFFFFF));
+    WriteUint32(new_io, static_cast<uint32_t>(base_size >> 32));
+    WriteUint32(new_io, static_cast<uint32_t>(resources.size()));
+    WriteUint32(new_io, static_cast<uint32_t>(toc_size));
+    WriteUint32(new_io, RESOURCE_MAGIC);
+
+    *json_offset = static_cast<uint64_t>(FileTell(new_io));
+    WriteJsonData(new_io, *json_offset, payload);
+    if (ferror(new_io))
+        return "Failed to write the executable.";
     return "";
 }
 
@@ -150,48 +827,301 @@ noex::string ExeContainer::Write(const noex::string& exe_path) noexcept {
 
     if (JSON_SIZE_MAX <= json_size)
         return "Unexpected json size: " + noex::to_string(json_size);
+    if (json_size > 0) {
+        noex::string err = ComputeBaseHash();
+        if (!err.empty())
+            return err;
+    }
+
+    Payload payload = { json_buffer, json_size, XxHash64::Hash(json_buffer, json_size), false,
+                        m_base_hash };
+    noex::string compressed(m_compress && json_size > 0 ? 4 + LzCompressBound(json_size) : 0);
+    if (!compressed.empty()) {
+        unsigned char* buf = reinterpret_cast<unsigned char*>(compressed.data());
+        size_t size = LzCompress(json_buffer, json_size, compressed.data() + 4, compressed.size() - 4);
+        // Store the raw json when it's not compressible.
+        if (size > 0 && size + 4 < json_size) {
+            SetUint32(buf, json_size);
+            payload.data = compressed.data();
+            payload.size = static_cast<uint32_t>(size + 4);
+            payload.compressed = true;
+        }
+    }
+
+    // Resources are kept in place when only json is changed.
+    bool keep_resources = !m_resources_changed && (json_size > 0 || m_resources.empty());
+    if (exe_path == m_exe_path && keep_resources) {
+        // Rewrite only embedded data when we can open the exe. (O(json size))
+        // Running executables might not be writable.
+        FILE* io = FileOpen(exe_path.c_str(), FILE_MODE_UPDATE);
+        if (io) {
+            noex::string err = UpdateExe(io, exe_path, m_exe_size, payload);
+            fclose(io);
+            return err;
+        }
+    }
 
     FILE* old_io = FileOpen(m_exe_path.c_str(), FILE_MODE_READ);
     if (!old_io)
         return GetFileError(m_exe_path);
 
-    FILE* new_io = FileOpen(exe_path.c_str(), FILE_MODE_WRITE);
+    // Write to a temporary file, and rename it when it's completed.
+    // So, the output is never left broken, and it can be the same as the original file.
+    noex::string tmp_path = exe_path + ".tmp";
+    FILE* new_io = FileOpen(tmp_path.c_str(), FILE_MODE_WRITE);
     if (!new_io) {
         fclose(old_io);
-        return GetFileError(exe_path);
+        return GetFileError(tmp_path);
+    }
+
+    noex::vector<uint64_t> new_offsets;
+    uint64_t json_offset = 0;
+    noex::string err = WriteExe(old_io, new_io, m_base_size, m_exe_size,
+                                m_resources, &new_offsets, &json_offset, payload);
+    fclose(old_io);
+    if (fclose(new_io) != 0 && err.empty())
+        err = "Failed to write " + tmp_path;
+    if (err.empty() && !RenameFile(tmp_path, exe_path))
+        err = "Failed to rename " + tmp_path + " to " + exe_path;
+    if (!err.empty()) {
+        RemoveFile(tmp_path);
+        return err;
     }
     m_exe_path = exe_path;
+    m_exe_size = json_offset;
+    // Resources are in the new exe now.
+    if (new_offsets.size() != m_resources.size())
+        m_resources.clear();
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        m_resources[i].offset = new_offsets[i];
+        m_resources[i].path.clear();
+    }
+    m_resources_changed = false;
+    return "";
+}
 
-    bool ok = CopyBinary(old_io, new_io, m_exe_size);
-    if (!ok) {
-        fclose(old_io);
-        fclose(new_io);
-        return "Failed to copy the original executable: " + m_exe_path;
+noex::string ExeContainer::ComputeBaseHash() noexcept {
+    if (m_has_base_hash)
+        return "";
+    assert(!m_exe_path.empty());
+    FILE* io = FileOpen(m_exe_path.c_str(), FILE_MODE_READ);
+    if (!io)
+        return GetFileError(m_exe_path);
+    bool ok = HashBinary(io, m_base_size, &m_base_hash);
+    fclose(io);
+    if (!ok)
+        return "Failed to read the executable: " + m_exe_path;
+    m_has_base_hash = true;
+    return "";
+}
+
+bool ExeContainer::HasSameExe(ExeContainer& other) noexcept {
+    if (m_base_size != other.m_base_size || m_exe_path.empty() || other.m_exe_path.empty())
+        return false;
+    return ComputeBaseHash().empty() && other.ComputeBaseHash().empty() &&
+           m_base_hash == other.m_base_hash;
+}
+
+bool IsValidResourceName(const char* name) noexcept {
+    size_t len = 0;
+    for (; name[len]; len++) {
+        char c = name[len];
+        if (!(('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') ||
+              c == '.' || c == '-' || c == '_'))
+            return false;
     }
+    // "." and ".." can't be file names.
+    return 0 < len && len <= RESOURCE_NAME_MAX && strcmp(name, ".") != 0 && strcmp(name, "..") != 0;
+}
 
-    uint32_t pos = ftell(old_io);
-    if (pos != Length(old_io)) {
-        uint32_t magic = ReadUint32(old_io);
-        if (magic != JSON_MAGIC) {
-            fclose(old_io);
-            fclose(new_io);
-            return "Invalid magic: " + noex::to_string(magic);
-        }
+noex::string ExeContainer::AddResource(const char* name, const noex::string& path) noexcept {
+    if (!IsValidResourceName(name))
+        return noex::concat_cstr("Invalid resource name: ", name);
+    for (const Resource& res : m_resources) {
+        if (res.name == name)
+            return noex::concat_cstr("Duplicated resource name: ", name);
     }
 
-    fclose(old_io);
-    if (json_size == 0) {
-        fclose(new_io);
-        return "";
+    // Hash the file in chunks to verify extracted files.
+    FILE* io = FileOpen(path.c_str(), FILE_MODE_READ);
+    if (!io)
+        return GetFileError(path);
+    Resource res = { name, path, 0, 0, 0 };
+    XxHash64 hash;
+    char buf[BUF_SIZE];
+    size_t read_size;
+    while ((read_size = fread(buf, 1, BUF_SIZE, io)) > 0) {
+        hash.Update(buf, read_size);
+        res.size += read_size;
     }
+    res.hash = hash.Digest();
+    bool ok = !ferror(io);
+    fclose(io);
+    if (!ok)
+        return "Failed to read " + path;
+
+    m_resources.emplace_back(res);
+    m_resources_changed = true;
+    return "";
+}
+
+noex::string ExeContainer::ExtractResource(const char* name, const noex::string& path) noexcept {
+    const Resource* res = nullptr;
+    for (const Resource& r : m_resources) {
+        if (r.name == name)
+            res = &r;
+    }
+    if (!res)
+        return noex::concat_cstr("Resource not found: ", name);
+    if (!res->path.empty())
+        return noex::concat_cstr("Resource is not embedded yet: ", name);
+    if (SIZE_MAX < res->size)
+        return noex::concat_cstr("Resource is too large: ", name);
+
+    FileView file;
+    noex::string err = file.Open(m_exe_path);
+    if (!err.empty())
+        return err;
+    size_t size = static_cast<size_t>(res->size);
+    file.Map(res->offset, size);
+    noex::string buf;
+    const char* data = file.GetData(res->offset, size, &buf);
+    if (!data)
+        return noex::concat_cstr("Failed to read the resource: ", name);
+    if (XxHash64::Hash(data, size) != res->hash)
+        return noex::concat_cstr("Invalid resource hash: ", name);
 
-    // Write json data
-    WriteUint32(new_io, JSON_MAGIC);
-    WriteUint32(new_io, json_size);
-    WriteUint32(new_io, Fnv1Hash32(json_buffer));
-    WriteStr(new_io, json_buffer, json_size);
-    WriteUint32(new_io, m_exe_size - ftell(new_io) - 8);
-    WriteUint32(new_io, JSON_MAGIC);
-    fclose(new_io);
+    FILE* io = FileOpen(path.c_str(), FILE_MODE_WRITE);
+    if (!io)
+        return GetFileError(path);
+    bool ok = fwrite(data, 1, size, io) == size;
+    if (fclose(io) != 0 || !ok) {
+        RemoveFile(path);
+        return "Failed to write " + path;
+    }
     return "";
 }
+
+#ifdef _WIN32
+static bool MakeDir(const noex::string& path) noexcept {
+    noex::wstring wpath = UTF8toUTF16(path.c_str());
+    return CreateDirectoryW(wpath.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+static noex::string GetTempDir() noexcept {
+    wchar_t buf[MAX_PATH + 1];
+    DWORD len = GetTempPathW(MAX_PATH + 1, buf);
+    if (len == 0 || len > MAX_PATH)
+        return "";
+    return UTF16toUTF8(buf) + "tuw-" + noex::to_string(static_cast<size_t>(GetCurrentProcessId()));
+}
+#else
+static bool MakeDir(const noex::string& path) noexcept {
+    if (mkdir(path.c_str(), 0700) == 0)
+        return true;
+    // Don't use directories that other users made.
+    struct stat st;
+    return errno == EEXIST && lstat(path.c_str(), &st) == 0 &&
+           S_ISDIR(st.st_mode) && st.st_uid == getuid();
+}
+
+static noex::string GetTempDir() noexcept {
+    const char* tmp = getenv("TMPDIR");
+    if (!tmp || !*tmp)
+        tmp = "/tmp";
+    return noex::concat_cstr(tmp, "/tuw-") + noex::to_string(static_cast<size_t>(getpid()));
+}
+#endif
+
+// Resources of the running exe extracted to the temporary directory.
+// They are removed when Tuw exits.
+class ResourceCache {
+ private:
+    noex::string m_exe_path;
+    noex::string m_temp_dir;
+    ExeContainer m_exe;
+    bool m_loaded;
+    noex::string m_load_error;
+    noex::vector<noex::string> m_extracted;
+
+ public:
+    ResourceCache() noexcept : m_exe_path(), m_temp_dir(), m_exe(), m_loaded(false),
+                               m_load_error(), m_extracted() {}
+    ~ResourceCache() noexcept {
+        RemoveFiles();
+#ifdef _WIN32
+        if (!m_temp_dir.empty())
+            RemoveDirectoryW(UTF8toUTF16(m_temp_dir.c_str()).c_str());
+#else
+        if (!m_temp_dir.empty())
+            rmdir(m_temp_dir.c_str());
+#endif
+    }
+
+    void RemoveFiles() noexcept {
+        for (const noex::string& path : m_extracted)
+            RemoveFile(path);
+        m_extracted.clear();
+    }
+
+    void SetExePath(const noex::string& exe_path) noexcept {
+        RemoveFiles();
+        m_exe_path.clear();
+        m_exe_path = exe_path;
+        m_loaded = false;
+    }
+
+    noex::string GetPath(const char* name, noex::string* err) noexcept;
+};
+
+noex::string ResourceCache::GetPath(const char* name, noex::string* err) noexcept {
+    if (!m_loaded) {
+        // Read the table of contents only once.
+        if (m_exe_path.empty())
+            m_exe_path = envuStr(envuGetExecutablePath());
+        m_load_error.clear();
+        m_load_error = m_exe.Read(m_exe_path);
+        m_loaded = true;
+    }
+    if (!m_load_error.empty()) {
+        *err = m_load_error;
+        return "";
+    }
+    if (!IsValidResourceName(name)) {
+        *err = noex::concat_cstr("Invalid resource name: ", name);
+        return "";
+    }
+
+    if (m_temp_dir.empty()) {
+        noex::string temp_dir = GetTempDir();
+        if (temp_dir.empty() || !MakeDir(temp_dir)) {
+            *err = "Failed to make a temporary directory: " + temp_dir;
+            return "";
+        }
+        m_temp_dir = temp_dir;
+    }
+
+    noex::string path = m_temp_dir + "/" + name;
+    for (const noex::string& extracted : m_extracted) {
+        if (extracted == path)
+            return path;
+    }
+    *err = m_exe.ExtractResource(name, path);
+    if (!err->empty())
+        return "";
+    m_extracted.emplace_back(path);
+    return path;
+}
+
+static ResourceCache& GetResourceCache() noexcept {
+    static ResourceCache cache;
+    return cache;
+}
+
+noex::string GetResourcePath(const char* name, noex::string* err) noexcept {
+    return GetResourceCache().GetPath(name, err);
+}
+
+void SetResourceExePath(const noex::string& exe_path) noexcept {
+    GetResourceCache().SetExePath(exe_path);
+}
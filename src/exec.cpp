@@ -1,12 +1,20 @@
 #include "exec.h"
-#include "subprocess.h"
+#include "process.h"
 #include "string_utils.h"
+#include "json.h"
+#include "str_match.h"
+#include "json_utils.h"
+#include "noex/new.hpp"
+#include <cctype>
+#include <cstdlib>
 #ifdef __TUW_UNIX__
 #include <gtk/gtk.h>
 #endif
 #ifdef _WIN32
 #include "windows.h"
 #else
+#include <errno.h>
+#include <fcntl.h>
 #include <time.h>
 #endif
 
@@ -16,7 +24,19 @@ enum READ_IO_TYPE : int {
 };
 
 #define BUF_SIZE 65536
-#define LAST_CHARS_MAX_LEN 2048
+
+// Workers print "\x1e<exit code>\n" to stdout when they finish a request.
+#define FRAME_CHAR '\x1e'
+
+#ifdef __TUW_UNIX__
+static bool g_use_gui = true;
+#endif
+
+void ExecuteDisableGui() noexcept {
+#ifdef __TUW_UNIX__
+    g_use_gui = false;
+#endif
+}
 
 void ReplaceFirstCharsWithDots(noex::string* str) noexcept {
     if (str->length() < 3)
@@ -27,6 +47,66 @@ void ReplaceFirstCharsWithDots(noex::string* str) noexcept {
     buf[2] = '.';
 }
 
+static inline bool IsNewline(char ch) noexcept {
+    return ch == '\n' || ch == '\r';
+}
+
+// Returns the number before the first "%" or -1. (e.g. 12 for "12.5%")
+static int ParsePercent(const char* line) noexcept {
+    for (const char* percent = strchr(line, '%'); percent;
+         percent = strchr(percent + 1, '%')) {
+        const char* p = percent;
+        while (p > line && (isdigit(static_cast<unsigned char>(p[-1])) || p[-1] == '.'))
+            p--;
+        if (p < percent && isdigit(static_cast<unsigned char>(*p))) {
+            double value = strtod(p, nullptr);
+            return value > 100 ? 100 : static_cast<int>(value);
+        }
+    }
+    return -1;
+}
+
+void LineSplitter::EndLine() noexcept {
+    RingStrBuffer<LAST_CHARS_MAX_LEN>& line = m_lines[m_current];
+    if (line.IsEmpty())
+        return;
+    if (m_progress_regex) {
+        // A line is at most LAST_CHARS_MAX_LEN bytes.
+        noex::string str = line.ToString();
+        if (tsm_regex_match(m_progress_regex, str.c_str()) == TSM_OK) {
+            int percent = ParsePercent(str.c_str());
+            if (percent >= 0)
+                m_progress = percent;
+        }
+    }
+    // Keep the line as the previous one.
+    m_current ^= 1;
+    m_lines[m_current].Clear();
+}
+
+void LineSplitter::Push(const char* buf, size_t size) noexcept {
+    const char* end = buf + size;
+    while (buf < end) {
+        const char* p = buf;
+        while (p < end && !IsNewline(*p))
+            p++;
+        m_lines[m_current].PushBack(buf, static_cast<size_t>(p - buf));
+        if (p == end)
+            break;
+        EndLine();
+        buf = p + 1;
+    }
+}
+
+noex::string LineSplitter::GetLastLine() noexcept {
+    RingStrBuffer<LAST_CHARS_MAX_LEN>& line =
+        m_lines[m_current].IsEmpty() ? m_lines[m_current ^ 1] : m_lines[m_current];
+    noex::string str = line.ToString();
+    if (line.IsFull())
+        ReplaceFirstCharsWithDots(&str);
+    return str;
+}
+
 class RedirectContext {
  private:
 #ifdef _WIN32
@@ -38,13 +118,48 @@ class RedirectContext {
     int m_io_type;
     char m_buf[BUF_SIZE + 1];
     RingStrBuffer<LAST_CHARS_MAX_LEN> m_last_chars;
+    LineSplitter m_lines;
+
+    OutputLog* m_log;
+
+    // Frame detection for workers
+    bool m_use_frame;
+    bool m_at_line_start;
+    bool m_in_frame;
+    bool m_has_frame;
+    noex::string m_frame;
+
+    // Removes a frame line from the buffer and returns the size of the other outputs.
+    unsigned ScanFrame(unsigned size) noexcept {
+        unsigned out_size = 0;
+        for (unsigned i = 0; i < size; i++) {
+            char c = m_buf[i];
+            if (m_has_frame) {
+                // Keep outputs after the frame.
+                m_buf[out_size++] = c;
+            } else if (m_in_frame) {
+                if (c == '\n')
+                    m_has_frame = true;
+                else
+                    m_frame.push_back(c);
+            } else if (c == FRAME_CHAR && m_at_line_start) {
+                m_in_frame = true;
+            } else {
+                m_buf[out_size++] = c;
+                m_at_line_start = c == '\n';
+            }
+        }
+        return out_size;
+    }
 
  public:
     explicit RedirectContext(int read_io_type, int use_utf8_on_windows) noexcept :
     #ifdef _WIN32
             m_use_utf8_on_windows(use_utf8_on_windows),
     #endif
-            m_io_type(read_io_type), m_last_chars() {
+            m_io_type(read_io_type), m_last_chars(), m_lines(), m_log(nullptr),
+            m_use_frame(false), m_at_line_start(true),
+            m_in_frame(false), m_has_frame(false), m_frame() {
     #ifdef _WIN32
         if (read_io_type == READ_STDOUT)
             m_file = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -58,21 +173,54 @@ class RedirectContext {
     #endif
     }
 
-    void RedirectOutput(subprocess_s &process) noexcept {
+    void SetLog(OutputLog* log) noexcept {
+        m_log = log;
+    }
+
+    void SetProgressRegex(const char* regex) noexcept {
+        m_lines.SetProgressRegex(regex);
+    }
+
+    int GetProgress() const noexcept {
+        return m_lines.GetProgress();
+    }
+
+    void UseFrame() noexcept {
+        m_use_frame = true;
+    }
+
+    bool HasFrame() const noexcept {
+        return m_has_frame;
+    }
+
+    int GetFrameCode() const noexcept {
+        return static_cast<int>(strtol(m_frame.c_str(), nullptr, 10));
+    }
+
+    void RedirectOutput(ChildProcess &process) noexcept {
         unsigned read_size = 0;
-        while (1) {
+        for (;;) {
             // Read outputs
             if (m_io_type == READ_STDOUT)
-                read_size = subprocess_read_stdout(&process, m_buf, BUF_SIZE);
+                read_size = process.ReadStdout(m_buf, BUF_SIZE);
             else
-                read_size = subprocess_read_stderr(&process, m_buf, BUF_SIZE);
-            m_buf[read_size] = 0;
+                read_size = process.ReadStderr(m_buf, BUF_SIZE);
 
             if (!read_size)
                 break;
 
+            if (m_use_frame) {
+                read_size = ScanFrame(read_size);
+                if (!read_size)
+                    continue;
+            }
+            m_buf[read_size] = 0;
+
             // Store last characters
             m_last_chars.PushBack(m_buf, read_size);
+            m_lines.Push(m_buf, read_size);
+            if (m_log)
+                m_log->Append(m_buf, read_size);
 
             // Redirect to console
         #ifdef _WIN32
@@ -87,7 +235,8 @@ class RedirectContext {
             }
         #else  // _WIN32
         #ifdef __TUW_UNIX__
-            Log(m_buf);
+            if (g_use_gui)
+                Log(m_buf);
         #endif
             fwrite(m_buf, sizeof(char), read_size, m_file);
         #endif  // _WIN32
@@ -102,112 +251,607 @@ class RedirectContext {
     }
 
     noex::string GetLine() noexcept {
-        return GetLastLine(GetLastChars());
+        return m_lines.GetLastLine();
     }
 };
 
-void DestroyProcess(subprocess_s &process,
+void DestroyProcess(ChildProcess &process,
                     int *return_code, noex::string &err_msg) noexcept {
-    if (subprocess_join(&process, return_code) || subprocess_destroy(&process)) {
+    if (!process.Join(return_code)) {
         *return_code = -1;
         err_msg = "Failed to manage subprocess.\n";
     }
 }
 
-ExecuteResult Execute(const noex::string& cmd,
-                      bool use_utf8_on_windows) noexcept {
-    if (cmd.empty())
-        return { 0, "", "" };
+// Stop sending stdin for a while to read outputs and update the GUI.
+#define STDIN_TIME_LIMIT_US 20000
 
-#ifdef _WIN32
-    noex::wstring wcmd = UTF8toUTF16(cmd.c_str());
+// Sends a file or text to stdin without blocking.
+class StdinWriter {
+ private:
+    noex::string m_text;
+    FILE* m_file;
+#ifdef __linux__
+    bool m_use_splice;
+#endif
+    // Data to send
+    const char* m_data;
+    size_t m_pos;
+    size_t m_size;
+    char m_buf[BUF_SIZE];
+    bool m_is_pending;
+    bool m_keep_open;
 
-    if (noex::get_error_no() != noex::OK) {
-        // Reject the command as it might have unexpected value.
-        return { -1,
-                 "Fatal error has occored while editing strings or vectors.\n",
-                 "" };
-    }
-
-    int argc;
-    wchar_t** parsed = CommandLineToArgvW(wcmd.c_str(), &argc);
-    wchar_t** argv = static_cast<wchar_t**>(malloc((argc + 3) * sizeof(wchar_t*)));
-    if (argv == nullptr)
-        return { -1, "Failed to allocate wchar_t array.\n", ""};
-    wchar_t a[] = L"cmd.exe";
-    wchar_t b[] = L"/c";
-    argv[0] = &a[0];
-    argv[1] = &b[0];
-    for (int i = 0; i < argc; i++) {
-        argv[i + 2] = parsed[i];
-    }
-    argv[argc + 2] = 0;
-#else
-    const char* argv[] = {"/bin/sh", "-c", cmd.c_str(), NULL};
-    struct timespec  ten_ms = { 0, 10 * 1000000 };  // 10ms;
+ public:
+    StdinWriter() noexcept : m_text(), m_file(nullptr),
+#ifdef __linux__
+        m_use_splice(true),
 #endif
+        m_data(nullptr), m_pos(0), m_size(0), m_is_pending(false), m_keep_open(false) {}
 
-    struct subprocess_s process;
-    int options = subprocess_option_inherit_environment
-                  | subprocess_option_search_user_path
-                  | subprocess_option_enable_async;
-    int result = subprocess_create(&argv[0], options, &process);
+    ~StdinWriter() noexcept {
+        if (m_file)
+            fclose(m_file);
+    }
 
-#ifdef _WIN32
-    LocalFree((LPWSTR)parsed);
-    free(argv);
+    noex::string Open(const StdinContent& input) noexcept {
+        if (!input.is_file) {
+            m_text = input.str;
+            m_data = m_text.c_str();
+            m_size = m_text.size();
+            return "";
+        }
+        m_file = FileOpen(input.str.c_str(), FILE_MODE_READ);
+        if (!m_file)
+            return GetFileError(input.str);
+#ifndef _WIN32
+        // The child process should not inherit the file.
+        fcntl(fileno(m_file), F_SETFD, FD_CLOEXEC);
 #endif
+        return "";
+    }
 
-    if (0 != result)
-        return { -1, "Failed to create a subprocess.\n", ""};
+    bool IsPending() const noexcept {
+        return m_is_pending;
+    }
 
-    RedirectContext stdout_context(READ_STDOUT, use_utf8_on_windows);
-    RedirectContext stderr_context(READ_STDERR, use_utf8_on_windows);
+    // Don't send EOF after sending all data. Workers read more requests from stdin.
+    void KeepOpen() noexcept {
+        m_keep_open = true;
+    }
+
+    // Sends data until the pipe gets full. Returns false when it finished.
+    bool Pump(ChildProcess& process) noexcept {
+        uint64_t start = GetMonotonicTimeUs();
+        m_is_pending = false;
+        for (;;) {
+            if (GetMonotonicTimeUs() - start >= STDIN_TIME_LIMIT_US) {
+                m_is_pending = true;
+                return true;
+            }
+            if (m_pos < m_size) {
+                int64_t written = process.TryWriteStdin(m_data + m_pos, m_size - m_pos);
+                if (written < 0) {
+                #ifndef _WIN32
+                    if (errno == EAGAIN)
+                        return true;
+                #endif
+                    break;  // The process closed stdin.
+                }
+                m_pos += static_cast<size_t>(written);
+                continue;
+            }
+            if (!m_file)
+                break;
+        #ifdef __linux__
+            if (m_use_splice) {
+                // Move pages from the page cache to the pipe.
+                int64_t moved = process.SpliceToStdin(fileno(m_file), BUF_SIZE);
+                if (moved > 0)
+                    continue;
+                if (moved == 0)
+                    break;
+                if (errno == EAGAIN)
+                    return true;
+                if (errno != EINVAL && errno != ENOSYS)
+                    break;
+                m_use_splice = false;
+            }
+        #endif
+            m_size = fread(m_buf, sizeof(char), BUF_SIZE, m_file);
+            m_data = m_buf;
+            m_pos = 0;
+            if (m_size == 0)
+                break;
+        }
+        // Send EOF
+        if (!m_keep_open)
+            process.CloseStdin();
+        return false;
+    }
+};
 
+// Redirects outputs until the process exits or stdout receives a frame.
+// It also sends stdin_writer's data to the process when it's not null.
+static void RedirectUntilDone(ChildProcess& process,
+                              RedirectContext& stdout_context,
+                              RedirectContext& stderr_context,
+                              StdinWriter* stdin_writer = nullptr) noexcept {
+#ifndef _WIN32
+    struct timespec  ten_ms = { 0, 10 * 1000000 };  // 10ms;
+#endif
     do {
+        if (stdin_writer && !stdin_writer->Pump(process))
+            stdin_writer = nullptr;
         stdout_context.RedirectOutput(process);
         stderr_context.RedirectOutput(process);
 #ifdef __TUW_UNIX__
         // Update the console window
-        while (gtk_events_pending())
+        while (g_use_gui && gtk_events_pending())
             gtk_main_iteration_do(FALSE);
 #endif
+        if (stdout_context.HasFrame())
+            break;
+        if (stdin_writer && stdin_writer->IsPending())
+            continue;  // The pipe is not full yet.
 #ifdef _WIN32
         Sleep(10);  // wait 10ms
 #else
         nanosleep(&ten_ms, nullptr);  // wait 10ms
 #endif
-    } while (subprocess_alive(&process));
+    } while (process.IsAlive());
 
-    // Sometimes stdout and stderr still have unread characters
+    // Sometimes stdout and stderr still have unread characters.
+    // A worker writes stderr before the frame, so it's in the pipe at this point.
     stdout_context.RedirectOutput(process);
     stderr_context.RedirectOutput(process);
+}
+
+// Builds argv to run a command via shell.
+class ShellArgv {
+ private:
+#ifdef _WIN32
+    wchar_t** m_parsed;
+    const wchar_t** m_argv;
+#else
+    const char* m_argv[4];
+#endif
+    const char* m_err_msg;
+
+ public:
+    explicit ShellArgv(const noex::string& cmd) noexcept : m_err_msg(nullptr) {
+#ifdef _WIN32
+        m_parsed = nullptr;
+        m_argv = nullptr;
+        noex::wstring wcmd = UTF8toUTF16(cmd.c_str());
+        if (noex::get_error_no() != noex::OK) {
+            // Reject the command as it might have unexpected value.
+            m_err_msg = "Fatal error has occored while editing strings or vectors.\n";
+            return;
+        }
+
+        int argc;
+        m_parsed = CommandLineToArgvW(wcmd.c_str(), &argc);
+        m_argv = static_cast<const wchar_t**>(malloc((argc + 3) * sizeof(wchar_t*)));
+        if (m_argv == nullptr) {
+            m_err_msg = "Failed to allocate wchar_t array.\n";
+            return;
+        }
+        m_argv[0] = L"cmd.exe";
+        m_argv[1] = L"/c";
+        for (int i = 0; i < argc; i++) {
+            m_argv[i + 2] = m_parsed[i];
+        }
+        m_argv[argc + 2] = 0;
+#else
+        m_argv[0] = "/bin/sh";
+        m_argv[1] = "-c";
+        m_argv[2] = cmd.c_str();
+        m_argv[3] = NULL;
+#endif
+    }
+
+    ~ShellArgv() noexcept {
+#ifdef _WIN32
+        if (m_parsed)
+            LocalFree((LPWSTR)m_parsed);
+        free(m_argv);
+#endif
+    }
+
+    // Returns nullptr on failure.
+    const ArgChar* const* Get() const noexcept {
+        if (m_err_msg)
+            return nullptr;
+        return m_argv;
+    }
+
+    const char* GetErrMsg() const noexcept {
+        return m_err_msg;
+    }
+};
+
+// Builds argv to run a command without shell.
+class ArgsArgv {
+ private:
+#ifdef _WIN32
+    noex::vector<noex::wstring> m_wargs;
+    noex::vector<const wchar_t*> m_argv;
+#else
+    noex::vector<const char*> m_argv;
+#endif
+
+ public:
+    explicit ArgsArgv(const noex::vector<noex::string>& args) noexcept {
+#ifdef _WIN32
+        for (const noex::string& arg : args)
+            m_wargs.push_back(UTF8toUTF16(arg.c_str()));
+        for (const noex::wstring& warg : m_wargs)
+            m_argv.push_back(warg.c_str());
+#else
+        for (const noex::string& arg : args)
+            m_argv.push_back(arg.c_str());
+#endif
+        m_argv.push_back(nullptr);
+    }
+
+    // Returns nullptr on failure.
+    const ArgChar* const* Get() const noexcept {
+        if (noex::get_error_no() != noex::OK) {
+            // Reject the command as it might have unexpected value.
+            return nullptr;
+        }
+        return m_argv.data();
+    }
+
+    const char* GetErrMsg() const noexcept {
+        return "Fatal error has occored while editing strings or vectors.\n";
+    }
+};
+
+// Sums up resource usage of commands that ran at the same time.
+static void AddStats(ProcessStats* total, const ProcessStats& stats) noexcept {
+    if (total->wall_time_us < stats.wall_time_us)
+        total->wall_time_us = stats.wall_time_us;
+    total->user_time_us += stats.user_time_us;
+    total->sys_time_us += stats.sys_time_us;
+    if (total->max_rss_kb < stats.max_rss_kb)
+        total->max_rss_kb = stats.max_rss_kb;
+    total->read_blocks += stats.read_blocks;
+    total->write_blocks += stats.write_blocks;
+}
+
+void Pipeline::AddStage(const noex::vector<noex::string>& args) noexcept {
+    for (const noex::string& arg : args)
+        m_args.push_back(arg);
+    m_stage_ends.push_back(m_args.size());
+}
+
+noex::vector<noex::string> Pipeline::GetStage(size_t id) const noexcept {
+    noex::vector<noex::string> args;
+    if (id >= m_stage_ends.size())
+        return args;
+    for (size_t i = id ? m_stage_ends[id - 1] : 0; i < m_stage_ends[id]; i++)
+        args.push_back(m_args[i]);
+    return args;
+}
+
+AsyncExecution::AsyncExecution(bool use_utf8_on_windows, OutputLog* log) noexcept :
+        m_process(), m_stages(nullptr), m_stage_count(0),
+        m_stdout_context(nullptr), m_stderr_context(nullptr),
+        m_use_utf8_on_windows(use_utf8_on_windows), m_is_running(false), m_log(log),
+        m_progress_regex(nullptr), m_input(), m_use_input(false), m_stdin_writer(nullptr),
+        m_limits() {}
+
+AsyncExecution::~AsyncExecution() noexcept {
+    if (m_is_running) {
+        Terminate();
+        Finish();
+    }
+    noex::del_ref(m_stdout_context);
+    noex::del_ref(m_stderr_context);
+    noex::del_ref(m_stdin_writer);
+    noex::del_array(m_stages, m_stage_count);
+}
+
+// Launches a process with stdin and limits.
+noex::string AsyncExecution::Spawn(ChildProcess& process, const ArgChar* const* argv,
+                                   bool is_first) noexcept {
+    int options = PROCESS_REDIRECT_OUTPUT;
+    if (is_first && m_use_input) {
+        m_stdin_writer = noex::new_ref<StdinWriter>();
+        if (!m_stdin_writer)
+            return "Failed to allocate memory for stdin.\n";
+        noex::string err = m_stdin_writer->Open(m_input);
+        if (!err.empty())
+            return "Failed to open stdin: " + err;
+        options |= PROCESS_PIPE_STDIN | PROCESS_NONBLOCK_STDIN;
+    }
+    process.SetTimeout(m_limits.timeout_ms, m_limits.kill_grace_ms);
+    if (!process.Spawn(argv, options))
+        return "Failed to create a subprocess.\n";
+    if (!m_limits.IsEmpty()) {
+        const char* limit_err = process.ApplyLimits(m_limits);
+        if (limit_err)
+            PrintFmt("[RunCommand] Warning: %s\n", limit_err);
+    }
+    return "";
+}
+
+noex::string AsyncExecution::NewContexts() noexcept {
+    m_stdout_context = noex::new_ref<RedirectContext>(
+        noex::ALLOC_OTHER, READ_STDOUT, m_use_utf8_on_windows);
+    m_stderr_context = noex::new_ref<RedirectContext>(
+        noex::ALLOC_OTHER, READ_STDERR, m_use_utf8_on_windows);
+    if (!m_stdout_context || !m_stderr_context)
+        return "Failed to allocate memory for outputs.\n";
+    m_stdout_context->SetLog(m_log);
+    m_stderr_context->SetLog(m_log);
+    m_stdout_context->SetProgressRegex(m_progress_regex);
+    return "";
+}
+
+noex::string AsyncExecution::Start(const ArgChar* const* argv) noexcept {
+    noex::string err = NewContexts();
+    if (err.empty())
+        err = Spawn(m_process, argv, true);
+    if (!err.empty())
+        return err;
+    m_is_running = true;
+    return "";
+}
+
+noex::string AsyncExecution::Start(const noex::string& cmd) noexcept {
+    if (cmd.empty())
+        return "";
+    ShellArgv argv(cmd);
+    if (!argv.Get())
+        return argv.GetErrMsg();
+    return Start(argv.Get());
+}
+
+noex::string AsyncExecution::Start(const noex::vector<noex::string>& args) noexcept {
+    if (args.empty())
+        return "";
+    ArgsArgv argv(args);
+    if (!argv.Get())
+        return argv.GetErrMsg();
+    return Start(argv.Get());
+}
+
+noex::string AsyncExecution::Start(const Pipeline& pipeline) noexcept {
+    size_t count = pipeline.GetStageCount();
+    if (count == 0)
+        return "";
+    if (count == 1)
+        return Start(pipeline.GetStage(0));
+#ifdef _WIN32
+    return "Pipelines are not supported on Windows.\n";
+#else
+    noex::string err = NewContexts();
+    if (!err.empty())
+        return err;
+    m_stages = noex::new_array<ChildProcess>(count - 1);
+    if (!m_stages)
+        return "Failed to allocate memory for the pipeline.\n";
+    m_stage_count = count - 1;
+    for (size_t i = 0; i < count && err.empty(); i++) {
+        noex::vector<noex::string> args = pipeline.GetStage(i);
+        ArgsArgv argv(args);
+        if (!argv.Get()) {
+            err = argv.GetErrMsg();
+            break;
+        }
+        ChildProcess& process = i < m_stage_count ? m_stages[i] : m_process;
+        // Connect the previous command directly. Data never goes through Tuw.
+        if (i > 0)
+            process.SetStdinFd(m_stages[i - 1].ReleaseStdout());
+        err = Spawn(process, argv.Get(), i == 0);
+    }
+    if (!err.empty()) {
+        for (size_t i = 0; i < m_stage_count; i++) {
+            int exit_code;
+            m_stages[i].Terminate();
+            m_stages[i].Join(&exit_code);
+        }
+        return err;
+    }
+    m_is_running = true;
+    return "";
+#endif
+}
+
+bool AsyncExecution::Update() noexcept {
+    if (!m_is_running)
+        return false;
+    m_process.CheckTimeout();
+    bool is_alive = m_process.IsAlive();
+    // Sometimes stdout and stderr still have unread characters after exiting
+    m_stdout_context->RedirectOutput(m_process);
+    m_stderr_context->RedirectOutput(m_process);
+    // Wait for all commands of the pipeline as shells do.
+    for (size_t i = 0; i < m_stage_count; i++) {
+        m_stages[i].CheckTimeout();
+        if (m_stages[i].IsAlive())
+            is_alive = true;
+        m_stderr_context->RedirectOutput(m_stages[i]);
+    }
+    if (m_stdin_writer && !m_stdin_writer->Pump(GetFirstProcess())) {
+        noex::del_ref(m_stdin_writer);
+        m_stdin_writer = nullptr;
+    }
+    return is_alive;
+}
+
+ExecuteResult AsyncExecution::Finish() noexcept {
+    if (!m_is_running)
+        return { 0, "", "" };  // Empty command
+    m_is_running = false;
 
     // Get buffered characters from stdout and stderr
-    noex::string last_line = stdout_context.GetLine();
-    noex::string err_msg = stderr_context.GetLastChars();
+    noex::string last_line = m_stdout_context->GetLine();
+    noex::string err_msg = m_stderr_context->GetLastChars();
 
     int return_code;
-    DestroyProcess(process, &return_code, err_msg);
+    DestroyProcess(m_process, &return_code, err_msg);
+
+    bool timed_out = m_process.TimedOut();
+    ProcessStats stats = m_process.GetStats();
+    noex::vector<StageResult> stages;
+    for (size_t i = 0; i < m_stage_count; i++) {
+        StageResult stage;
+        DestroyProcess(m_stages[i], &stage.exit_code, err_msg);
+        stage.stats = m_stages[i].GetStats();
+        stages.push_back(stage);
+        timed_out = timed_out || m_stages[i].TimedOut();
+        AddStats(&stats, stage.stats);
+    }
+    if (m_stage_count > 0) {
+        StageResult last = { return_code, m_process.GetStats() };
+        stages.push_back(last);
+    }
 
 #ifdef _WIN32
-    if (!use_utf8_on_windows)
-        return { return_code, ANSItoUTF8(err_msg), ANSItoUTF8(last_line) };
+    if (!m_use_utf8_on_windows) {
+        err_msg = ANSItoUTF8(err_msg);
+        last_line = ANSItoUTF8(last_line);
+    }
 #endif
-    return { return_code, err_msg, last_line };
+    if (timed_out) {
+        noex::string msg = "Timed out after " + noex::to_string(m_limits.timeout_ms) + "ms.";
+        err_msg = err_msg.empty() ? msg : msg + "\n" + err_msg;
+    }
+    ExecuteResult result = { return_code, err_msg, last_line };
+    result.stats = stats;
+    result.timed_out = timed_out;
+    result.stages = static_cast<noex::vector<StageResult>&&>(stages);
+    return result;
+}
+
+void AsyncExecution::Terminate() noexcept {
+    if (!m_is_running)
+        return;
+    m_process.Terminate();
+    for (size_t i = 0; i < m_stage_count; i++)
+        m_stages[i].Terminate();
+}
+
+void AsyncExecution::SetProgressRegex(const char* regex) noexcept {
+    m_progress_regex = regex;
+}
+
+void AsyncExecution::SetStdin(const StdinContent& input) noexcept {
+    m_input = input;
+    m_use_input = true;
+}
+
+bool AsyncExecution::IsSendingStdin() const noexcept {
+    return m_stdin_writer && m_stdin_writer->IsPending();
+}
+
+void AsyncExecution::SetLimits(const ProcessLimits& limits) noexcept {
+    m_limits = limits;
+}
+
+int AsyncExecution::GetProgress() const noexcept {
+    if (!m_stdout_context)
+        return -1;
+    return m_stdout_context->GetProgress();
 }
 
+// Waits for the execution while updating the console window.
+static ExecuteResult WaitExecution(AsyncExecution& execution,
+                                   const ProgressReporter* progress) noexcept {
+#ifndef _WIN32
+    struct timespec  ten_ms = { 0, 10 * 1000000 };  // 10ms;
+#endif
+    int percent = -1;
+    while (execution.Update()) {
+        if (progress && progress->callback && execution.GetProgress() != percent) {
+            percent = execution.GetProgress();
+            progress->callback(percent, progress->data);
+        }
+#ifdef __TUW_UNIX__
+        // Update the console window
+        while (g_use_gui && gtk_events_pending())
+            gtk_main_iteration_do(FALSE);
+#endif
+        // Keep sending stdin when the process reads it fast.
+        if (execution.IsSendingStdin())
+            continue;
 #ifdef _WIN32
-static ExecuteResult LaunchDefaultAppBase(const wchar_t** argv) noexcept {
+        Sleep(10);  // wait 10ms
 #else
-static ExecuteResult LaunchDefaultAppBase(const char** argv) noexcept {
+        nanosleep(&ten_ms, nullptr);  // wait 10ms
 #endif
-    struct subprocess_s process;
-    int options = subprocess_option_inherit_environment
-                  | subprocess_option_search_user_path;
-    int result = subprocess_create(argv, options, &process);
-    if (0 != result)
-        return { -1, "Failed to create a subprocess.\n", ""};
+    }
+    return execution.Finish();
+}
+
+static void SetOptions(AsyncExecution& execution,
+                       const ProgressReporter* progress,
+                       const StdinContent* input,
+                       const ProcessLimits* limits) noexcept {
+    if (progress)
+        execution.SetProgressRegex(progress->regex);
+    if (input)
+        execution.SetStdin(*input);
+    if (limits)
+        execution.SetLimits(*limits);
+}
+
+ExecuteResult LaunchError(const noex::string& err) noexcept {
+    ExecuteResult result = { -1, err, "" };
+    result.launch_failed = true;
+    return result;
+}
+
+ExecuteResult Execute(const noex::string& cmd,
+                      bool use_utf8_on_windows,
+                      OutputLog* log,
+                      const ProgressReporter* progress,
+                      const StdinContent* input,
+                      const ProcessLimits* limits) noexcept {
+    AsyncExecution execution(use_utf8_on_windows, log);
+    SetOptions(execution, progress, input, limits);
+    noex::string err = execution.Start(cmd);
+    if (!err.empty())
+        return LaunchError(err);
+    return WaitExecution(execution, progress);
+}
+
+ExecuteResult Execute(const noex::vector<noex::string>& args,
+                      bool use_utf8_on_windows,
+                      OutputLog* log,
+                      const ProgressReporter* progress,
+                      const StdinContent* input,
+                      const ProcessLimits* limits) noexcept {
+    AsyncExecution execution(use_utf8_on_windows, log);
+    SetOptions(execution, progress, input, limits);
+    noex::string err = execution.Start(args);
+    if (!err.empty())
+        return LaunchError(err);
+    return WaitExecution(execution, progress);
+}
+
+ExecuteResult Execute(const Pipeline& pipeline,
+                      bool use_utf8_on_windows,
+                      OutputLog* log,
+                      const ProgressReporter* progress,
+                      const StdinContent* input,
+                      const ProcessLimits* limits) noexcept {
+    AsyncExecution execution(use_utf8_on_windows, log);
+    SetOptions(execution, progress, input, limits);
+    noex::string err = execution.Start(pipeline);
+    if (!err.empty())
+        return LaunchError(err);
+    return WaitExecution(execution, progress);
+}
+
+static ExecuteResult LaunchDefaultAppBase(const ArgChar* const* argv) noexcept {
+    ChildProcess process;
+    if (!process.Spawn(argv, 0))
+        return LaunchError("Failed to create a subprocess.\n");
 
     int return_code;
     noex::string err_msg;
@@ -238,3 +882,116 @@ ExecuteResult LaunchDefaultApp(const noex::string& url) noexcept {
 #endif
     return res;
 }
+
+noex::string Worker::Start(const noex::string& cmd) noexcept {
+    ShellArgv argv(cmd);
+    if (!argv.Get())
+        return argv.GetErrMsg();
+    int options = PROCESS_REDIRECT_OUTPUT | PROCESS_PIPE_STDIN | PROCESS_NONBLOCK_STDIN;
+    if (!m_process.Spawn(argv.Get(), options))
+        return "Failed to launch the worker.\n";
+    m_cmd = cmd;
+    m_is_running = true;
+    return "";
+}
+
+void Worker::Stop() noexcept {
+    if (!m_is_running)
+        return;
+    m_is_running = false;
+    m_process.CloseStdin();
+    uint64_t start = GetMonotonicTimeUs();
+    while (m_process.IsAlive()) {
+        if (GetMonotonicTimeUs() - start > 1000000) {
+            m_process.Terminate();
+            break;
+        }
+#ifdef _WIN32
+        Sleep(10);  // wait 10ms
+#else
+        struct timespec  ten_ms = { 0, 10 * 1000000 };  // 10ms;
+        nanosleep(&ten_ms, nullptr);  // wait 10ms
+#endif
+    }
+    int exit_code;
+    m_process.Join(&exit_code);
+}
+
+// Makes {"args": [...]}\n
+static noex::string MakeWorkerRequest(const noex::vector<noex::string>& args) noexcept {
+    tuwjson::Value request;
+    request.SetObject();
+    tuwjson::Value& args_json = request["args"];
+    args_json.SetArray();
+    size_t max_size = 16;
+    for (const noex::string& arg : args) {
+        tuwjson::Value arg_json;
+        arg_json.SetString(arg);
+        args_json.MoveAndPush(arg_json);
+        max_size += arg.size() * 2 + 4;  // Escaped string, quotes, and ", "
+    }
+
+    noex::string buf(max_size);
+    tuwjson::Writer writer("", 0, false);
+    char* end = writer.WriteJson(&request, buf.data(), max_size);
+    if (!end)
+        return "";
+    return noex::concat_cstr(buf.c_str(), "\n");
+}
+
+ExecuteResult Worker::Run(const noex::string& cmd,
+                          const noex::vector<noex::string>& args,
+                          bool use_utf8_on_windows,
+                          OutputLog* log) noexcept {
+    if (m_is_running && (m_cmd != cmd || !m_process.IsAlive()))
+        Stop();
+
+    if (!m_is_running) {
+        noex::string err = Start(cmd);
+        if (!err.empty())
+            return LaunchError(err);
+    }
+
+    noex::string request = MakeWorkerRequest(args);
+    if (noex::get_error_no() != noex::OK || request.empty()) {
+        // Reject the command as it might have unexpected value.
+        return LaunchError("Fatal error has occored while editing strings or vectors.\n");
+    }
+
+    uint64_t start = GetMonotonicTimeUs();
+    // Send the request while reading outputs.
+    // The worker might fill stdout before reading the whole request.
+    StdinContent input;
+    input.str = request;
+    StdinWriter stdin_writer;
+    stdin_writer.Open(input);
+    stdin_writer.KeepOpen();
+
+    RedirectContext stdout_context(READ_STDOUT, use_utf8_on_windows);
+    RedirectContext stderr_context(READ_STDERR, use_utf8_on_windows);
+    stdout_context.UseFrame();
+    stdout_context.SetLog(log);
+    stderr_context.SetLog(log);
+    RedirectUntilDone(m_process, stdout_context, stderr_context, &stdin_writer);
+
+    noex::string last_line = stdout_context.GetLine();
+    noex::string err_msg = stderr_context.GetLastChars();
+    int exit_code = stdout_context.GetFrameCode();
+    if (!stdout_context.HasFrame()) {
+        // The worker died before finishing the request.
+        Stop();
+        exit_code = -1;
+        err_msg = "The worker exited unexpectedly.\n" + err_msg;
+    }
+
+#ifdef _WIN32
+    if (!use_utf8_on_windows) {
+        err_msg = ANSItoUTF8(err_msg);
+        last_line = ANSItoUTF8(last_line);
+    }
+#endif
+    // We can't get CPU time and memory usage per request.
+    ExecuteResult result = { exit_code, err_msg, last_line };
+    result.stats.wall_time_us = GetMonotonicTimeUs() - start;
+    return result;
+}
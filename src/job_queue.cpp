@@ -0,0 +1,134 @@
+#include "job_queue.h"
+#include "command.h"
+#include "json_utils.h"
+#include "noex/new.hpp"
+
+Job::~Job() noexcept {
+    noex::del_ref(execution);
+}
+
+void JobQueue::DeleteJob(Job* job) noexcept {
+    noex::del_ref(job);
+}
+
+int JobQueue::Push(const tuwjson::Value& sub_definition,
+                   const noex::string& cmd,
+                   const noex::vector<noex::string>& args,
+                   const noex::string& cache_key,
+                   const StdinContent* input,
+                   const Pipeline* pipeline) noexcept {
+    Job* job = noex::new_ref<Job>();
+    if (!job)
+        return -1;
+    job->id = m_next_id;
+    m_next_id++;
+    job->max_parallel = json_utils::GetInt(sub_definition, "max_parallel", 1);
+    job->sub_definition = &sub_definition;
+    job->cmd = cmd;
+    job->args = args;
+    job->cache_key = cache_key;
+    if (input) {
+        job->input = *input;
+        job->use_input = true;
+    }
+    if (pipeline) {
+        for (size_t i = 0; i < pipeline->GetStageCount(); i++)
+            job->pipeline.AddStage(pipeline->GetStage(i));
+        job->use_pipeline = true;
+    }
+    m_jobs.push_back(job);
+    PrintFmt("[JobQueue] Job #%d: Queued\n", job->id);
+    return job->id;
+}
+
+void JobQueue::StartJob(Job* job) noexcept {
+    const tuwjson::Value& sub_definition = *job->sub_definition;
+    job->state = JOB_RUNNING;
+    job->execution = noex::new_ref<AsyncExecution>(
+        noex::ALLOC_OTHER, UseUtf8OnWindows(sub_definition));
+    if (!job->execution) {
+        job->result = LaunchError("Failed to allocate memory for the job.\n");
+        job->state = JOB_FINISHED;
+        return;
+    }
+    job->execution->SetProgressRegex(
+        json_utils::GetString(sub_definition, "progress_regex", nullptr));
+    if (job->use_input)
+        job->execution->SetStdin(job->input);
+    ProcessLimits limits;
+    if (GetProcessLimits(sub_definition, &limits))
+        job->execution->SetLimits(limits);
+    noex::string err;
+    if (job->use_pipeline)
+        err = job->execution->Start(job->pipeline);
+    else if (json_utils::GetBool(sub_definition, "shell", true))
+        err = job->execution->Start(job->cmd);
+    else
+        err = job->execution->Start(job->args);
+    if (!err.empty()) {
+        job->result = LaunchError(err);
+        job->state = JOB_FINISHED;
+        return;
+    }
+    PrintFmt("[JobQueue] Job #%d: Running (%s)\n", job->id, job->cmd.c_str());
+}
+
+Job* JobQueue::Update() noexcept {
+    // Start jobs in FIFO order.
+    size_t running_count = GetRunningCount();
+    for (Job* job : m_jobs) {
+        if (job->state != JOB_QUEUED)
+            continue;
+        if (running_count >= static_cast<size_t>(job->max_parallel))
+            break;
+        StartJob(job);
+        if (job->state == JOB_RUNNING)
+            running_count++;
+    }
+
+    for (size_t i = 0; i < m_jobs.size(); i++) {
+        Job* job = m_jobs[i];
+        if (job->state == JOB_RUNNING && !job->execution->Update()) {
+            job->result = job->execution->Finish();
+            job->state = JOB_FINISHED;
+            ReportResult(*job->sub_definition, job->cmd, job->result);
+        }
+        if (job->state != JOB_FINISHED)
+            continue;
+
+        // Remove the job from the queue.
+        for (size_t j = i + 1; j < m_jobs.size(); j++)
+            m_jobs[j - 1] = m_jobs[j];
+        m_jobs.pop_back();
+        PrintFmt("[JobQueue] Job #%d: Finished (exit code: %d)\n",
+                 job->id, job->result.exit_code);
+        return job;
+    }
+    return nullptr;
+}
+
+size_t JobQueue::GetQueuedCount() const noexcept {
+    size_t count = 0;
+    for (const Job* job : m_jobs) {
+        if (job->state == JOB_QUEUED)
+            count++;
+    }
+    return count;
+}
+
+size_t JobQueue::GetRunningCount() const noexcept {
+    size_t count = 0;
+    for (const Job* job : m_jobs) {
+        if (job->state == JOB_RUNNING)
+            count++;
+    }
+    return count;
+}
+
+void JobQueue::Clear() noexcept {
+    for (Job* job : m_jobs) {
+        // The destructor of AsyncExecution kills the process.
+        DeleteJob(job);
+    }
+    m_jobs.clear();
+}
@@ -66,11 +66,11 @@ noex::string Value::GetLineColumnStr() const noexcept {
 
 void Value::FreeValue() noexcept {
     if (m_type == JSON_TYPE_OBJECT && u.m_object) {
-        noex::del_ref(u.m_object);
+        noex::del_ref(u.m_object, noex::ALLOC_JSON);
     } else if (m_type == JSON_TYPE_ARRAY && u.m_array) {
-        noex::del_ref(u.m_array);
+        noex::del_ref(u.m_array, noex::ALLOC_JSON);
     } else if (m_type == JSON_TYPE_STRING && u.m_string) {
-        noex::del_ref(u.m_string);
+        noex::del_ref(u.m_string, noex::ALLOC_JSON);
     }
 }
 
@@ -113,7 +113,7 @@ void Value::Swap(Value& val) noexcept {
 void Value::SetObject() noexcept {
     FreeValue();
     m_type = JSON_TYPE_OBJECT;
-    u.m_object = noex::new_ref<Object>();
+    u.m_object = noex::new_ref<Object>(noex::ALLOC_JSON);
 }
 
 static Value* get_object_ptr(const Object* obj, const char* key) {
@@ -170,7 +170,7 @@ void Value::ConvertToObject(const char* key) noexcept {
 void Value::SetArray() noexcept {
     FreeValue();
     m_type = JSON_TYPE_ARRAY;
-    u.m_array = noex::new_ref<Array>();
+    u.m_array = noex::new_ref<Array>(noex::ALLOC_JSON);
 }
 
 void Value::ConvertToArray() noexcept {
@@ -188,7 +188,7 @@ void Value::ConvertToArray() noexcept {
 void Value::SetString() noexcept {
     FreeValue();
     m_type = JSON_TYPE_STRING;
-    u.m_string = noex::new_ref<noex::string>();
+    u.m_string = noex::new_ref<noex::string>(noex::ALLOC_JSON);
 }
 
 void Value::SetString(const char* val) noexcept {
@@ -197,6 +197,12 @@ void Value::SetString(const char* val) noexcept {
         *u.m_string = val;
 }
 
+void Value::SetString(const char* val, size_t size) noexcept {
+    SetString();
+    if (u.m_string)
+        *u.m_string = noex::string(val, size);
+}
+
 void Value::SetInt(int val) noexcept {
     FreeValue();
     m_type = JSON_TYPE_INT;
@@ -645,10 +651,18 @@ static bool need_escape(char c) noexcept {
             c == '\f' || c == '\n' || c == '\r' || c == '\t';
 }
 
-void Writer::WriteString(const char* str) noexcept {
+void Writer::WriteString(const char* str, size_t size) noexcept {
+    static const char hex[] = "0123456789abcdef";
     WriteChar('"');
-    while (*str && m_buf) {
+    for (const char* end = str + size; str < end && m_buf; str++) {
         char c = *str;
+        unsigned char uc = static_cast<unsigned char>(c);
+        if (uc < 0x20 && !need_escape(c)) {
+            // e.g. ESC of ANSI escape sequences
+            char escaped[6] = { '\\', 'u', '0', '0', hex[uc >> 4], hex[uc & 0xF] };
+            WriteBytes(escaped, sizeof(escaped));
+            continue;
+        }
         if (need_escape(c))
             WriteChar('\\');
         if (c == '\b') {
@@ -664,7 +678,6 @@ void Writer::WriteString(const char* str) noexcept {
         } else {
             WriteChar(c);
         }
-        str++;
     }
     WriteChar('"');
 }
@@ -677,7 +690,7 @@ void Writer::WriteObject(const Object* obj) noexcept {
     size_t object_size = obj->size();
     for (size_t i = 0; i < object_size; i++) {
         Item& item = obj->at(i);
-        WriteString(item.key.c_str());
+        WriteString(item.key);
         WriteBytes(": ", 2);
         WriteValue(item.val);
         if (i + 1 < object_size) {
@@ -719,7 +732,7 @@ void Writer::WriteValue(const Value* val) noexcept {
     } else if (type == JSON_TYPE_ARRAY) {
         WriteArray(val->GetArray());
     } else if (type == JSON_TYPE_STRING) {
-        WriteString(val->GetString());
+        WriteString(val->GetString(), val->GetStringSize());
     } else if (type == JSON_TYPE_INT) {
         noex::string str = noex::to_string(val->GetInt());
         WriteBytes(str.c_str(), str.size());
@@ -5,8 +5,10 @@
 #include <cassert>
 
 #include "json.h"
+#include "exe_container.h"
 #include "tuw_constants.h"
 #include "string_utils.h"
+#include "validator.h"
 #include "noex/vector.hpp"
 
 #ifdef _WIN32
@@ -69,21 +71,37 @@ noex::string LoadJson(const noex::string& file, tuwjson::Value& json) noexcept {
     return "";
 }
 
-noex::string SaveJson(tuwjson::Value& json, const noex::string& file) noexcept {
-    FILE* fp = FileOpen(file.c_str(), FILE_MODE_WRITE);
-    if (!fp)
-        return GetFileError(file);
-
+noex::string SaveJson(tuwjson::Value& json, const noex::string& file, bool compact) noexcept {
     char buffer[JSON_SIZE_MAX];
     tuwjson::Writer writer("    ", 4, true);
+    if (compact)
+        writer.Init("", 0, false);
     char* end = writer.WriteJson(&json, buffer, JSON_SIZE_MAX);
-    if (end)
-        fwrite(buffer, sizeof(char), end - buffer, fp);
+    if (!end)
+        return writer.GetErrMsg();
 
+    FILE* fp = FileOpen(file.c_str(), FILE_MODE_WRITE);
+    if (!fp)
+        return GetFileError(file);
+    fwrite(buffer, sizeof(char), end - buffer, fp);
     fclose(fp);
+    return "";
+}
 
+noex::string AppendJsonLine(tuwjson::Value& json, const noex::string& file) noexcept {
+    char buffer[JSON_SIZE_MAX];
+    tuwjson::Writer writer("", 0, false);
+    char* end = writer.WriteJson(&json, buffer, JSON_SIZE_MAX - 1);
     if (!end)
         return writer.GetErrMsg();
+    *end = '\n';
+    end++;
+
+    FILE* fp = FileOpen(file.c_str(), FILE_MODE_APPEND);
+    if (!fp)
+        return GetFileError(file);
+    fwrite(buffer, sizeof(char), end - buffer, fp);
+    fclose(fp);
     return "";
 }
 
@@ -119,6 +137,7 @@ enum class JsonType {
     JSON,
     ARRAY,
     STRING_ARRAY,
+    INT_ARRAY,
     JSON_ARRAY,
     MAX
 };
@@ -169,6 +188,16 @@ static tuwjson::Value* CheckJsonType(
             }
         }
         break;
+    case JsonType::INT_ARRAY:
+        valid = true;
+        type_name = "an array of ints";
+        for (const tuwjson::Value& el : *ptr) {
+            if (!el.IsInt()) {
+                valid = false;
+                break;
+            }
+        }
+        break;
     case JsonType::JSON_ARRAY:
         valid = true;
         type_name = "an array of json objects";
@@ -230,42 +259,144 @@ SubstrToChar(const char* str, char delimiter) noexcept {
     return noex::string(str, pos - str);
 }
 
-// split command by "%" symbol, and calculate which component should be inserted there.
-static void CompileCommand(noex::string& err_msg,
-                            tuwjson::Value& sub_definition,
-                            const noex::vector<noex::string>& comp_ids) noexcept {
-    noex::vector<noex::string> cmd_ids;
-    noex::vector<noex::string> splitted_cmd;
+static inline bool IsArgSeparator(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
 
-    tuwjson::Value splitted_cmd_json;
-    splitted_cmd_json.SetArray();
+// Builds ["command_argv"] for "shell": false and "worker".
+class ArgvBuilder {
+ private:
+    tuwjson::Value m_argv;
+    tuwjson::Value m_arg;
+    noex::string m_literal;
+    bool m_in_arg;
+    bool m_quoted;
+    char m_quote;
+
+    void FlushLiteral() noexcept {
+        // Quotes can make an empty argument. ("")
+        if (m_literal.empty() && !m_quoted)
+            return;
+        tuwjson::Value n;
+        n.SetString(m_literal);
+        m_arg.MoveAndPush(n);
+        m_literal = "";
+        m_quoted = false;
+    }
+
+    void FlushArg() noexcept {
+        if (!m_in_arg)
+            return;
+        FlushLiteral();
+        m_argv.MoveAndPush(m_arg);
+        m_arg.SetArray();
+        m_in_arg = false;
+    }
 
+ public:
+    ArgvBuilder() noexcept : m_literal(), m_in_arg(false), m_quoted(false), m_quote(0) {
+        m_argv.SetArray();
+        m_arg.SetArray();
+    }
+
+    // Splits a part of the command by spaces. Quotes can be used to escape spaces.
+    void PushLiteral(const char* str) noexcept {
+        for (const char* p = str; *p; p++) {
+            char c = *p;
+            if (m_quote) {
+                if (c == m_quote)
+                    m_quote = 0;
+                else
+                    m_literal.push_back(c);
+            } else if (c == '"' || c == '\'') {
+                m_quote = c;
+                m_quoted = true;
+                m_in_arg = true;
+            } else if (IsArgSeparator(c)) {
+                FlushArg();
+            } else {
+                m_literal.push_back(c);
+                m_in_arg = true;
+            }
+        }
+    }
+
+    // Component values are never splitted.
+    void PushId(int id) noexcept {
+        FlushLiteral();
+        tuwjson::Value n;
+        n.SetInt(id);
+        m_arg.MoveAndPush(n);
+        m_in_arg = true;
+    }
+
+    bool HasUnclosedQuote() const noexcept {
+        return m_quote != 0;
+    }
+
+    tuwjson::Value& GetArgv() noexcept {
+        FlushArg();
+        return m_argv;
+    }
+};
+
+// Split command into arguments, and store them as arrays of strings and component ids.
+static void CompileArgv(noex::string& err_msg,
+                        tuwjson::Value& argv,
+                        const noex::vector<noex::string>& splitted_cmd,
+                        const tuwjson::Value& cmd_int_ids,
+                        const noex::string& cmd_pos) noexcept {
+    ArgvBuilder builder;
+    for (size_t i = 0; i < splitted_cmd.size(); i++) {
+        builder.PushLiteral(splitted_cmd[i].c_str());
+        if (i < cmd_int_ids.GetArraySize())
+            builder.PushId(cmd_int_ids[i].GetInt());
+    }
+    if (builder.HasUnclosedQuote()) {
+        err_msg = "Found an unclosed quote in the command." + cmd_pos;
+        return;
+    }
+    argv.MoveFrom(builder.GetArgv());
+}
+
+// Returns an index of the name in ["resource_names"]. ("%__resource:name%")
+static int GetResourceIndex(tuwjson::Value& resource_names, const char* name) noexcept {
+    int i = 0;
+    for (const tuwjson::Value& n : resource_names) {
+        if (strcmp(n.GetString(), name) == 0)
+            return i;
+        i++;
+    }
+    tuwjson::Value n;
+    n.SetString(name);
+    resource_names.MoveAndPush(n);
+    return i;
+}
+
+// split command by "%" symbol, and calculate which component should be inserted there.
+static void SplitCommand(noex::string& err_msg,
+                         const char* cmd,
+                         const noex::string& cmd_pos,
+                         const noex::vector<noex::string>& comp_ids,
+                         noex::vector<noex::string>& splitted_cmd,
+                         tuwjson::Value& cmd_int_ids,
+                         tuwjson::Value& resource_names) noexcept {
+    noex::vector<noex::string> cmd_ids;
     bool store_ids = false;
-    tuwjson::Value& cmd_json = sub_definition["command"];
-    noex::string cmd_pos = cmd_json.GetLineColumnStr();
-    const char* cmd = cmd_json.GetString();
     while (*cmd != '\0') {
         noex::string token = SubstrToChar(cmd, '%');
-        if (store_ids) {
+        if (store_ids)
             cmd_ids.emplace_back(token);
-        } else {
+        else
             splitted_cmd.emplace_back(token);
-            tuwjson::Value n;
-            n.SetString(token);
-            splitted_cmd_json.MoveAndPush(n);
-        }
         store_ids = !store_ids;
         cmd += token.size();
         if (*cmd != '\0')
             cmd++;
     }
-    sub_definition["command_splitted"].MoveFrom(splitted_cmd_json);
 
-    tuwjson::Value& components = sub_definition["components"];
-    tuwjson::Value cmd_int_ids;
     cmd_int_ids.SetArray();
     int comp_size = static_cast<int>(comp_ids.size());
-    int non_id_comp = 0;
     for (int i = 0; i < static_cast<int>(cmd_ids.size()); i++) {
         const noex::string& id = cmd_ids[i];
         int j;
@@ -275,6 +406,14 @@ static void CompileCommand(noex::string& err_msg,
             j = CMD_ID_CURRENT_DIR;
         } else if (id == CMD_TOKEN_HOME_DIR) {
             j = CMD_ID_HOME_DIR;
+        } else if (id.starts_with(CMD_TOKEN_RESOURCE)) {
+            const char* name = id.c_str() + strlen(CMD_TOKEN_RESOURCE);
+            if (!IsValidResourceName(name)) {
+                err_msg = noex::concat_cstr(
+                    "Invalid resource name \"", name, "\" in the command.") + cmd_pos;
+                return;
+            }
+            j = CMD_ID_RESOURCE - GetResourceIndex(resource_names, name);
         } else {
             for (j = 0; j < comp_size; j++)
                 if (id == comp_ids[j]) break;
@@ -288,12 +427,84 @@ static void CompileCommand(noex::string& err_msg,
         n.SetInt(j);
         cmd_int_ids.MoveAndPush(n);
     }
+}
+
+// Compiles each command of "pipeline" to ["pipeline_argv"].
+static void CompilePipeline(noex::string& err_msg,
+                            tuwjson::Value& sub_definition,
+                            const noex::vector<noex::string>& comp_ids) noexcept {
+    tuwjson::Value pipeline_argv;
+    pipeline_argv.SetArray();
+    for (const tuwjson::Value& stage : sub_definition["pipeline"]) {
+        noex::string stage_pos = stage.GetLineColumnStr();
+        noex::vector<noex::string> splitted_cmd;
+        tuwjson::Value cmd_int_ids;
+        SplitCommand(err_msg, stage.GetString(), stage_pos, comp_ids, splitted_cmd, cmd_int_ids,
+                     sub_definition["resource_names"]);
+        if (!err_msg.empty()) return;
+        tuwjson::Value argv;
+        CompileArgv(err_msg, argv, splitted_cmd, cmd_int_ids, stage_pos);
+        if (!err_msg.empty()) return;
+        if (argv.IsEmptyArray()) {
+            err_msg = "\"pipeline\" has an empty command." + stage_pos;
+            return;
+        }
+        pipeline_argv.MoveAndPush(argv);
+    }
+    sub_definition["pipeline_argv"].MoveFrom(pipeline_argv);
+}
+
+static void CompileCommand(noex::string& err_msg,
+                            tuwjson::Value& sub_definition,
+                            const noex::vector<noex::string>& comp_ids) noexcept {
+    sub_definition["resource_names"].SetArray();
+    // Check stages first to show their positions in error messages.
+    bool use_pipeline = sub_definition.HasMember("pipeline");
+    if (use_pipeline) {
+        CompilePipeline(err_msg, sub_definition, comp_ids);
+        if (!err_msg.empty()) return;
+    }
+
+    tuwjson::Value& cmd_json = sub_definition["command"];
+    noex::string cmd_pos = cmd_json.GetLineColumnStr();
+    noex::vector<noex::string> splitted_cmd;
+    tuwjson::Value cmd_int_ids;
+    SplitCommand(err_msg, cmd_json.GetString(), cmd_pos, comp_ids, splitted_cmd, cmd_int_ids,
+                 sub_definition["resource_names"]);
+    if (!err_msg.empty()) return;
+
+    tuwjson::Value splitted_cmd_json;
+    splitted_cmd_json.SetArray();
+    for (const noex::string& token : splitted_cmd) {
+        tuwjson::Value n;
+        n.SetString(token);
+        splitted_cmd_json.MoveAndPush(n);
+    }
+    sub_definition["command_splitted"].MoveFrom(splitted_cmd_json);
+
+    tuwjson::Value& components = sub_definition["components"];
+    int comp_size = static_cast<int>(comp_ids.size());
+
+    // "stdin" can use a component that is not in the command.
+    int stdin_id = -1;
+    tuwjson::Value* stdin_ptr = sub_definition.GetMemberPtr("stdin");
+    if (stdin_ptr) {
+        for (stdin_id = 0; stdin_id < comp_size; stdin_id++)
+            if (comp_ids[stdin_id] == stdin_ptr->GetString()) break;
+        if (stdin_id == comp_size) {
+            err_msg = noex::concat_cstr(
+                "There is undefined id \"", stdin_ptr->GetString(), "\" in \"stdin\".")
+                + stdin_ptr->GetLineColumnStr();
+            return;
+        }
+        sub_definition["stdin_id"].SetInt(stdin_id);
+    }
 
     // Find unused IDs.
     for (int j = 0; j < comp_size; j++) {
         tuwjson::Value& v = components[j];
         int type_int = v["type_int"].GetInt();
-        if (type_int == COMP_STATIC_TEXT || type_int == COMP_EMPTY)
+        if (type_int == COMP_STATIC_TEXT || type_int == COMP_EMPTY || j == stdin_id)
             continue;
         bool found = false;
         for (tuwjson::Value& id : cmd_int_ids)
@@ -311,6 +522,11 @@ static void CompileCommand(noex::string& err_msg,
         }
     }
     sub_definition["command_ids"].MoveFrom(cmd_int_ids);
+
+    if (!use_pipeline &&
+            (!GetBool(sub_definition, "shell", true) || sub_definition.HasMember("worker")))
+        CompileArgv(err_msg, sub_definition["command_argv"],
+                    splitted_cmd, sub_definition["command_ids"], cmd_pos);
 }
 
 // don't use map. it will make exe larger.
@@ -359,6 +575,63 @@ void CheckValidator(noex::string& err_msg, tuwjson::Value& validator) noexcept {
     CheckJsonType(err_msg, validator, "not_empty_error", JsonType::STRING);
 }
 
+// validate "nice", "cpu_affinity", "memory_limit_mb", "cpu_limit",
+// "timeout_ms", and "kill_grace_ms"
+static void CheckProcessLimits(noex::string& err_msg,
+                               tuwjson::Value& sub_definition) noexcept {
+    tuwjson::Value* json_ptr =
+        CheckJsonType(err_msg, sub_definition, "nice", JsonType::INTEGER);
+    if (!err_msg.empty()) return;
+    if (json_ptr && (json_ptr->GetInt() < -20 || json_ptr->GetInt() > 19)) {
+        err_msg = "\"nice\" should be an integer from -20 to 19."
+                    + json_ptr->GetLineColumnStr();
+        return;
+    }
+    json_ptr = CheckJsonType(err_msg, sub_definition, "cpu_affinity", JsonType::INT_ARRAY);
+    if (!err_msg.empty()) return;
+    if (json_ptr) {
+        if (json_ptr->IsEmptyArray()) {
+            err_msg = "\"cpu_affinity\" should NOT be empty." + json_ptr->GetLineColumnStr();
+            return;
+        }
+        for (const tuwjson::Value& cpu : *json_ptr) {
+            if (cpu.GetInt() < 0 || cpu.GetInt() > 63) {
+                err_msg = "\"cpu_affinity\" only supports CPU numbers from 0 to 63."
+                            + cpu.GetLineColumnStr();
+                return;
+            }
+        }
+    }
+    const char* const positive_keys[] = { "memory_limit_mb", "cpu_limit", "timeout_ms" };
+    for (const char* key : positive_keys) {
+        json_ptr = CheckJsonType(err_msg, sub_definition, key, JsonType::INTEGER);
+        if (!err_msg.empty()) return;
+        if (json_ptr && json_ptr->GetInt() <= 0) {
+            err_msg = noex::concat_cstr("\"", key, "\" should be a positive integer.")
+                        + json_ptr->GetLineColumnStr();
+            return;
+        }
+    }
+    json_ptr = CheckJsonType(err_msg, sub_definition, "kill_grace_ms", JsonType::INTEGER);
+    if (!err_msg.empty()) return;
+    if (json_ptr && json_ptr->GetInt() < 0) {
+        err_msg = "\"kill_grace_ms\" should NOT be negative." + json_ptr->GetLineColumnStr();
+        return;
+    }
+    if (!sub_definition.HasMember("worker"))
+        return;
+    const char* const limit_keys[] = {
+        "nice", "cpu_affinity", "memory_limit_mb", "cpu_limit", "timeout_ms", "kill_grace_ms"
+    };
+    for (const char* key : limit_keys) {
+        if (sub_definition.HasMember(key)) {
+            err_msg = noex::concat_cstr("\"", key, "\" can NOT be used with \"worker\".")
+                        + sub_definition[key].GetLineColumnStr();
+            return;
+        }
+    }
+}
+
 // validate one of definitions (["gui"][i]) and store parsed info
 void CheckSubDefinition(noex::string& err_msg, tuwjson::Value& sub_definition,
                         int index) noexcept {
@@ -382,6 +655,33 @@ void CheckSubDefinition(noex::string& err_msg, tuwjson::Value& sub_definition,
     CheckJsonType(err_msg, sub_definition, "show_last_line", JsonType::BOOLEAN);
     CheckJsonType(err_msg, sub_definition,
                     "show_success_dialog", JsonType::BOOLEAN);
+    CheckJsonType(err_msg, sub_definition, "shell", JsonType::BOOLEAN);
+    CheckJsonType(err_msg, sub_definition, "history", JsonType::STRING);
+    CheckJsonType(err_msg, sub_definition, "output_log", JsonType::STRING);
+    json_ptr = CheckJsonType(err_msg, sub_definition, "stdin", JsonType::STRING);
+    if (!err_msg.empty()) return;
+    if (json_ptr && sub_definition.HasMember("worker")) {
+        err_msg = "\"stdin\" can NOT be used with \"worker\"." + json_ptr->GetLineColumnStr();
+        return;
+    }
+    json_ptr = CheckJsonType(err_msg, sub_definition, "progress_regex", JsonType::STRING);
+    if (!err_msg.empty()) return;
+    if (json_ptr && IsUnsupportedPattern(json_ptr->GetString())) {
+        err_msg = "\"progress_regex\" doesn't support () operators."
+                    + json_ptr->GetLineColumnStr();
+        return;
+    }
+    CheckJsonType(err_msg, sub_definition, "worker", JsonType::STRING);
+    CheckJsonType(err_msg, sub_definition, "cache", JsonType::BOOLEAN);
+    json_ptr = CheckJsonType(err_msg, sub_definition, "max_parallel", JsonType::INTEGER);
+    if (!err_msg.empty()) return;
+    if (json_ptr && json_ptr->GetInt() <= 0) {
+        err_msg = "\"max_parallel\" should be a positive integer."
+                    + json_ptr->GetLineColumnStr();
+        return;
+    }
+    CheckProcessLimits(err_msg, sub_definition);
+    if (!err_msg.empty()) return;
     json_ptr = CheckJsonType(err_msg, sub_definition, "codepage", JsonType::STRING);
     if (json_ptr) {
         const char* codepage = json_ptr->GetString();
@@ -583,6 +883,35 @@ void CheckSubDefinition(noex::string& err_msg, tuwjson::Value& sub_definition,
         sub_definition["command"].CopyFrom(*json_ptr);
     }
 
+    // Join commands of "pipeline" to ["command"] for logging. (e.g. "cmd1 | cmd2")
+    // Windows runs the joined command via shell.
+    json_ptr = CheckJsonType(err_msg, sub_definition, "pipeline", JsonType::STRING_ARRAY);
+    if (!err_msg.empty()) return;
+    if (json_ptr && !sub_definition.HasMember("pipeline_argv")) {
+        if (sub_definition.HasMember("command")) {
+            err_msg = "\"pipeline\" can NOT be used with \"command\"."
+                        + json_ptr->GetLineColumnStr();
+            return;
+        }
+        if (sub_definition.HasMember("worker")) {
+            err_msg = "\"pipeline\" can NOT be used with \"worker\"."
+                        + json_ptr->GetLineColumnStr();
+            return;
+        }
+        if (json_ptr->IsEmptyArray()) {
+            err_msg = "\"pipeline\" should NOT be empty." + json_ptr->GetLineColumnStr();
+            return;
+        }
+        noex::string joined;
+        for (const tuwjson::Value& stage : *json_ptr) {
+            if (!joined.empty())
+                joined += " | ";
+            joined += stage.GetString();
+        }
+        sub_definition["command"].SetString(joined);
+        sub_definition["shell"].SetBool(true);
+    }
+
     // check sub_definition["command"] and convert it to more useful format.
     CheckJsonType(err_msg, sub_definition, "command", JsonType::STRING, "gui definition", REQUIRED);
     if (!err_msg.empty()) return;
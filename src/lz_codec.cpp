@@ -0,0 +1,134 @@
+#include "lz_codec.h"
+#include <stdint.h>
+#include <string.h>
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 0xFFFF;
+constexpr int HASH_BITS = 12;
+
+static uint32_t Load32(const unsigned char* p) noexcept {
+    uint32_t n;
+    memcpy(&n, p, 4);
+    return n;
+}
+
+static uint32_t Hash(uint32_t seq) noexcept {
+    return (seq * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Writes 15 or more to the token and extra bytes.
+static bool WriteLength(unsigned char* dst, size_t dst_size, size_t* pos, size_t len) noexcept {
+    for (len -= 15; ; len -= 255) {
+        if (*pos >= dst_size)
+            return false;
+        if (len < 255) {
+            dst[(*pos)++] = static_cast<unsigned char>(len);
+            return true;
+        }
+        dst[(*pos)++] = 255;
+    }
+}
+
+// Writes literals and a match. match_len is 0 for the last sequence.
+static bool WriteSequence(unsigned char* dst, size_t dst_size, size_t* pos,
+                          const unsigned char* literals, size_t literal_len,
+                          size_t offset, size_t match_len) noexcept {
+    if (*pos >= dst_size)
+        return false;
+    size_t token_pos = (*pos)++;
+    size_t match_code = match_len ? match_len - MIN_MATCH : 0;
+    dst[token_pos] = static_cast<unsigned char>(
+        ((literal_len < 15 ? literal_len : 15) << 4) | (match_code < 15 ? match_code : 15));
+    if (literal_len >= 15 && !WriteLength(dst, dst_size, pos, literal_len))
+        return false;
+    if (literal_len > dst_size - *pos)
+        return false;
+    memcpy(dst + *pos, literals, literal_len);
+    *pos += literal_len;
+    if (match_len == 0)
+        return true;
+    if (dst_size - *pos < 2)
+        return false;
+    dst[(*pos)++] = static_cast<unsigned char>(offset & 0xFF);
+    dst[(*pos)++] = static_cast<unsigned char>(offset >> 8);
+    return match_code < 15 || WriteLength(dst, dst_size, pos, match_code);
+}
+
+size_t LzCompress(const char* src, size_t src_size, char* dst, size_t dst_size) noexcept {
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+    unsigned char* out = reinterpret_cast<unsigned char*>(dst);
+    // Positions + 1 of recent 4-byte sequences. 0 means empty.
+    size_t table[1 << HASH_BITS] = { 0 };
+    size_t anchor = 0;
+    size_t pos = 0;
+    size_t out_pos = 0;
+    while (pos + MIN_MATCH <= src_size) {
+        uint32_t seq = Load32(in + pos);
+        uint32_t h = Hash(seq);
+        size_t candidate = table[h];
+        table[h] = pos + 1;
+        if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+            Load32(in + candidate - 1) != seq) {
+            pos++;
+            continue;
+        }
+        size_t match = candidate - 1;
+        size_t len = MIN_MATCH;
+        while (pos + len < src_size && in[match + len] == in[pos + len])
+            len++;
+        if (!WriteSequence(out, dst_size, &out_pos, in + anchor, pos - anchor, pos - match, len))
+            return 0;
+        pos += len;
+        anchor = pos;
+    }
+    if (!WriteSequence(out, dst_size, &out_pos, in + anchor, src_size - anchor, 0, 0))
+        return 0;
+    return out_pos;
+}
+
+static bool ReadLength(const unsigned char** p, const unsigned char* end, size_t* len) noexcept {
+    unsigned char c;
+    do {
+        if (*p >= end)
+            return false;
+        c = *(*p)++;
+        *len += c;
+    } while (c == 255);
+    return true;
+}
+
+bool LzDecompress(const char* src, size_t src_size, char* dst, size_t dst_size) noexcept {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* end = p + src_size;
+    size_t out_pos = 0;
+    while (p < end) {
+        unsigned char token = *p++;
+        size_t literal_len = token >> 4;
+        if (literal_len == 15 && !ReadLength(&p, end, &literal_len))
+            return false;
+        if (literal_len > static_cast<size_t>(end - p) || literal_len > dst_size - out_pos)
+            return false;
+        memcpy(dst + out_pos, p, literal_len);
+        p += literal_len;
+        out_pos += literal_len;
+        if (p == end)
+            break;
+
+        if (end - p < 2)
+            return false;
+        size_t offset = p[0] | (p[1] << 8);
+        p += 2;
+        if (offset == 0 || offset > out_pos)
+            return false;
+        size_t match_len = token & 15;
+        if (match_len == 15 && !ReadLength(&p, end, &match_len))
+            return false;
+        match_len += MIN_MATCH;
+        if (match_len > dst_size - out_pos)
+            return false;
+        // Matches can overlap with the output. (e.g. runs of the same char)
+        for (size_t i = 0; i < match_len; i++, out_pos++)
+            dst[out_pos] = dst[out_pos - offset];
+    }
+    return out_pos == dst_size;
+}
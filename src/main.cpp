@@ -2,15 +2,23 @@
 #ifdef _WIN32
 #include <locale.h>
 #else
+#include <signal.h>
 #include <sys/stat.h>
 #endif
 #include "ui.h"
 #include "json_utils.h"
 #include "main_frame.h"
 #include "exe_container.h"
+#include "command.h"
+#include "exec.h"
 #include "env_utils.h"
 #include "string_utils.h"
 #include "tuw_constants.h"
+#include "server.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "zygote.h"
+#include "noex/new.hpp"
 
 #ifdef _WIN32
 #include "windows/uipriv_windows.hpp"
@@ -22,6 +30,12 @@ int main_app(const char* json_path = nullptr) noexcept {
     EnableCSI();
 #endif
 
+#ifdef TUW_USE_ZYGOTE
+    // Fork the zygote while the process is still small.
+    // Child processes will be spawned with posix_spawn if this failed.
+    ZygoteStart();
+#endif
+
     uiInitOptions ui_options;
     const char *err;
 
@@ -38,7 +52,7 @@ int main_app(const char* json_path = nullptr) noexcept {
     uiMainSteps();
 #endif
 
-    MainFrame main_frame = MainFrame(json_path);
+    MainFrame main_frame(json_path);
     uiMain();
     return 0;
 }
@@ -52,11 +66,68 @@ bool AskOverwrite(const char *path) noexcept {
     return ret == 1 && (answer == 'y' || answer == 'Y');
 }
 
+// Parses "-p int". Serve and batch merge use 4 by default.
+static noex::string GetMaxParallel(const char* parallel_str, int* max_parallel) noexcept {
+    *max_parallel = SERVE_PARALLEL_DEFAULT;
+    if (!parallel_str)
+        return "";
+    char* end;
+    *max_parallel = static_cast<int>(strtol(parallel_str, &end, 10));
+    if (!*parallel_str || *end || *max_parallel <= 0)
+        return noex::concat_cstr("Invalid number of parallel jobs. (", parallel_str, ")");
+    return "";
+}
+
+// Embeds files. ("-r name=path")
+static noex::string AddResources(ExeContainer& exe,
+                                 const noex::vector<const char*>& resources) noexcept {
+    for (const char* res : resources) {
+        const char* eq = noex::find_chr(res, '=');
+        if (!eq)
+            return noex::concat_cstr("Resource should be 'name=path'. (", res, ")");
+        noex::string name(res, static_cast<size_t>(eq - res));
+        PrintFmt("Importing a resource... (%s)\n", eq + 1);
+        noex::string err = exe.AddResource(name.c_str(), eq + 1);
+        if (!err.empty())
+            return err;
+    }
+    return "";
+}
+
+// Embeds json into a copy of the exe.
+// Rewrites only the JSON when the output was made from the same executable.
+// Outputs with resources are rebuilt to have the same resources as the exe.
+static noex::string WriteMergedExe(ExeContainer& exe, tuwjson::Value& json,
+                                   const noex::string& new_path, bool compress,
+                                   bool* updated) noexcept {
+    ExeContainer target;
+    *updated = exe.GetResourceCount() == 0 &&
+               envuFileExists(new_path.c_str()) && target.Read(new_path).empty() &&
+               target.HasJson() && target.GetResourceCount() == 0 && target.HasSameExe(exe);
+    ExeContainer& output = *updated ? target : exe;
+    output.SetJson(json);
+    output.SetCompression(compress);
+    noex::string err = output.Write(new_path);
+    if (!err.empty())
+        return err;
+#ifndef _WIN32
+    // Allow executing file as program.
+    chmod(new_path.c_str(),
+          S_IRUSR | S_IWUSR | S_IXUSR |  // rwx
+          S_IRGRP | S_IXGRP |  // r-x
+          S_IROTH | S_IXOTH);  // r-x
+#endif
+    return "";
+}
+
 noex::string Merge(const noex::string& exe_path, const noex::string& json_path,
-                    const noex::string& new_path, const bool force) noexcept {
+                    const noex::string& new_path, const bool force,
+                    const bool compress,
+                    const noex::vector<const char*>& resources) noexcept {
     ExeContainer exe;
     tuwjson::Value json;
     noex::string err;
+    bool updated;
     err = json_utils::LoadJson(json_path, json);
     if (!err.empty()) goto MERGE_END;
 
@@ -75,27 +146,154 @@ noex::string Merge(const noex::string& exe_path, const noex::string& json_path,
 
     err = exe.Read(exe_path);
     if (!err.empty()) goto MERGE_END;
+    err = AddResources(exe, resources);
+    if (!err.empty()) goto MERGE_END;
 
     PrintFmt("Importing a json file... (%s)\n", json_path.c_str());
-    exe.SetJson(json);
     if (!force && !AskOverwrite(new_path.c_str())) {
         PrintFmt("The operation has been cancelled.\n");
         goto MERGE_END;
     }
-    err = exe.Write(new_path);
+    err = WriteMergedExe(exe, json, new_path, compress, &updated);
     if (!err.empty()) goto MERGE_END;
-    PrintFmt("Generated an executable. (%s)\n", new_path.c_str());
-#ifndef _WIN32
-    // Allow executing file as program.
-    chmod(new_path.c_str(),
-          S_IRUSR | S_IWUSR | S_IXUSR |  // rwx
-          S_IRGRP | S_IXGRP |  // r-x
-          S_IROTH | S_IXOTH);  // r-x
-#endif
+    if (updated)
+        PrintFmt("Updated the embedded JSON. (%s)\n", new_path.c_str());
+    else
+        PrintFmt("Generated an executable. (%s)\n", new_path.c_str());
 MERGE_END:
     return err;
 }
 
+// An item of the manifest for "merge -b"
+struct MergeTask {
+    noex::string json_path;
+    noex::string new_path;
+    noex::string err;
+    bool updated;
+};
+
+struct BatchMergeContext {
+    const ExeContainer* exe;
+    noex::vector<MergeTask>* tasks;
+    bool force;
+    bool compress;
+};
+
+// Full paths are compared. Windows ignores cases of file names.
+static bool IsSamePath(const noex::string& path1, const noex::string& path2) noexcept {
+#ifdef _WIN32
+    return _stricmp(path1.c_str(), path2.c_str()) == 0;
+#else
+    return path1 == path2;
+#endif
+}
+
+// Runs on worker threads. Each task edits only its own strings.
+static void RunMergeTask(size_t id, void* data) noexcept {
+    TUW_TRACE_SCOPE("RunMergeTask");
+    BatchMergeContext* ctx = static_cast<BatchMergeContext*>(data);
+    MergeTask& task = (*ctx->tasks)[id];
+    if (!task.err.empty())
+        return;
+    if (!ctx->force && envuFileExists(task.new_path.c_str())) {
+        task.err = "File already exists. Use -f to overwrite it.";
+        return;
+    }
+
+    tuwjson::Value json;
+    task.err = json_utils::LoadJson(task.json_path, json);
+    if (!task.err.empty()) return;
+    if (json.IsEmptyObject()) {
+        task.err = "JSON file loaded but it has no data.";
+        return;
+    }
+    {
+        tuwjson::Value tmp_json;
+        tmp_json.CopyFrom(json);
+        json_utils::CheckDefinition(task.err, tmp_json);
+    }
+    if (!task.err.empty()) return;
+
+    // The base exe was read only once.
+    ExeContainer exe;
+    exe.CopyFrom(*ctx->exe);
+    task.err = WriteMergedExe(exe, json, task.new_path, ctx->compress, &task.updated);
+}
+
+// Merges the executable with many JSON files on worker threads.
+// The manifest is {"items": [{"json": "path/to/json", "exe": "path/to/new/exe"}, ...]}
+// Failed items are reported, and the others are still processed.
+noex::string BatchMerge(const noex::string& exe_path, const char* manifest_path,
+                        const bool force, const bool compress,
+                        const noex::vector<const char*>& resources,
+                        const char* parallel_str) noexcept {
+    int max_parallel;
+    noex::string err = GetMaxParallel(parallel_str, &max_parallel);
+    if (!err.empty())
+        return err;
+    tuwjson::Value manifest;
+    err = json_utils::LoadJson(manifest_path, manifest);
+    if (!err.empty())
+        return err;
+    tuwjson::Value* items = manifest.GetMemberPtr("items");
+    if (!items || !items->IsArray())
+        return noex::concat_cstr(
+            "The manifest should have an \"items\" array. (", manifest_path, ")");
+
+    noex::vector<MergeTask> tasks;
+    for (const tuwjson::Value& item : *items) {
+        tuwjson::Value* json_ptr = item.IsObject() ? item.GetMemberPtr("json") : nullptr;
+        tuwjson::Value* exe_ptr = item.IsObject() ? item.GetMemberPtr("exe") : nullptr;
+        if (!json_ptr || !json_ptr->IsString() || !exe_ptr || !exe_ptr->IsString())
+            return "Items of the manifest should have \"json\" and \"exe\" strings."
+                   + item.GetLineColumnStr();
+        MergeTask task;
+        task.json_path = envuStr(envuGetFullPath(json_ptr->GetString()));
+        task.new_path = envuStr(envuGetFullPath(exe_ptr->GetString()));
+        task.updated = false;
+        if (task.new_path == exe_path)
+            task.err = "Can NOT overwrite the executable itself.";
+        // Threads should not write to the same file at the same time.
+        for (const MergeTask& prev : tasks) {
+            if (IsSamePath(prev.new_path, task.new_path))
+                return noex::concat_cstr("Duplicated \"exe\" in the manifest: ",
+                                         task.new_path.c_str(), item.GetLineColumnStr().c_str());
+        }
+        tasks.emplace_back(task);
+    }
+
+    ExeContainer exe;
+    err = exe.Read(exe_path);
+    if (!err.empty())
+        return err;
+    err = AddResources(exe, resources);
+    if (!err.empty())
+        return err;
+    err = exe.ComputeBaseHash();
+    if (!err.empty())
+        return err;
+
+    PrintFmt("Merging %d JSON files with %d threads...\n",
+             static_cast<int>(tasks.size()), max_parallel);
+    BatchMergeContext ctx = { &exe, &tasks, force, compress };
+    RunTasks(RunMergeTask, tasks.size(), max_parallel, &ctx);
+
+    int failed = 0;
+    for (const MergeTask& task : tasks) {
+        if (task.err.empty()) {
+            PrintFmt("%s an executable. (%s)\n",
+                     task.updated ? "Updated" : "Generated", task.new_path.c_str());
+        } else {
+            FprintFmt(stderr, "Error: %s (%s)\n", task.err.c_str(), task.json_path.c_str());
+            failed++;
+        }
+    }
+    if (failed > 0)
+        return "Failed to merge " + noex::to_string(failed) + " of " +
+               noex::to_string(tasks.size()) + " JSON files.";
+    return "";
+}
+
 noex::string Split(const noex::string& exe_path, const noex::string& json_path,
                     const noex::string& new_path, const bool force) noexcept {
     ExeContainer exe;
@@ -109,6 +307,12 @@ noex::string Split(const noex::string& exe_path, const noex::string& json_path,
     PrintFmt("Extracting JSON data from the executable...\n");
     exe.GetJson(json);
     exe.RemoveJson();
+    if (exe.GetResourceCount() > 0) {
+        // Resources are stored only with JSON.
+        PrintFmt("Removing embedded resources... (%d files)\n",
+                 static_cast<int>(exe.GetResourceCount()));
+        exe.ClearResources();
+    }
     if (!force && (!AskOverwrite(new_path.c_str()) || !AskOverwrite(json_path.c_str()))) {
         PrintFmt("The operation has been cancelled.\n");
         goto SPLIT_END;
@@ -130,6 +334,134 @@ SPLIT_END:
     return err;
 }
 
+// Sets the same working directory as the GUI and loads a checked definition.
+static noex::string LoadDefinition(const noex::string& exe_path, const char* json_path,
+                                   tuwjson::Value& definition) noexcept {
+    noex::string err;
+    noex::string workdir;
+    if (json_path)
+        workdir = envuStr(envuGetDirectory(json_path));
+    else
+        workdir = envuStr(envuGetDirectory(exe_path.c_str()));
+    if (!workdir.empty() && envuSetCwd(workdir.c_str()) != 0)
+        return "Failed to set a path as CWD. (" + workdir + ")";
+
+    if (json_path) {
+        err = json_utils::LoadJson(json_path, definition);
+    } else {
+        ExeContainer exe;
+        err = exe.Read(exe_path);
+        if (err.empty() && exe.HasJson())
+            exe.GetJson(definition);
+        else
+            err = json_utils::LoadJson(GetDefaultJsonPath(), definition);
+    }
+    if (!err.empty()) return err;
+
+    json_utils::CheckVersion(err, definition);
+    if (!err.empty()) return err;
+    json_utils::CheckDefinition(err, definition);
+    return err;
+}
+
+// Runs a command without GUI.
+// exit_code will be the exit code of the command.
+// Returns an error only when Tuw failed to start the command.
+noex::string Run(const noex::string& exe_path, const char* json_path,
+                 const char* config_path, const char* mode_str,
+                 const noex::vector<const char*>& values, int* exit_code) noexcept {
+    tuwjson::Value definition;
+    tuwjson::Value config;
+    noex::string err;
+    int mode = 0;
+    tuwjson::Value* sub_definition;
+    noex::vector<noex::string> args;
+    noex::string cmd;
+    Worker* worker = nullptr;
+    OutputLog output_log;
+    StdinContent input;
+    bool use_input = false;
+    Pipeline pipeline;
+    bool use_pipeline = false;
+
+    err = LoadDefinition(exe_path, json_path, definition);
+    if (!err.empty()) goto RUN_END;
+
+    if (config_path) {
+        err = json_utils::LoadJson(config_path, config);
+        if (!err.empty()) goto RUN_END;
+    } else {
+        config.SetObject();
+    }
+
+    mode = json_utils::GetInt(config, "_mode", 0);
+    if (mode_str) {
+        char* end;
+        mode = static_cast<int>(strtol(mode_str, &end, 10));
+        if (!*mode_str || *end)
+            mode = -1;
+    }
+    if (mode < 0 || mode >= static_cast<int>(definition["gui"].GetArraySize())) {
+        err = "Invalid definition index. (" + noex::to_string(mode) + ")";
+        goto RUN_END;
+    }
+    sub_definition = &definition["gui"][mode];
+
+    for (const char* value : values) {
+        err = SetConfigValue(*sub_definition, config, value);
+        if (!err.empty()) goto RUN_END;
+    }
+
+    {
+        ConfigValues config_values(*sub_definition, config);
+        err = config_values.Validate();
+        if (!err.empty()) goto RUN_END;
+
+        const char* worker_cmd = json_utils::GetString(*sub_definition, "worker", nullptr);
+        if (!worker_cmd && json_utils::GetBool(*sub_definition, "shell", true)) {
+            cmd = BuildCommand(*sub_definition, config_values, &err);
+        } else {
+            args = BuildCommandArgs(*sub_definition, config_values, &err);
+            cmd = ArgsToString(args);
+        }
+        use_input = BuildStdin(*sub_definition, config_values, &input);
+        use_pipeline = BuildPipeline(*sub_definition, config_values, &pipeline, &err);
+        if (!err.empty()) goto RUN_END;
+    }
+    PrintFmt("[RunCommand] Command: %s\n", cmd.c_str());
+
+    {
+        ExecuteDisableGui();
+        ExecuteResult result = ExecuteSubDefinition(*sub_definition, cmd, args,
+                                                    use_pipeline ? &pipeline : nullptr,
+                                                    use_input ? &input : nullptr,
+                                                    &worker, &output_log);
+        noex::del_ref(worker);
+        // stderr of the command has been printed already. It's not an error of Tuw.
+        if (result.launch_failed)
+            err = result.err_msg;
+        *exit_code = result.exit_code;
+    }
+
+RUN_END:
+    return err;
+}
+
+// Serves run requests over a Unix domain socket until SIGINT or SIGTERM.
+noex::string ServeRequests(const noex::string& exe_path, const char* json_path,
+                           const char* socket_path, const char* parallel_str) noexcept {
+    tuwjson::Value definition;
+    int max_parallel;
+    noex::string err = GetMaxParallel(parallel_str, &max_parallel);
+    if (!err.empty())
+        return err;
+    err = LoadDefinition(exe_path, json_path, definition);
+    if (!err.empty())
+        return err;
+    ExecuteDisableGui();
+    return Serve(definition, socket_path, max_parallel);
+}
+
 void PrintUsage() noexcept {
     static const char* const usage =
         "Usage: Tuw [<command> [<options>]]\n"
@@ -137,6 +469,8 @@ void PrintUsage() noexcept {
         "    command:\n"
         "        merge : merge this executable and a JSON file into a new exe.\n"
         "        split : split this executable into a JSON file and the original exe.\n"
+        "        run   : run a command without GUI, and exit with its exit code.\n"
+        "        serve : serve run requests over a Unix domain socket.\n"
         "        ver   : show the tool version.\n"
         "        help  : show this message.\n"
         "\n"
@@ -146,9 +480,29 @@ void PrintUsage() noexcept {
         "       -e str : path to a new executable file.\n"
         "                default to exe name + '.new'\n"
         "       -f     : Force to overwrite files.\n"
+        "       -z     : Compress the JSON for merge.\n"
+        "       -r str : 'name=path' to embed a file for merge.\n"
+        "                can be used multiple times\n"
+        "       -b str : path to a manifest to merge many JSON files at once.\n"
+        "       -c str : path to a config JSON for run.\n"
+        "                default to no config (default values)\n"
+        "       -m int : index of the GUI definition for run.\n"
+        "                default to '_mode' in the config, or 0\n"
+        "       -s str : 'id=value' to set a component value for run.\n"
+        "                can be used multiple times\n"
+        "       -u str : path to a socket file for serve.\n"
+        "                default to '" SERVE_SOCKET_DEFAULT "'\n"
+        "       -p int : max number of commands serve runs at the same time,\n"
+        "                or threads for merge -b.\n"
+        "                default to 4\n"
+        "       --trace str : path to write timings in Chrome trace event format.\n"
+        "                     can be used with any command, or without commands.\n"
         "\n"
         "Example:\n"
         "    Tuw merge -f -j my_definition.json -e MyGUI.exe\n"
+        "    Tuw run -j my_definition.json -s file=input.txt -s verbose=true\n"
+        "    Tuw serve -j my_definition.json -u /tmp/tuw.sock -p 8\n"
+        "    Tuw merge -f -b manifest.json -p 8\n"
         "\n";
 
     PrintFmt(usage);
@@ -158,6 +512,8 @@ enum Commands: int {
     CMD_UNKNOWN = 0,
     CMD_MERGE,
     CMD_SPLIT,
+    CMD_RUN,
+    CMD_SERVE,
     CMD_VERSION,
     CMD_HELP,
     CMD_MAX
@@ -174,6 +530,8 @@ int CmdToInt(const char* cmd) noexcept {
             return CMD_MERGE;
         if (c == 's')
             return CMD_SPLIT;
+        if (c == 'r')
+            return CMD_RUN;
         if (c == 'v')
             return CMD_VERSION;
         if (c == 'h')
@@ -183,6 +541,10 @@ int CmdToInt(const char* cmd) noexcept {
         return CMD_MERGE;
     if (strcmp(cmd, "split") == 0)
         return CMD_SPLIT;
+    if (strcmp(cmd, "run") == 0)
+        return CMD_RUN;
+    if (strcmp(cmd, "serve") == 0)
+        return CMD_SERVE;
     if (strcmp(cmd, "ver") == 0)
         return CMD_VERSION;
     if (strcmp(cmd, "help") == 0)
@@ -195,6 +557,14 @@ enum Options: int {
     OPT_JSON,
     OPT_EXE,
     OPT_FORCE,
+    OPT_CONFIG,
+    OPT_MODE,
+    OPT_SET,
+    OPT_SOCKET,
+    OPT_PARALLEL,
+    OPT_COMPRESS,
+    OPT_RESOURCE,
+    OPT_BATCH,
     OPT_MAX
 };
 
@@ -210,6 +580,22 @@ int OptToInt(const char* opt) noexcept {
             return OPT_EXE;
         if (c == 'f' || c == 'y')
             return OPT_FORCE;
+        if (c == 'c')
+            return OPT_CONFIG;
+        if (c == 'm')
+            return OPT_MODE;
+        if (c == 's')
+            return OPT_SET;
+        if (c == 'u')
+            return OPT_SOCKET;
+        if (c == 'p')
+            return OPT_PARALLEL;
+        if (c == 'z')
+            return OPT_COMPRESS;
+        if (c == 'r')
+            return OPT_RESOURCE;
+        if (c == 'b')
+            return OPT_BATCH;
     }
     if (strcmp(opt, "json") == 0)
         return OPT_JSON;
@@ -217,6 +603,22 @@ int OptToInt(const char* opt) noexcept {
         return OPT_EXE;
     if (strcmp(opt, "force") == 0)
         return OPT_FORCE;
+    if (strcmp(opt, "config") == 0)
+        return OPT_CONFIG;
+    if (strcmp(opt, "mode") == 0)
+        return OPT_MODE;
+    if (strcmp(opt, "set") == 0)
+        return OPT_SET;
+    if (strcmp(opt, "socket") == 0)
+        return OPT_SOCKET;
+    if (strcmp(opt, "parallel") == 0)
+        return OPT_PARALLEL;
+    if (strcmp(opt, "compress") == 0)
+        return OPT_COMPRESS;
+    if (strcmp(opt, "resource") == 0)
+        return OPT_RESOURCE;
+    if (strcmp(opt, "batch") == 0)
+        return OPT_BATCH;
     return OPT_UNKNOWN;
 }
 
@@ -231,6 +633,33 @@ void FreeArgs(noex::vector<char*>& args) noexcept {
 #define FreeArgs(args) (void)0
 #endif
 
+// Starts tracing with "--trace out.json" or TUW_TRACE=out.json,
+// and removes the option from args.
+static void StartTrace(noex::vector<char*>& args) noexcept {
+    const char* path = getenv("TUW_TRACE");
+    noex::string path_str;
+    for (size_t i = 1; i + 1 < args.size(); i++) {
+        if (strcmp(args[i], "--trace") != 0)
+            continue;
+        path_str = args[i + 1];
+        path = path_str.c_str();
+#ifdef _WIN32
+        uiprivFree(args[i]);
+        uiprivFree(args[i + 1]);
+#endif
+        for (size_t j = i + 2; j < args.size(); j++)
+            args[j - 2] = args[j];
+        args.pop_back();
+        args.pop_back();
+        break;
+    }
+    if (!path || !*path)
+        return;
+    noex::string err = TraceStart(path);
+    if (!err.empty())
+        FprintFmt(stderr, "Warning: Failed to start tracing. %s\n", err.c_str());
+}
+
 #ifdef _WIN32
 int wmain(int argc, wchar_t* argv[]) noexcept {
     setlocale(LC_CTYPE, "");
@@ -253,12 +682,30 @@ int main(int argc, char* argv[]) noexcept {
 #endif  // _WIN32
     }
 
+#ifndef _WIN32
+    // Make write() return EPIPE when a child process or a client closed the pipe.
+    // Child processes reset it with POSIX_SPAWN_SETSIGDEF.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    StartTrace(args);
+
     noex::string exe_path = envuStr(envuGetExecutablePath());
     const char* json_path_cstr = nullptr;
+    const char* config_path_cstr = nullptr;
+    const char* mode_cstr = nullptr;
+    const char* socket_path_cstr = SERVE_SOCKET_DEFAULT;
+    const char* parallel_cstr = nullptr;
+    const char* batch_path_cstr = nullptr;
+    noex::vector<const char*> values;
+    noex::vector<const char*> resources;
     noex::string json_path;
+    noex::string config_path;
+    noex::string socket_path;
     noex::string new_exe_path;
     int cmd_int;
     bool force = false;
+    bool compress = false;
     int ret = 0;
 
     // Launch GUI if no args.
@@ -288,11 +735,20 @@ int main(int argc, char* argv[]) noexcept {
     for (size_t i = 2; i < args.size(); i++) {
         const char* opt_str = args[i];
         int opt_int = OptToInt(opt_str);
-        if ((opt_int == OPT_JSON || opt_int == OPT_EXE) && args.size() <= i + 1) {
+        if ((opt_int == OPT_JSON || opt_int == OPT_EXE ||
+                opt_int == OPT_CONFIG || opt_int == OPT_SOCKET || opt_int == OPT_BATCH) &&
+                args.size() <= i + 1) {
             PrintUsage();
             FprintFmt(stderr, "Error: This option requires a file path. (%s)\n", opt_str);
             ret = 1;
             goto MAIN_END;
+        } else if ((opt_int == OPT_MODE || opt_int == OPT_SET ||
+                opt_int == OPT_PARALLEL || opt_int == OPT_RESOURCE) &&
+                args.size() <= i + 1) {
+            PrintUsage();
+            FprintFmt(stderr, "Error: This option requires a value. (%s)\n", opt_str);
+            ret = 1;
+            goto MAIN_END;
         } else if (opt_int == OPT_UNKNOWN) {
             PrintUsage();
             FprintFmt(stderr, "Error: Unknown option detected. (%s)\n", opt_str);
@@ -306,9 +762,77 @@ int main(int argc, char* argv[]) noexcept {
             new_exe_path = args[i];
         } else if (opt_int == OPT_FORCE) {
             force = true;
+        } else if (opt_int == OPT_COMPRESS) {
+            compress = true;
+        } else if (opt_int == OPT_CONFIG) {
+            i++;
+            config_path_cstr = args[i];
+        } else if (opt_int == OPT_MODE) {
+            i++;
+            mode_cstr = args[i];
+        } else if (opt_int == OPT_SET) {
+            i++;
+            values.push_back(args[i]);
+        } else if (opt_int == OPT_SOCKET) {
+            i++;
+            socket_path_cstr = args[i];
+        } else if (opt_int == OPT_PARALLEL) {
+            i++;
+            parallel_cstr = args[i];
+        } else if (opt_int == OPT_RESOURCE) {
+            i++;
+            resources.push_back(args[i]);
+        } else if (opt_int == OPT_BATCH) {
+            i++;
+            batch_path_cstr = args[i];
         }
     }
 
+    if (cmd_int == CMD_RUN) {
+        // Get full paths before changing CWD.
+        if (json_path_cstr) {
+            json_path = envuStr(envuGetFullPath(json_path_cstr));
+            json_path_cstr = json_path.c_str();
+        }
+        if (config_path_cstr) {
+            config_path = envuStr(envuGetFullPath(config_path_cstr));
+            config_path_cstr = config_path.c_str();
+        }
+        noex::string err = Run(exe_path, json_path_cstr, config_path_cstr,
+                               mode_cstr, values, &ret);
+        if (!err.empty()) {
+            FprintFmt(stderr, "Error: %s\n", err.c_str());
+            ret = 1;
+        }
+        goto MAIN_END;
+    }
+
+    if (cmd_int == CMD_SERVE) {
+        // Get full paths before changing CWD.
+        if (json_path_cstr) {
+            json_path = envuStr(envuGetFullPath(json_path_cstr));
+            json_path_cstr = json_path.c_str();
+        }
+        socket_path = envuStr(envuGetFullPath(socket_path_cstr));
+        noex::string err = ServeRequests(exe_path, json_path_cstr,
+                                         socket_path.c_str(), parallel_cstr);
+        if (!err.empty()) {
+            FprintFmt(stderr, "Error: %s\n", err.c_str());
+            ret = 1;
+        }
+        goto MAIN_END;
+    }
+
+    if (cmd_int == CMD_MERGE && batch_path_cstr) {
+        noex::string err = BatchMerge(exe_path, batch_path_cstr, force, compress,
+                                      resources, parallel_cstr);
+        if (!err.empty()) {
+            FprintFmt(stderr, "Error: %s\n", err.c_str());
+            ret = 1;
+        }
+        goto MAIN_END;
+    }
+
     if (!json_path_cstr || !*json_path_cstr) {
         if (cmd_int == CMD_MERGE)
             json_path_cstr = GetDefaultJsonPath();
@@ -332,7 +856,7 @@ int main(int argc, char* argv[]) noexcept {
     {
         noex::string err;
         if (cmd_int == CMD_MERGE)
-            err = Merge(exe_path, json_path, new_exe_path, force);
+            err = Merge(exe_path, json_path, new_exe_path, force, compress, resources);
         else if (cmd_int == CMD_SPLIT)
             err = Split(exe_path, json_path, new_exe_path, force);
         else if (cmd_int == CMD_VERSION)
@@ -347,6 +871,11 @@ int main(int argc, char* argv[]) noexcept {
     }
 
 MAIN_END:
+    {
+        noex::string err = TraceStop();
+        if (!err.empty())
+            FprintFmt(stderr, "Warning: %s\n", err.c_str());
+    }
     FreeArgs(args);
     return ret;
 }
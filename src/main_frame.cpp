@@ -3,36 +3,158 @@
 #include "exe_container.h"
 #include "env_utils.h"
 #include "exec.h"
+#include "command.h"
 #include "string_utils.h"
+#include "trace.h"
+#include "noex/alloc.hpp"
+#include "noex/new.hpp"
 #include "tuw_constants.h"
+#include <cstdlib>
 #ifdef __TUW_UNIX__
 #include <gtk/gtk.h>
 #endif
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Max number of lines in error dialogs
+#define OUTPUT_REGION_LINES 20
 
 #define DEFAULT_JSON_NAME "gui_definition"
-const char* GetDefaultJsonPath() noexcept {
-    if (envuFileExists(DEFAULT_JSON_NAME ".jsonc"))
-        return DEFAULT_JSON_NAME ".jsonc";
-    if (envuFileExists(DEFAULT_JSON_NAME ".tuw"))
-        return DEFAULT_JSON_NAME ".tuw";
-    return DEFAULT_JSON_NAME ".json";
+// Candidates in priority order
+static const char* const DEFAULT_JSON_PATHS[] = {
+    DEFAULT_JSON_NAME ".jsonc",
+    DEFAULT_JSON_NAME ".tuw",
+    DEFAULT_JSON_NAME ".json",
+};
+#define DEFAULT_JSON_COUNT 3
+
+const char* GetDefaultJsonPath(bool* exists) noexcept {
+    int found = DEFAULT_JSON_COUNT;
+#ifdef _WIN32
+    // Find all candidates with a query.
+    WIN32_FIND_DATAW data;
+    HANDLE find = FindFirstFileW(L"" DEFAULT_JSON_NAME ".*", &data);
+    if (find != INVALID_HANDLE_VALUE) {
+        do {
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                continue;
+            noex::string name = UTF16toUTF8(data.cFileName);
+            for (int i = 0; i < found; i++) {
+                if (_stricmp(name.c_str(), DEFAULT_JSON_PATHS[i]) == 0)
+                    found = i;
+            }
+        } while (found > 0 && FindNextFileW(find, &data));
+        FindClose(find);
+    }
+#else
+    for (int i = 0; i < DEFAULT_JSON_COUNT; i++) {
+        if (envuFileExists(DEFAULT_JSON_PATHS[i])) {
+            found = i;
+            break;
+        }
+    }
+#endif
+    if (exists)
+        *exists = found < DEFAULT_JSON_COUNT;
+    return DEFAULT_JSON_PATHS[found < DEFAULT_JSON_COUNT ? found : DEFAULT_JSON_COUNT - 1];
 }
 
+// Prints time and I/O syscalls of each phase at startup. ("TUW_STARTUP_TRACE=1")
+// Linux counts read and write syscalls with /proc/self/io.
+// Phases are also recorded as trace events with "--trace out.json".
+class StartupTrace {
+ private:
+    bool m_enabled;
+    bool m_print;
+    const char* m_phase;
+    uint64_t m_start_us;
+    uint64_t m_syscr;
+    uint64_t m_syscw;
+
+    static void GetSyscalls(uint64_t* syscr, uint64_t* syscw) noexcept {
+        *syscr = 0;
+        *syscw = 0;
+#ifdef __linux__
+        FILE* io = fopen("/proc/self/io", "r");
+        if (!io)
+            return;
+        char line[64];
+        while (fgets(line, sizeof(line), io)) {
+            if (strncmp(line, "syscr: ", 7) == 0)
+                *syscr = strtoull(line + 7, nullptr, 10);
+            else if (strncmp(line, "syscw: ", 7) == 0)
+                *syscw = strtoull(line + 7, nullptr, 10);
+        }
+        fclose(io);
+#endif
+    }
+
+ public:
+    StartupTrace() noexcept : m_enabled(false), m_print(false), m_phase(nullptr),
+                              m_start_us(0), m_syscr(0), m_syscw(0) {
+        const char* env = getenv("TUW_STARTUP_TRACE");
+        m_print = env && *env && strcmp(env, "0") != 0;
+#ifdef TUW_NO_TRACE
+        m_enabled = m_print;
+#else
+        m_enabled = m_print || TraceEnabled();
+#endif
+    }
+
+    // Ends the current phase and starts the next one.
+    void Phase(const char* next) noexcept {
+        if (!m_enabled)
+            return;
+        uint64_t now = GetMonotonicTimeUs();
+        uint64_t syscr = 0, syscw = 0;
+        if (m_print)
+            GetSyscalls(&syscr, &syscw);
+#ifndef TUW_NO_TRACE
+        if (m_phase && TraceEnabled())
+            TraceRecord(m_phase, m_start_us, now);
+#endif
+        if (m_phase && m_print) {
+            // Subtract reads of /proc/self/io.
+            uint64_t reads = syscr - m_syscr;
+            reads = reads > 2 ? reads - 2 : 0;
+            PrintFmt("[StartupTrace] %-10s %8.3fms  read syscalls: %u  write syscalls: %u\n",
+                     m_phase, static_cast<double>(now - m_start_us) / 1000.0,
+                     static_cast<unsigned>(reads), static_cast<unsigned>(syscw - m_syscw));
+        }
+        m_phase = next;
+        m_start_us = now;
+        m_syscr = syscr;
+        m_syscw = syscw;
+    }
+
+    void End() noexcept {
+        Phase(nullptr);
+    }
+};
+
 // Main window
 void MainFrame::Initialize(const tuwjson::Value& definition,
                            const tuwjson::Value& config,
                            noex::string json_path) noexcept {
+    TUW_TRACE_SCOPE("MainFrame::Initialize");
+    StartupTrace trace;
+    trace.Phase("exe_path");
     PrintFmt("%s v%s by %s\n", tuw_constants::TOOL_NAME,
               tuw_constants::VERSION, tuw_constants::AUTHOR);
     PrintFmt(tuw_constants::LOGO);
 
     m_grid = NULL;
     m_menu_safe_mode = NULL;
+    m_worker = nullptr;
+    m_is_job_timer_running = false;
+    m_is_updating_jobs = false;
     noex::string exe_path = envuStr(envuGetExecutablePath());
 
     m_definition.CopyFrom(definition);
     m_config.CopyFrom(config);
 
+    trace.Phase("cwd");
     noex::string workdir;
     if (json_path.empty()) {
         workdir = envuStr(envuGetDirectory(exe_path.c_str()));
@@ -53,16 +175,20 @@ void MainFrame::Initialize(const tuwjson::Value& definition,
         }
     }
 
+    trace.Phase("probe");
+    bool exists_external_json;
     if (json_path.empty()) {
         // Find gui_definition.json
-        json_path = GetDefaultJsonPath();
+        json_path = GetDefaultJsonPath(&exists_external_json);
+    } else {
+        exists_external_json = envuFileExists(json_path.c_str());
     }
 
     bool ignore_external_json = false;
-    bool exists_external_json = envuFileExists(json_path.c_str());
     bool loaded = m_definition.IsObject() && !m_definition.IsEmptyObject();
     noex::string err;
 
+    trace.Phase("definition");
     if (!loaded) {
         ExeContainer exe;
 
@@ -91,6 +217,7 @@ void MainFrame::Initialize(const tuwjson::Value& definition,
         }
     }
 
+    trace.Phase("config");
     if (!config.IsObject() || config.IsEmptyObject()) {
         noex::string cfg_err =
             json_utils::LoadJson("gui_config.json", m_config);
@@ -99,6 +226,7 @@ void MainFrame::Initialize(const tuwjson::Value& definition,
         }
     }
 
+    trace.Phase("check");
     if (loaded) {
         noex::string err_msg = CheckDefinition(m_definition);
         loaded = err_msg.empty();
@@ -113,6 +241,7 @@ void MainFrame::Initialize(const tuwjson::Value& definition,
     if (definition_id >= m_gui_json->GetArraySize())
         definition_id = 0;
 
+    trace.Phase("window");
     CreateMenu();
     CreateFrame();
 #ifdef __TUW_UNIX__
@@ -136,8 +265,15 @@ void MainFrame::Initialize(const tuwjson::Value& definition,
     if (!loaded)
         ShowErrorDialogWithLog("LoadDefinition", err);
 
+    trace.Phase("panel");
     UpdatePanel(definition_id);
     Fit();
+    trace.End();
+}
+
+MainFrame::~MainFrame() noexcept {
+    // Closes stdin of the worker and waits for it.
+    noex::del_ref(m_worker);
 }
 
 static int OnClosing(uiWindow *w, void *data) noexcept {
@@ -202,6 +338,20 @@ static void OnOpenURL(uiMenuItem *item, uiWindow *w, void *data) noexcept {
     UNUSED(w);
 }
 
+static void OnShowOutputLog(uiMenuItem *item, uiWindow *w, void *data) noexcept {
+    g_main_frame->ShowOutputLog();
+    UNUSED(item);
+    UNUSED(w);
+    UNUSED(data);
+}
+
+static void OnShowMemoryUsage(uiMenuItem *item, uiWindow *w, void *data) noexcept {
+    g_main_frame->ShowMemoryUsage();
+    UNUSED(item);
+    UNUSED(w);
+    UNUSED(data);
+}
+
 #ifdef _WIN32
 static void OnUpdateRenderer(uiMenuItem *item, uiWindow *w, void *data) noexcept {
     int checked = uiMenuItemChecked(item);
@@ -254,6 +404,10 @@ void MainFrame::CreateMenu() noexcept {
     }
     menu = uiNewMenu("Debug");
     m_menu_safe_mode = uiMenuAppendCheckItem(menu, "Safe Mode");
+    item = uiMenuAppendItem(menu, "Memory Usage");
+    uiMenuItemOnClicked(item, OnShowMemoryUsage, NULL);
+    item = uiMenuAppendItem(menu, "View Full Output");
+    uiMenuItemOnClicked(item, OnShowOutputLog, NULL);
 #ifdef _WIN32
     item = uiMenuAppendCheckItem(menu, "Use Legacy Renderer");
     if (json_utils::GetBool(m_definition, "legacy_renderer", false)) {
@@ -353,6 +507,7 @@ static void OnClicked(uiButton *sender, void *data) noexcept {
 }
 
 void MainFrame::UpdatePanel(size_t definition_id) noexcept {
+    TUW_TRACE_SCOPE("MainFrame::UpdatePanel");
     m_definition_id = definition_id;
     tuwjson::Value& sub_definition = m_gui_json->At(m_definition_id);
     if (m_gui_json->GetArraySize() > 1) {
@@ -373,7 +528,7 @@ void MainFrame::UpdatePanel(size_t definition_id) noexcept {
 
     // Delete old components
     for (Component* comp : m_components) {
-        delete comp;
+        Component::Delete(comp);
     }
     m_components.clear();
     m_components.shrink_to_fit();
@@ -430,6 +585,7 @@ void MainFrame::Fit(bool keep_width) noexcept {
 
 // Do validation for each component
 bool MainFrame::Validate() noexcept {
+    TUW_TRACE_SCOPE("MainFrame::Validate");
     bool validate = true;
     bool redraw_flag = false;
     noex::string val_first_err;
@@ -456,62 +612,69 @@ bool MainFrame::Validate() noexcept {
     return validate;
 }
 
-// Make command string
-noex::string MainFrame::GetCommand() noexcept {
-    tuwjson::Value& sub_definition = m_gui_json->At(m_definition_id);
-    tuwjson::Value& cmd_ary = sub_definition["command_splitted"];
-    tuwjson::Value& cmd_ids = sub_definition["command_ids"];
-
-    if (cmd_ary.IsEmptyArray())
-        return "";
-
-    noex::string cmd = cmd_ary[0].GetString();
-    for (size_t i = 0; i < cmd_ids.GetArraySize(); i++) {
-        int id = cmd_ids[i].GetInt();
-        if (id == CMD_ID_PERCENT) {
-            cmd.push_back('%');
-        } else if (id == CMD_ID_CURRENT_DIR) {
-            char* cwd = envuGetCwd();
-            cmd += cwd;
-            envuFree(cwd);
-        } else if (id == CMD_ID_HOME_DIR) {
-            char* home = envuGetHome();
-            cmd += home;
-            envuFree(home);
-        } else {
-            cmd += m_components[id]->GetString();
-        }
-        if (i + 1 < cmd_ary.GetArraySize()) {
-            cmd += cmd_ary[i + 1].GetString();
-        }
+// Values of GUI components
+class GuiValues : public ComponentValues {
+ private:
+    noex::vector<Component*>& m_components;
+
+ public:
+    explicit GuiValues(noex::vector<Component*>& components) noexcept :
+        m_components(components) {}
+    noex::string GetString(int id, bool use_quotes) noexcept override {
+        return m_components[id]->GetString(use_quotes);
+    }
+    noex::string GetRawString(int id) noexcept override {
+        return m_components[id]->GetRawString();
     }
-    return cmd;
+};
+
+// Make command string
+noex::string MainFrame::GetCommand(noex::string* err) noexcept {
+    GuiValues values(m_components);
+    return BuildCommand(m_gui_json->At(m_definition_id), values, err);
 }
 
-void MainFrame::RunCommand() noexcept {
-    noex::string cmd = GetCommand();
-    Log("RunCommad", "Command", cmd);
+// Make command arguments for "shell": false
+noex::vector<noex::string> MainFrame::GetCommandArgs(noex::string* err) noexcept {
+    GuiValues values(m_components);
+    return BuildCommandArgs(m_gui_json->At(m_definition_id), values, err);
+}
 
-    if (IsSafeMode()) {
-        noex::string msg = "The command was not executed since the safe mode is enabled.\n"
-                          "You can disable it from the menu bar (Debug > Safe Mode.)\n"
-                          "\n"
-                          "Command: " + cmd;
-        ShowSuccessDialog(msg, "Safe Mode");
-        return;
+noex::string MainFrame::GetCacheKey(const noex::string& cmd,
+                                    const noex::vector<noex::string>& args,
+                                    const StdinContent* input) noexcept {
+    noex::string key = args.empty() ? cmd : ArgsToCacheKey(args);
+    if (input && !input->is_file)
+        key += "\nstdin\t" + input->str;
+    for (Component* comp : m_components) {
+        if (!comp->IsPath())
+            continue;
+        noex::string path = comp->GetRawString();
+        if (path.empty())
+            continue;
+        key += noex::concat_cstr("\n", path.c_str(), "\t");
+        key += GetFileStamp(path.c_str());
     }
+    return key;
+}
 
-    char* text = uiButtonText(m_run_button);
+static void OnProgress(int percent, void* data) {
+    static_cast<MainFrame*>(data)->ShowProgress(percent);
+}
+
+// Runs the command and shows "Processing..." on the button.
+ExecuteResult MainFrame::ExecuteCommand(const tuwjson::Value& sub_definition,
+                                        const noex::string& cmd,
+                                        const noex::vector<noex::string>& args,
+                                        const Pipeline* pipeline,
+                                        const StdinContent* input) noexcept {
+    TUW_TRACE_SCOPE("MainFrame::ExecuteCommand");
     uiButtonSetText(m_run_button, "Processing...");
 #ifdef __APPLE__
     uiMainStep(1);
 #elif defined(__TUW_UNIX__)
     uiUnixWaitEvents();
 #endif
-    tuwjson::Value& sub_definition = m_gui_json->At(m_definition_id);
-
-    const char* codepage = json_utils::GetString(sub_definition, "codepage", "");
-    bool use_utf8_on_windows = strcmp(codepage, "utf8") == 0 || strcmp(codepage, "utf-8") == 0;
 
 #ifdef __TUW_UNIX__
     // Disable the main window on Unix
@@ -519,12 +682,142 @@ void MainFrame::RunCommand() noexcept {
     GtkWidget* widget = reinterpret_cast<GtkWidget*>(uiControlHandle(uiControl(m_mainwin)));
     gtk_widget_set_sensitive(widget, FALSE);
 #endif
-    ExecuteResult result = Execute(cmd, use_utf8_on_windows);
+    ExecuteResult result = ExecuteSubDefinition(sub_definition, cmd, args, pipeline, input,
+                                                &m_worker, &m_output_log,
+                                                OnProgress, this);
 #ifdef __TUW_UNIX__
     gtk_widget_set_sensitive(widget, TRUE);
 #endif
-    uiButtonSetText(m_run_button, text);
+    // Restore the button text.
+    UpdateJobStatus();
+
+    return result;
+}
+
+// Shows the number of jobs on the button.
+void MainFrame::UpdateJobStatus() noexcept {
+    const tuwjson::Value& sub_definition = m_gui_json->At(m_definition_id);
+    const char* button = json_utils::GetString(sub_definition, "button", "Run");
+    if (m_job_queue.IsEmpty()) {
+        uiButtonSetText(m_run_button, button);
+        return;
+    }
+    noex::string text = button;
+    text += " (running: " + noex::to_string(m_job_queue.GetRunningCount()) +
+            ", queued: " + noex::to_string(m_job_queue.GetQueuedCount());
+    // Show percentages of running jobs. ("progress_regex")
+    const char* sep = ", progress: ";
+    for (const Job* job : m_job_queue.GetJobs()) {
+        int percent = job->execution ? job->execution->GetProgress() : -1;
+        if (job->state != JOB_RUNNING || percent < 0)
+            continue;
+        text += sep + noex::to_string(percent) + "%";
+        sep = " ";
+    }
+    text += ")";
+    uiButtonSetText(m_run_button, text.c_str());
+}
+
+void MainFrame::ShowProgress(int percent) noexcept {
+    if (percent < 0)
+        return;
+    noex::string text = "Processing... " + noex::to_string(percent) + "%";
+    uiButtonSetText(m_run_button, text.c_str());
+}
 
+static int OnJobTimer(void* data) noexcept {
+    MainFrame* main_frame = static_cast<MainFrame*>(data);
+    return main_frame->UpdateJobs();
+}
+
+bool MainFrame::UpdateJobs() noexcept {
+    // Dialogs can run the event loop and call this function again.
+    if (m_is_updating_jobs)
+        return true;
+    m_is_updating_jobs = true;
+    Job* job;
+    while ((job = m_job_queue.Update()) != nullptr) {
+        HandleResult(*job->sub_definition, job->result, job->cache_key);
+        JobQueue::DeleteJob(job);
+    }
+    UpdateJobStatus();
+    m_is_updating_jobs = false;
+    m_is_job_timer_running = !m_job_queue.IsEmpty();
+    return m_is_job_timer_running;
+}
+
+void MainFrame::RunCommand() noexcept {
+    tuwjson::Value& sub_definition = m_gui_json->At(m_definition_id);
+    const char* worker_cmd = json_utils::GetString(sub_definition, "worker", nullptr);
+    bool use_shell = !worker_cmd && json_utils::GetBool(sub_definition, "shell", true);
+    noex::vector<noex::string> args;
+    noex::string cmd;
+    noex::string err;
+    if (use_shell) {
+        cmd = GetCommand(&err);
+    } else {
+        args = GetCommandArgs(&err);
+        cmd = ArgsToString(args);
+    }
+    Log("RunCommad", "Command", cmd);
+
+    if (IsSafeMode()) {
+        noex::string msg = "The command was not executed since the safe mode is enabled.\n"
+                          "You can disable it from the menu bar (Debug > Safe Mode.)\n"
+                          "\n"
+                          "Command: " + cmd;
+        ShowSuccessDialog(msg, "Safe Mode");
+        return;
+    }
+
+    StdinContent input;
+    GuiValues values(m_components);
+    const StdinContent* input_ptr =
+        BuildStdin(sub_definition, values, &input) ? &input : nullptr;
+    Pipeline pipeline;
+    const Pipeline* pipeline_ptr =
+        BuildPipeline(sub_definition, values, &pipeline, &err) ? &pipeline : nullptr;
+    if (!err.empty()) {
+        // Don't run the command with broken paths.
+        ShowErrorDialogWithLog("RunCommand", err);
+        return;
+    }
+
+    bool use_cache = json_utils::GetBool(sub_definition, "cache", false);
+    noex::string cache_key;
+    ExecuteResult result = { 0, "", "" };
+    if (use_cache)
+        cache_key = GetCacheKey(cmd, args, input_ptr);
+    if (use_cache && m_result_cache.Get(cache_key, &result)) {
+        Log("RunCommand", "Replayed a cached result.");
+        if (!result.last_line.empty())
+            Log("RunCommand", "Last line", result.last_line);
+        HandleResult(sub_definition, result, cache_key);
+        return;
+    }
+
+    int max_parallel = json_utils::GetInt(sub_definition, "max_parallel", 0);
+    if (max_parallel > 0 && !worker_cmd) {
+        // Run the command in the background.
+        m_job_queue.Push(sub_definition, cmd, args, cache_key, input_ptr, pipeline_ptr);
+        if (!m_is_job_timer_running) {
+            m_is_job_timer_running = true;
+            uiTimer(tuw_constants::JOB_TIMER_MS, OnJobTimer, this);
+        }
+        UpdateJobs();
+        return;
+    }
+
+    result = ExecuteCommand(sub_definition, cmd, args, pipeline_ptr, input_ptr);
+    HandleResult(sub_definition, result, cache_key, &m_output_log);
+}
+
+// Shows the result of a command.
+void MainFrame::HandleResult(const tuwjson::Value& sub_definition,
+                             const ExecuteResult& result,
+                             const noex::string& cache_key,
+                             OutputLog* log) noexcept {
+    bool use_cache = json_utils::GetBool(sub_definition, "cache", false);
     bool check_exit_code = json_utils::GetBool(sub_definition, "check_exit_code", false);
     int exit_success = json_utils::GetInt(sub_definition, "exit_success", 0);
     bool show_last_line = json_utils::GetBool(sub_definition, "show_last_line", false);
@@ -538,7 +831,17 @@ void MainFrame::RunCommand() noexcept {
         return;
     }
 
+    // Full outputs of the run
+    if (log && (!sub_definition.HasMember("output_log") || log->IsEmpty()))
+        log = nullptr;
+
     if (!result.err_msg.empty()) {
+        if (log) {
+            // Show lines around the error instead of the last characters.
+            Log("RunCommand", "Error", result.err_msg);
+            ShowErrorDialog(log->GetErrorRegion(OUTPUT_REGION_LINES));
+            return;
+        }
         ShowErrorDialogWithLog("RunCommand", result.err_msg);
         return;
     }
@@ -549,10 +852,19 @@ void MainFrame::RunCommand() noexcept {
             err_msg = result.last_line;
         else
             err_msg = "Invalid exit code: " + noex::to_string(result.exit_code);
-        ShowErrorDialogWithLog("RunCommand", err_msg);
+        Log("RunCommand", "Error", err_msg);
+        if (log && !show_last_line)
+            err_msg += "\n\n" + log->GetErrorRegion(OUTPUT_REGION_LINES);
+        ShowErrorDialog(err_msg);
         return;
     }
 
+    if (use_cache) {
+        noex::string err = m_result_cache.Put(cache_key, result);
+        if (!err.empty())
+            Log("RunCommand", "Failed to save cache", err);
+    }
+
     if (!show_success_dialog) {
         Log("RunCommand", "Done");
         return;
@@ -566,8 +878,48 @@ void MainFrame::RunCommand() noexcept {
     ShowSuccessDialog("Success!");
 }
 
+void MainFrame::ShowOutputLog() noexcept {
+    if (m_output_log.GetPath().empty()) {
+        ShowErrorDialog("No output log found.\n"
+                        "Use \"output_log\" in the GUI definition to save outputs.");
+        return;
+    }
+    m_output_viewer.Show(&m_output_log);
+}
+
+static inline double ToKiB(size_t bytes) noexcept {
+    return static_cast<double>(bytes) / 1024.0;
+}
+
+noex::string GetMemoryUsageStr() noexcept {
+    noex::AllocStats stats;
+    noex::get_alloc_stats(&stats);
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Live: %.1f KiB (Peak: %.1f KiB)\n"
+             "Allocations: %u (%.1f KiB in total)\n",
+             ToKiB(stats.total.live_bytes), ToKiB(stats.peak_live_bytes),
+             static_cast<unsigned>(stats.total.alloc_count), ToKiB(stats.total.alloc_bytes));
+    noex::string str = buf;
+    for (int i = 0; i < noex::ALLOC_TAG_MAX; i++) {
+        const noex::AllocCounter& tag = stats.tags[i];
+        snprintf(buf, sizeof(buf), "\n%s: %.1f KiB live, %u allocs, %u frees",
+                 noex::get_alloc_tag_name(static_cast<noex::AllocTag>(i)),
+                 ToKiB(tag.live_bytes), static_cast<unsigned>(tag.alloc_count),
+                 static_cast<unsigned>(tag.free_count));
+        str += buf;
+    }
+    return str;
+}
+
+void MainFrame::ShowMemoryUsage() noexcept {
+    noex::string msg = GetMemoryUsageStr();
+    PrintFmt("[MemoryUsage]\n%s\n", msg.c_str());
+    ShowSuccessDialog(msg, "Memory Usage");
+}
+
 // read gui_definition.json
 noex::string MainFrame::CheckDefinition(tuwjson::Value& definition) noexcept {
+    TUW_TRACE_SCOPE("MainFrame::CheckDefinition");
     noex::string err_msg;
     json_utils::CheckVersion(err_msg, definition);
     if (!err_msg.empty()) return err_msg;
@@ -586,6 +938,7 @@ void MainFrame::UpdateConfig() noexcept {
 }
 
 void MainFrame::SaveConfig() noexcept {
+    TUW_TRACE_SCOPE("MainFrame::SaveConfig");
     UpdateConfig();
     noex::string err = json_utils::SaveJson(m_config, "gui_config.json");
     if (err.empty())
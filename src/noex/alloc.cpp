@@ -0,0 +1,117 @@
+#include <cstdlib>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "noex/alloc.hpp"
+
+namespace noex {
+
+// Counters are updated with relaxed atomics. Threads can allocate memory at the same time.
+struct AtomicCounter {
+    size_t alloc_count;
+    size_t free_count;
+    size_t alloc_bytes;
+    size_t free_bytes;
+};
+
+static AtomicCounter g_counters[ALLOC_TAG_MAX] = {};
+static size_t g_live_bytes = 0;
+static size_t g_peak_live_bytes = 0;
+
+#ifdef _MSC_VER
+static inline size_t atomic_add(size_t* p, size_t val) noexcept {
+#ifdef _WIN64
+    return static_cast<size_t>(_InterlockedExchangeAdd64(
+        reinterpret_cast<volatile __int64*>(p), static_cast<__int64>(val))) + val;
+#else
+    return static_cast<size_t>(_InterlockedExchangeAdd(
+        reinterpret_cast<volatile long*>(p), static_cast<long>(val))) + val;  // NOLINT
+#endif
+}
+
+static inline size_t atomic_load(size_t* p) noexcept {
+    return *static_cast<volatile size_t*>(p);
+}
+
+static inline bool atomic_cas(size_t* p, size_t* expected, size_t val) noexcept {
+#ifdef _WIN64
+    size_t old = static_cast<size_t>(_InterlockedCompareExchange64(
+        reinterpret_cast<volatile __int64*>(p),
+        static_cast<__int64>(val), static_cast<__int64>(*expected)));
+#else
+    size_t old = static_cast<size_t>(_InterlockedCompareExchange(
+        reinterpret_cast<volatile long*>(p),  // NOLINT
+        static_cast<long>(val), static_cast<long>(*expected)));  // NOLINT
+#endif
+    if (old == *expected)
+        return true;
+    *expected = old;
+    return false;
+}
+#else
+static inline size_t atomic_add(size_t* p, size_t val) noexcept {
+    return __atomic_add_fetch(p, val, __ATOMIC_RELAXED);
+}
+
+static inline size_t atomic_load(size_t* p) noexcept {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static inline bool atomic_cas(size_t* p, size_t* expected, size_t val) noexcept {
+    return __atomic_compare_exchange_n(p, expected, val, true,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+#endif
+
+void* alloc(size_t count, size_t size, AllocTag tag) noexcept {
+    void* ptr = calloc(count, size);
+    if (!ptr)
+        return nullptr;
+    size_t bytes = count * size;
+    AtomicCounter& counter = g_counters[tag];
+    atomic_add(&counter.alloc_count, 1);
+    atomic_add(&counter.alloc_bytes, bytes);
+    size_t live = atomic_add(&g_live_bytes, bytes);
+    size_t peak = atomic_load(&g_peak_live_bytes);
+    while (live > peak && !atomic_cas(&g_peak_live_bytes, &peak, live)) {}
+    return ptr;
+}
+
+void dealloc(void* ptr, size_t bytes, AllocTag tag) noexcept {
+    if (!ptr)
+        return;
+    free(ptr);
+    AtomicCounter& counter = g_counters[tag];
+    atomic_add(&counter.free_count, 1);
+    atomic_add(&counter.free_bytes, bytes);
+    atomic_add(&g_live_bytes, 0 - bytes);
+}
+
+void get_alloc_stats(AllocStats* stats) noexcept {
+    memset(stats, 0, sizeof(AllocStats));
+    for (int i = 0; i < ALLOC_TAG_MAX; i++) {
+        AllocCounter& tag = stats->tags[i];
+        tag.alloc_count = atomic_load(&g_counters[i].alloc_count);
+        tag.free_count = atomic_load(&g_counters[i].free_count);
+        tag.alloc_bytes = atomic_load(&g_counters[i].alloc_bytes);
+        tag.live_bytes = tag.alloc_bytes - atomic_load(&g_counters[i].free_bytes);
+        stats->total.alloc_count += tag.alloc_count;
+        stats->total.free_count += tag.free_count;
+        stats->total.alloc_bytes += tag.alloc_bytes;
+        stats->total.live_bytes += tag.live_bytes;
+    }
+    stats->peak_live_bytes = atomic_load(&g_peak_live_bytes);
+}
+
+const char* get_alloc_tag_name(AllocTag tag) noexcept {
+    static const char* const names[ALLOC_TAG_MAX] = {
+        "string", "vector", "json", "component", "other"
+    };
+    if (tag < 0 || tag >= ALLOC_TAG_MAX)
+        return "unknown";
+    return names[tag];
+}
+
+}  // namespace noex
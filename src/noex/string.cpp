@@ -5,10 +5,12 @@
 #include <cstring>
 
 #include "noex/string.hpp"
+#include "noex/alloc.hpp"
 
 namespace noex {
 
-static ErrorNo g_error_status = OK;
+// Each thread has its own status. Threads of RunTasks() don't share errors.
+static thread_local ErrorNo g_error_status = OK;
 
 ErrorNo get_error_no() noexcept {
     return g_error_status;
@@ -28,7 +30,7 @@ void basic_string<charT>::reserve(size_t capacity) noexcept {
     if (capacity <= m_capacity) return;
 
     // allocate a new buffer
-    charT* new_str = static_cast<charT*>(calloc(capacity + 1, sizeof(charT)));
+    charT* new_str = static_cast<charT*>(alloc(capacity + 1, sizeof(charT), ALLOC_STRING));
     if (!new_str) {
         clear();
         set_error_no(STR_ALLOCATION_ERROR);
@@ -38,7 +40,7 @@ void basic_string<charT>::reserve(size_t capacity) noexcept {
     // copy the old buffer to the new one.
     if (m_str) {
         memcpy(new_str, m_str, (m_size + 1) * sizeof(charT));
-        free(m_str);
+        dealloc(m_str, (m_capacity + 1) * sizeof(charT), ALLOC_STRING);
     }
     m_str = new_str;
     m_capacity = capacity;
@@ -94,7 +96,7 @@ basic_string<charT>::basic_string(basic_string<charT>&& str) noexcept :
 
 template <typename charT>
 basic_string<charT>::basic_string(size_t size) noexcept : m_size(size), m_capacity(size) {
-    m_str = reinterpret_cast<charT*>(calloc(size + 1, sizeof(charT)));
+    m_str = reinterpret_cast<charT*>(alloc(size + 1, sizeof(charT), ALLOC_STRING));
     if (!m_str) {
         m_size = 0;
         m_capacity = 0;
@@ -115,7 +117,7 @@ const charT* basic_string<charT>::c_str() const noexcept {
 template <typename charT>
 void basic_string<charT>::clear() noexcept {
     if (m_str)
-        free(m_str);
+        dealloc(m_str, (m_capacity + 1) * sizeof(charT), ALLOC_STRING);
     m_str = nullptr;
     m_size = 0;
     m_capacity = 0;
@@ -6,6 +6,7 @@
 
 #include "noex/vector.hpp"
 #include "noex/string.hpp"
+#include "noex/alloc.hpp"
 
 namespace noex {
 
@@ -51,7 +52,7 @@ trivial_vector_base::trivial_vector_base(trivial_vector_base&& vec) noexcept :
 void trivial_vector_base::reserve(size_t capacity) noexcept {
     if (capacity <= m_capacity) return;
 
-    char* data = static_cast<char*>(calloc(capacity, m_sizeof_type));
+    char* data = static_cast<char*>(alloc(capacity, m_sizeof_type, ALLOC_VECTOR));
     if (!data) {
         set_error_no(VEC_ALLOCATION_ERROR);
         clear();
@@ -60,14 +61,14 @@ void trivial_vector_base::reserve(size_t capacity) noexcept {
 
     memcpy(data, m_data, m_size * m_sizeof_type);
 
-    free(m_data);
+    dealloc(m_data, m_capacity * m_sizeof_type, ALLOC_VECTOR);
     m_data = data;
     m_capacity = capacity;
 }
 
 void trivial_vector_base::clear() noexcept {
     if (m_data)
-        free(m_data);
+        dealloc(m_data, m_capacity * m_sizeof_type, ALLOC_VECTOR);
     m_data = nullptr;
     m_size = 0;
     m_capacity = 0;
@@ -92,7 +93,7 @@ void trivial_vector_base::push_back_base(const void* val) noexcept {
 void trivial_vector_base::shrink_to_fit() noexcept {
     if (m_size >= m_capacity) return;
 
-    char* data = static_cast<char*>(calloc(m_size, m_sizeof_type));
+    char* data = static_cast<char*>(alloc(m_size, m_sizeof_type, ALLOC_VECTOR));
     if (!data) {
         set_error_no(VEC_ALLOCATION_ERROR);
         return;
@@ -101,7 +102,7 @@ void trivial_vector_base::shrink_to_fit() noexcept {
     // Move or copy existing elements to the new memory
     memcpy(data, m_data, m_size * m_sizeof_type);
 
-    free(m_data);
+    dealloc(m_data, m_capacity * m_sizeof_type, ALLOC_VECTOR);
     m_data = data;
     m_capacity = m_size;
 }
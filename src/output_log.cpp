@@ -0,0 +1,197 @@
+#include "output_log.h"
+#include <string.h>
+#include "json_utils.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+OutputLog::~OutputLog() noexcept {
+    Close();
+    Unmap();
+}
+
+noex::string OutputLog::Open(const char* path) noexcept {
+    Close();
+    Unmap();
+    m_path = path;
+    m_size = 0;
+    m_line_offsets.clear();
+    m_line_offsets.push_back(0);
+    m_file = FileOpen(path, FILE_MODE_WRITE);
+    if (!m_file)
+        return GetFileError(m_path);
+    return "";
+}
+
+void OutputLog::Append(const char* buf, size_t size) noexcept {
+    if (!m_file)
+        return;
+    if (fwrite(buf, 1, size, m_file) != size) {
+        // Stop logging not to make a broken index.
+        Close();
+        return;
+    }
+    for (size_t i = 0; i < size; i++) {
+        if (buf[i] == '\n')
+            m_line_offsets.push_back(m_size + i + 1);
+    }
+    m_size += size;
+}
+
+void OutputLog::Close() noexcept {
+    if (!m_file)
+        return;
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+void OutputLog::Unmap() noexcept {
+    if (!m_data)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap(const_cast<char*>(m_data), m_mapped_size);
+#endif
+    m_data = nullptr;
+    m_mapped_size = 0;
+}
+
+bool OutputLog::Map() noexcept {
+    if (m_mapped_size == m_size)
+        return m_data != nullptr || m_size == 0;
+    Unmap();
+    if (m_file)
+        fflush(m_file);
+#ifdef _WIN32
+    noex::wstring wpath = UTF8toUTF16(m_path.c_str());
+    HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY,
+                                        static_cast<DWORD>(m_size >> 32),
+                                        static_cast<DWORD>(m_size), NULL);
+    void* data = nullptr;
+    if (mapping) {
+        data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, static_cast<SIZE_T>(m_size));
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    void* data = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        data = nullptr;
+#endif
+    if (!data)
+        return false;
+    m_data = static_cast<const char*>(data);
+    m_mapped_size = m_size;
+    return true;
+}
+
+size_t OutputLog::GetLineCount() const noexcept {
+    if (m_line_offsets.empty())
+        return 0;
+    // Ignore the empty line after the last line feed.
+    if (m_line_offsets.back() == m_size)
+        return m_line_offsets.size() - 1;
+    return m_line_offsets.size();
+}
+
+size_t OutputLog::FindLineByOffset(uint64_t offset) const noexcept {
+    // Find the last line that starts at or before the offset.
+    size_t low = 0;
+    size_t high = m_line_offsets.size();
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+        if (m_line_offsets[mid] <= offset)
+            low = mid;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+noex::string OutputLog::GetLines(size_t first, size_t count) noexcept {
+    size_t line_count = GetLineCount();
+    if (first >= line_count || count == 0 || !Map())
+        return "";
+    size_t last = first + count;
+    if (last > line_count)
+        last = line_count;
+    uint64_t start = m_line_offsets[first];
+    uint64_t end = last < m_line_offsets.size() ? m_line_offsets[last] : m_size;
+    // Remove the last line feed.
+    if (end > start && m_data[end - 1] == '\n')
+        end--;
+    if (end > start && m_data[end - 1] == '\r')
+        end--;
+    return noex::string(m_data + start, static_cast<size_t>(end - start));
+}
+
+size_t OutputLog::Search(const char* text, size_t start) noexcept {
+    size_t text_len = strlen(text);
+    if (text_len == 0 || start >= GetLineCount() || !Map())
+        return noex::string::npos;
+    uint64_t pos = m_line_offsets[start];
+    while (pos + text_len <= m_size) {
+        const char* found = static_cast<const char*>(
+            memchr(m_data + pos, text[0], static_cast<size_t>(m_size - pos)));
+        if (!found)
+            break;
+        pos = static_cast<uint64_t>(found - m_data);
+        if (pos + text_len > m_size)
+            break;
+        if (memcmp(found, text, text_len) == 0)
+            return FindLineByOffset(pos);
+        pos++;
+    }
+    return noex::string::npos;
+}
+
+// Don't scan the whole file to find errors.
+#define ERROR_SEARCH_LINES 10000
+
+static bool HasError(const noex::string& line) noexcept {
+    const char* error = "error";
+    for (const char* p = line.c_str(); *p; p++) {
+        size_t i = 0;
+        while (error[i] && (p[i] | 0x20) == error[i])
+            i++;
+        if (!error[i])
+            return true;
+    }
+    return false;
+}
+
+noex::string OutputLog::GetErrorRegion(size_t max_lines) noexcept {
+    size_t line_count = GetLineCount();
+    if (line_count == 0 || max_lines == 0)
+        return "";
+
+    size_t first = line_count > max_lines ? line_count - max_lines : 0;
+    // Find the last error in the last lines.
+    size_t search_end = line_count > ERROR_SEARCH_LINES ? line_count - ERROR_SEARCH_LINES : 0;
+    for (size_t i = line_count; i > search_end; i--) {
+        if (HasError(GetLine(i - 1))) {
+            first = i - 1 > max_lines / 2 ? i - 1 - max_lines / 2 : 0;
+            break;
+        }
+    }
+    size_t last = first + max_lines;
+    if (last > line_count)
+        last = line_count;
+    noex::string header = "Lines " + noex::to_string(first + 1) + "-" +
+        noex::to_string(last) + " of " + noex::to_string(line_count) + ":\n";
+    return header + GetLines(first, last - first);
+}
@@ -0,0 +1,102 @@
+#include "output_viewer.h"
+#include "component.h"
+#include "tuw_constants.h"
+
+// Number of lines in a page
+#define PAGE_LINES 200
+
+static int OnViewerClosing(uiWindow *w, void *data) noexcept {
+    static_cast<OutputViewer*>(data)->OnClosed();
+    UNUSED(w);
+    return 1;
+}
+
+static void OnFindClicked(uiButton *sender, void *data) noexcept {
+    static_cast<OutputViewer*>(data)->FindNext();
+    UNUSED(sender);
+}
+
+static void OnGoClicked(uiButton *sender, void *data) noexcept {
+    static_cast<OutputViewer*>(data)->GoToLine();
+    UNUSED(sender);
+}
+
+void OutputViewer::BuildWindow() noexcept {
+    noex::string title = "Output - " + m_log->GetPath();
+    m_window = uiNewWindow(title.c_str(), 600, 400, 0);
+    uiWindowOnClosing(m_window, OnViewerClosing, this);
+    uiWindowSetMargined(m_window, 1);
+
+    uiBox* tool_box = uiNewHorizontalBox();
+    uiBoxSetSpacing(tool_box, tuw_constants::BOX_SUB_SPACE);
+    m_search_entry = uiNewSearchEntry();
+    uiBoxAppend(tool_box, uiControl(m_search_entry), 1);
+    uiButton* find_button = uiNewButton("Find");
+    uiButtonOnClicked(find_button, OnFindClicked, this);
+    uiBoxAppend(tool_box, uiControl(find_button), 0);
+    m_line_picker = uiNewSpinboxDoubleEx(1, INT32_MAX, 0, 1, 0);
+    uiBoxAppend(tool_box, uiControl(m_line_picker), 0);
+    uiButton* go_button = uiNewButton("Go to Line");
+    uiButtonOnClicked(go_button, OnGoClicked, this);
+    uiBoxAppend(tool_box, uiControl(go_button), 0);
+
+    m_status = uiNewLabel("");
+    m_text = uiNewMultilineEntry();
+    uiMultilineEntrySetReadOnly(m_text, 1);
+
+    uiBox* main_box = uiNewVerticalBox();
+    uiBoxSetSpacing(main_box, tuw_constants::BOX_SUB_SPACE);
+    uiBoxAppend(main_box, uiControl(tool_box), 0);
+    uiBoxAppend(main_box, uiControl(m_status), 0);
+    uiBoxAppend(main_box, uiControl(m_text), 1);
+    uiWindowSetChild(m_window, uiControl(main_box));
+}
+
+void OutputViewer::Show(OutputLog* log) noexcept {
+    m_log = log;
+    if (m_window)
+        uiControlDestroy(uiControl(m_window));
+    BuildWindow();
+    m_found_line = noex::string::npos;
+    ShowPage(0);
+    uiControlShow(uiControl(m_window));
+}
+
+void OutputViewer::ShowPage(size_t first_line) noexcept {
+    size_t line_count = m_log->GetLineCount();
+    if (first_line >= line_count)
+        first_line = line_count > 0 ? line_count - 1 : 0;
+    m_first_line = first_line;
+    size_t last_line = first_line + PAGE_LINES;
+    if (last_line > line_count)
+        last_line = line_count;
+
+    noex::string status = "Lines " + noex::to_string(line_count ? first_line + 1 : 0) +
+        "-" + noex::to_string(last_line) + " of " + noex::to_string(line_count);
+    if (m_found_line != noex::string::npos)
+        status += " (Found at line " + noex::to_string(m_found_line + 1) + ")";
+    uiLabelSetText(m_status, status.c_str());
+    uiMultilineEntrySetText(m_text, m_log->GetLines(first_line, PAGE_LINES).c_str());
+}
+
+void OutputViewer::FindNext() noexcept {
+    char* text = uiEntryText(m_search_entry);
+    size_t start = m_found_line == noex::string::npos ? 0 : m_found_line + 1;
+    m_found_line = m_log->Search(text, start);
+    if (m_found_line == noex::string::npos && start > 0) {
+        // Search from the beginning
+        m_found_line = m_log->Search(text, 0);
+    }
+    uiFreeText(text);
+    if (m_found_line == noex::string::npos) {
+        uiLabelSetText(m_status, "Not found.");
+        return;
+    }
+    ShowPage(m_found_line);
+}
+
+void OutputViewer::GoToLine() noexcept {
+    int line = uiSpinboxValue(m_line_picker);
+    m_found_line = noex::string::npos;
+    ShowPage(line > 0 ? static_cast<size_t>(line - 1) : 0);
+}
@@ -0,0 +1,812 @@
+#include "process.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#ifdef TUW_USE_ZYGOTE
+#include <poll.h>
+#include "zygote.h"
+#endif
+
+#ifdef __APPLE__
+// environ is not available for shared libraries on macOS.
+#include <crt_externs.h>
+#define environ (*_NSGetEnviron())
+#else
+extern char** environ;
+#endif
+#endif  // _WIN32
+
+#ifdef _WIN32
+
+uint64_t GetMonotonicTimeUs() noexcept {
+    LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return static_cast<uint64_t>(count.QuadPart) / freq.QuadPart * 1000000 +
+           static_cast<uint64_t>(count.QuadPart) % freq.QuadPart * 1000000 / freq.QuadPart;
+}
+
+// FILETIME uses 100ns units.
+static uint64_t FiletimeToUs(const FILETIME& time) noexcept {
+    return ((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 10;
+}
+
+ChildProcess::ChildProcess() noexcept :
+        m_process(), m_redirect_output(false), m_job(nullptr), m_is_running(false),
+        m_start_time_us(0), m_stats(), m_timeout_us(0), m_kill_grace_us(0),
+        m_timed_out(false), m_killed(false) {}
+
+ChildProcess::~ChildProcess() noexcept {
+    int exit_code;
+    Join(&exit_code);
+}
+
+bool ChildProcess::Spawn(const ArgChar* const* argv, int options) noexcept {
+    if (m_is_running)
+        return false;
+    bool redirect_output = options & PROCESS_REDIRECT_OUTPUT;
+    int subprocess_options = subprocess_option_inherit_environment
+                             | subprocess_option_search_user_path;
+    if (redirect_output)
+        subprocess_options |= subprocess_option_enable_async;
+    if (m_timeout_us)
+        options |= PROCESS_NEW_GROUP;
+    m_stats = ProcessStats();
+    m_start_time_us = GetMonotonicTimeUs();
+    m_timed_out = false;
+    m_killed = false;
+    if (subprocess_create(argv, subprocess_options, &m_process) != 0)
+        return false;
+    if (options & PROCESS_NEW_GROUP) {
+        // Children of the process join the job object too.
+        m_job = CreateJobObjectW(NULL, NULL);
+        if (m_job && !AssignProcessToJobObject(m_job, static_cast<HANDLE>(m_process.hProcess))) {
+            CloseHandle(m_job);
+            m_job = nullptr;
+        }
+    }
+    m_redirect_output = redirect_output;
+    m_is_running = true;
+    return true;
+}
+
+unsigned ChildProcess::ReadStdout(char* buf, unsigned size) noexcept {
+    if (!m_is_running || !m_redirect_output)
+        return 0;
+    return subprocess_read_stdout(&m_process, buf, size);
+}
+
+unsigned ChildProcess::ReadStderr(char* buf, unsigned size) noexcept {
+    if (!m_is_running || !m_redirect_output)
+        return 0;
+    return subprocess_read_stderr(&m_process, buf, size);
+}
+
+bool ChildProcess::WriteStdin(const char* buf, unsigned size) noexcept {
+    if (!m_is_running)
+        return false;
+    FILE* fp = subprocess_stdin(&m_process);
+    if (!fp)
+        return false;
+    return fwrite(buf, sizeof(char), size, fp) == size && fflush(fp) == 0;
+}
+
+int64_t ChildProcess::TryWriteStdin(const char* buf, size_t size) noexcept {
+    // Anonymous pipes on Windows don't support non-blocking writes.
+    if (!WriteStdin(buf, static_cast<unsigned>(size)))
+        return -1;
+    return static_cast<int64_t>(size);
+}
+
+void ChildProcess::CloseStdin() noexcept {
+    if (!m_is_running || !m_process.stdin_file)
+        return;
+    fclose(m_process.stdin_file);
+    m_process.stdin_file = nullptr;
+}
+
+bool ChildProcess::IsAlive() noexcept {
+    return m_is_running && subprocess_alive(&m_process);
+}
+
+const char* ChildProcess::ApplyLimits(const ProcessLimits& limits) noexcept {
+    if (!m_is_running)
+        return "The process is not running.";
+    HANDLE handle = static_cast<HANDLE>(m_process.hProcess);
+    const char* err = nullptr;
+    if (limits.use_nice) {
+        DWORD priority = limits.nice >= 15 ? IDLE_PRIORITY_CLASS :
+                         limits.nice > 0 ? BELOW_NORMAL_PRIORITY_CLASS :
+                         limits.nice <= -15 ? HIGH_PRIORITY_CLASS :
+                         limits.nice < 0 ? ABOVE_NORMAL_PRIORITY_CLASS :
+                         NORMAL_PRIORITY_CLASS;
+        if (!SetPriorityClass(handle, priority))
+            err = "Failed to set the priority.";
+    }
+    if (limits.cpu_mask) {
+        DWORD_PTR process_mask;
+        DWORD_PTR system_mask;
+        DWORD_PTR mask = 0;
+        if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+            mask = static_cast<DWORD_PTR>(limits.cpu_mask) & system_mask;
+        if (!mask || !SetProcessAffinityMask(handle, mask))
+            err = "Failed to set the CPU affinity.";
+    }
+    if (limits.memory_limit_mb || limits.cpu_limit) {
+        // Processes in a job object share the limits.
+        bool ok = true;
+        if (!m_job) {
+            m_job = CreateJobObjectW(NULL, NULL);
+            ok = m_job && AssignProcessToJobObject(m_job, handle);
+            if (!ok && m_job) {
+                CloseHandle(m_job);
+                m_job = nullptr;
+            }
+        }
+        if (ok && limits.memory_limit_mb) {
+            JOBOBJECT_EXTENDED_LIMIT_INFORMATION info;
+            ZeroMemory(&info, sizeof(info));
+            info.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_JOB_MEMORY;
+            info.JobMemoryLimit = static_cast<SIZE_T>(limits.memory_limit_mb) << 20;
+            ok = SetInformationJobObject(m_job, JobObjectExtendedLimitInformation,
+                                         &info, sizeof(info));
+        }
+        if (ok && limits.cpu_limit) {
+#if _WIN32_WINNT >= 0x0602
+            // CpuRate is 1/100 percent of all CPUs.
+            SYSTEM_INFO sys_info;
+            GetSystemInfo(&sys_info);
+            DWORD rate = static_cast<DWORD>(limits.cpu_limit) * 100 /
+                         sys_info.dwNumberOfProcessors;
+            JOBOBJECT_CPU_RATE_CONTROL_INFORMATION info;
+            ZeroMemory(&info, sizeof(info));
+            info.ControlFlags = JOB_OBJECT_CPU_RATE_CONTROL_ENABLE |
+                                JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP;
+            info.CpuRate = rate < 1 ? 1 : rate > 10000 ? 10000 : rate;
+            ok = SetInformationJobObject(m_job, JobObjectCpuRateControlInformation,
+                                         &info, sizeof(info));
+#else
+            ok = false;
+#endif
+        }
+        if (!ok)
+            err = "Failed to apply memory and CPU limits with a job object.";
+    }
+    return err;
+}
+
+void ChildProcess::Terminate() noexcept {
+    if (!m_is_running)
+        return;
+    if (m_job)
+        TerminateJobObject(m_job, 1);
+    else
+        subprocess_terminate(&m_process);
+}
+
+void ChildProcess::Interrupt() noexcept {
+    Terminate();
+}
+
+bool ChildProcess::Join(int* exit_code) noexcept {
+    if (!m_is_running) {
+        *exit_code = -1;
+        return false;
+    }
+    m_is_running = false;
+    if (subprocess_join(&m_process, exit_code)) {
+        subprocess_destroy(&m_process);
+        *exit_code = -1;
+        return false;
+    }
+    m_stats.wall_time_us = GetMonotonicTimeUs() - m_start_time_us;
+
+    HANDLE handle = static_cast<HANDLE>(m_process.hProcess);
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (GetProcessTimes(handle, &creation_time, &exit_time, &kernel_time, &user_time)) {
+        m_stats.user_time_us = FiletimeToUs(user_time);
+        m_stats.sys_time_us = FiletimeToUs(kernel_time);
+    }
+    IO_COUNTERS io;
+    if (GetProcessIoCounters(handle, &io)) {
+        m_stats.read_blocks = io.ReadOperationCount;
+        m_stats.write_blocks = io.WriteOperationCount;
+    }
+
+    if (m_job) {
+        CloseHandle(m_job);
+        m_job = nullptr;
+    }
+
+    if (subprocess_destroy(&m_process)) {
+        *exit_code = -1;
+        return false;
+    }
+    return true;
+}
+
+#else  // _WIN32
+
+ChildProcess::ChildProcess() noexcept :
+        m_pid(0), m_stdout_fd(-1), m_stderr_fd(-1), m_stdin_fd(-1), m_input_fd(-1),
+        m_exit_code(-1), m_pgid(0),
+#ifdef __linux__
+        m_cgroup_dir(nullptr),
+#endif
+#ifdef TUW_USE_ZYGOTE
+        m_status_fd(-1),
+#endif
+        m_is_running(false),
+        m_start_time_us(0), m_stats(), m_timeout_us(0), m_kill_grace_us(0),
+        m_timed_out(false), m_killed(false) {}
+
+static void CloseFd(int* fd) noexcept {
+    if (*fd < 0)
+        return;
+    close(*fd);
+    *fd = -1;
+}
+
+ChildProcess::~ChildProcess() noexcept {
+    int exit_code;
+    Join(&exit_code);
+    CloseFd(&m_input_fd);  // When Spawn() failed
+}
+
+// Makes a pipe that won't leak into other processes.
+// One end will be duplicated to stdin, stdout, or stderr of the child.
+// The other end is for the parent. It will be non-blocking for reading.
+static bool OpenPipe(int fds[2], bool is_output) noexcept {
+    if (pipe(fds) != 0)
+        return false;
+    if (fcntl(fds[0], F_SETFD, FD_CLOEXEC) == -1 ||
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC) == -1 ||
+        (is_output &&
+            fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK) == -1)) {
+        CloseFd(&fds[0]);
+        CloseFd(&fds[1]);
+        return false;
+    }
+    return true;
+}
+
+uint64_t GetMonotonicTimeUs() noexcept {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+#ifndef __HAIKU__
+static uint64_t TimevalToUs(const struct timeval& time) noexcept {
+    return static_cast<uint64_t>(time.tv_sec) * 1000000 + time.tv_usec;
+}
+
+static void SetUsage(const struct rusage& usage, ProcessStats* stats) noexcept {
+    stats->user_time_us = TimevalToUs(usage.ru_utime);
+    stats->sys_time_us = TimevalToUs(usage.ru_stime);
+#ifdef __APPLE__
+    stats->max_rss_kb = static_cast<uint64_t>(usage.ru_maxrss) / 1024;  // bytes on macOS
+#else
+    stats->max_rss_kb = static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+    stats->read_blocks = static_cast<uint64_t>(usage.ru_inblock);
+    stats->write_blocks = static_cast<uint64_t>(usage.ru_oublock);
+}
+#endif
+
+// waitpid() that also gets resource usage of the child.
+static pid_t WaitProcess(pid_t pid, int* status, int options, ProcessStats* stats) noexcept {
+#ifdef __HAIKU__
+    // Haiku doesn't have wait4().
+    return waitpid(pid, status, options);
+#else
+    struct rusage usage;
+    pid_t ret = wait4(pid, status, options, &usage);
+    if (ret == pid)
+        SetUsage(usage, stats);
+    return ret;
+#endif
+}
+
+#ifdef WNOWAIT
+// waitid() that leaves the process as a zombie. The zombie keeps its pid and pgid reserved.
+// Returns 1 when the process has exited, 0 when it's running, and -1 on failure.
+static int PeekExit(pid_t pid, bool block) noexcept {
+    siginfo_t info;
+    memset(&info, 0, sizeof(info));
+    int options = WEXITED | WNOWAIT | (block ? 0 : WNOHANG);
+    int ret;
+    do {
+        ret = waitid(P_PID, static_cast<id_t>(pid), &info, options);
+    } while (ret < 0 && errno == EINTR);
+    if (ret != 0)
+        return -1;
+    return info.si_pid == pid ? 1 : 0;
+}
+#endif
+
+static int ToExitCode(int status) noexcept {
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    return EXIT_FAILURE;
+}
+
+static bool InitSpawnAttr(posix_spawnattr_t* attr, int options) noexcept {
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    if (options & PROCESS_NEW_GROUP)
+        flags |= POSIX_SPAWN_SETPGROUP;  // The pgid will be the same as the pid.
+#ifdef POSIX_SPAWN_USEVFORK
+    // Old glibc uses fork() unless this flag is set.
+    flags |= POSIX_SPAWN_USEVFORK;
+#endif
+    // GTK might block or ignore some signals. Reset them for the child.
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigset_t def;
+    sigemptyset(&def);
+    sigaddset(&def, SIGPIPE);
+    return posix_spawnattr_setflags(attr, flags) == 0 &&
+           posix_spawnattr_setpgroup(attr, 0) == 0 &&
+           posix_spawnattr_setsigmask(attr, &mask) == 0 &&
+           posix_spawnattr_setsigdefault(attr, &def) == 0;
+}
+
+bool ChildProcess::Spawn(const ArgChar* const* argv, int options) noexcept {
+    if (m_is_running)
+        return false;
+    if (m_timeout_us)
+        options |= PROCESS_NEW_GROUP;
+    m_timed_out = false;
+    m_killed = false;
+    if (m_input_fd >= 0)
+        options &= ~(PROCESS_PIPE_STDIN | PROCESS_NONBLOCK_STDIN);
+
+#ifdef TUW_USE_ZYGOTE
+    size_t argc = 0;
+    while (argv[argc])
+        argc++;
+    // The zygote can't use fds of the GUI, and it has a limit of arguments.
+    if (ZygoteIsRunning() && m_input_fd < 0 && argc <= ZYGOTE_ARGC_MAX) {
+        ZygoteChild child;
+        m_stats = ProcessStats();
+        m_start_time_us = GetMonotonicTimeUs();
+        if (ZygoteSpawn(argv, options, &child)) {
+            if (child.stdout_fd >= 0)
+                fcntl(child.stdout_fd, F_SETFL, fcntl(child.stdout_fd, F_GETFL) | O_NONBLOCK);
+            if (child.stderr_fd >= 0)
+                fcntl(child.stderr_fd, F_SETFL, fcntl(child.stderr_fd, F_GETFL) | O_NONBLOCK);
+            if (child.stdin_fd >= 0 && (options & PROCESS_NONBLOCK_STDIN))
+                fcntl(child.stdin_fd, F_SETFL, fcntl(child.stdin_fd, F_GETFL) | O_NONBLOCK);
+            m_pid = child.pid;
+            m_stdout_fd = child.stdout_fd;
+            m_stderr_fd = child.stderr_fd;
+            m_stdin_fd = child.stdin_fd;
+            m_status_fd = child.status_fd;
+            m_pgid = (options & PROCESS_NEW_GROUP) ? child.pid : 0;
+            m_exit_code = -1;
+            m_is_running = true;
+            return true;
+        }
+        // Fall back to posix_spawn if the zygote is dead.
+        if (ZygoteIsRunning())
+            return false;
+    }
+#endif
+
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0)
+        return false;
+    posix_spawnattr_t attr;
+    if (posix_spawnattr_init(&attr) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return false;
+    }
+
+    int out_pipe[2] = { -1, -1 };
+    int err_pipe[2] = { -1, -1 };
+    int in_pipe[2] = { -1, -1 };
+    bool ok = InitSpawnAttr(&attr, options);
+    if (ok && (options & PROCESS_REDIRECT_OUTPUT)) {
+        ok = OpenPipe(out_pipe, true) && OpenPipe(err_pipe, true) &&
+             posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO) == 0 &&
+             posix_spawn_file_actions_adddup2(&actions, err_pipe[1], STDERR_FILENO) == 0;
+    }
+    if (ok && (options & PROCESS_PIPE_STDIN)) {
+        ok = OpenPipe(in_pipe, false) &&
+             posix_spawn_file_actions_adddup2(&actions, in_pipe[0], STDIN_FILENO) == 0;
+        if (ok && (options & PROCESS_NONBLOCK_STDIN))
+            ok = fcntl(in_pipe[1], F_SETFL, fcntl(in_pipe[1], F_GETFL) | O_NONBLOCK) != -1;
+    } else if (ok && m_input_fd >= 0) {
+        ok = posix_spawn_file_actions_adddup2(&actions, m_input_fd, STDIN_FILENO) == 0;
+    } else if (ok && (options & PROCESS_REDIRECT_OUTPUT)) {
+        // Nobody writes to stdin. Make it return EOF instead of blocking.
+        ok = posix_spawn_file_actions_addopen(
+                &actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0) == 0;
+    }
+
+    pid_t pid = 0;
+    m_stats = ProcessStats();
+    m_start_time_us = GetMonotonicTimeUs();
+    if (ok) {
+        ok = posix_spawnp(&pid, argv[0], &actions, &attr,
+                          const_cast<char* const*>(argv), environ) == 0;
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    CloseFd(&out_pipe[1]);
+    CloseFd(&err_pipe[1]);
+    CloseFd(&in_pipe[0]);
+    CloseFd(&m_input_fd);
+
+    if (!ok) {
+        CloseFd(&out_pipe[0]);
+        CloseFd(&err_pipe[0]);
+        CloseFd(&in_pipe[1]);
+        return false;
+    }
+
+    m_pid = pid;
+    m_pgid = (options & PROCESS_NEW_GROUP) ? pid : 0;
+    m_stdout_fd = out_pipe[0];
+    m_stderr_fd = err_pipe[0];
+    m_stdin_fd = in_pipe[1];
+    m_exit_code = -1;
+    m_is_running = true;
+    return true;
+}
+
+static unsigned ReadFd(int fd, char* buf, unsigned size) noexcept {
+    if (fd < 0)
+        return 0;
+    ssize_t read_size;
+    do {
+        read_size = read(fd, buf, size);
+    } while (read_size < 0 && errno == EINTR);
+    if (read_size <= 0)
+        return 0;  // EOF or EAGAIN
+    return static_cast<unsigned>(read_size);
+}
+
+unsigned ChildProcess::ReadStdout(char* buf, unsigned size) noexcept {
+    return ReadFd(m_stdout_fd, buf, size);
+}
+
+unsigned ChildProcess::ReadStderr(char* buf, unsigned size) noexcept {
+    return ReadFd(m_stderr_fd, buf, size);
+}
+
+bool ChildProcess::WriteStdin(const char* buf, unsigned size) noexcept {
+    if (m_stdin_fd < 0)
+        return false;
+    while (size > 0) {
+        ssize_t written = write(m_stdin_fd, buf, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        buf += written;
+        size -= static_cast<unsigned>(written);
+    }
+    return true;
+}
+
+int64_t ChildProcess::TryWriteStdin(const char* buf, size_t size) noexcept {
+    if (m_stdin_fd < 0) {
+        errno = EPIPE;
+        return -1;
+    }
+    ssize_t written;
+    do {
+        written = write(m_stdin_fd, buf, size);
+    } while (written < 0 && errno == EINTR);
+    return static_cast<int64_t>(written);
+}
+
+#ifdef __linux__
+int64_t ChildProcess::SpliceToStdin(int fd, size_t size) noexcept {
+    if (m_stdin_fd < 0) {
+        errno = EPIPE;
+        return -1;
+    }
+    ssize_t moved;
+    do {
+        moved = splice(fd, nullptr, m_stdin_fd, nullptr, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    } while (moved < 0 && errno == EINTR);
+    return static_cast<int64_t>(moved);
+}
+#endif
+
+void ChildProcess::CloseStdin() noexcept {
+    CloseFd(&m_stdin_fd);
+}
+
+void ChildProcess::SetStdinFd(int fd) noexcept {
+    CloseFd(&m_input_fd);
+    m_input_fd = fd;
+}
+
+int ChildProcess::ReleaseStdout() noexcept {
+    int fd = m_stdout_fd;
+    m_stdout_fd = -1;
+    if (fd >= 0)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    return fd;
+}
+
+// Sends a signal to the process group, or to the process.
+static void SendSignal(pid_t pid, pid_t pgid, int sig) noexcept {
+    if (pgid > 0)
+        kill(-pgid, sig);
+    else if (pid > 0)
+        kill(pid, sig);
+}
+
+// IsAlive() clears m_pid when the process was reaped by us or the zygote.
+// The pid and the pgid might be reused by another process after that.
+void ChildProcess::Terminate() noexcept {
+    if (IsAlive())
+        SendSignal(m_pid, m_pgid, SIGKILL);
+}
+
+void ChildProcess::Interrupt() noexcept {
+    if (IsAlive())
+        SendSignal(m_pid, m_pgid, SIGTERM);
+}
+
+#ifdef __linux__
+// Gets the cgroup v2 path of Tuw from "0::<path>" in /proc/self/cgroup.
+static bool GetCgroupPath(char* path, size_t size) noexcept {
+    FILE* fp = fopen("/proc/self/cgroup", "re");
+    if (!fp)
+        return false;
+    char line[PATH_MAX];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "0::", 3) != 0)
+            continue;
+        line[strcspn(line, "\n")] = 0;
+        found = strlen(line + 3) < size;
+        if (found)
+            strcpy(path, line + 3);
+    }
+    fclose(fp);
+    return found;
+}
+
+static bool WriteCgroupFile(const char* dir, const char* name, const char* value) noexcept {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    size_t len = strlen(value);
+    bool ok = write(fd, value, len) == static_cast<ssize_t>(len);
+    close(fd);
+    return ok;
+}
+
+// Moves the process to a new cgroup and returns its path.
+// The cgroup is made next to the cgroup of Tuw
+// because a cgroup that has processes can't enable controllers for its children.
+static char* CreateCgroup(pid_t pid, const ProcessLimits& limits) noexcept {
+    char self[PATH_MAX / 2];
+    if (!GetCgroupPath(self, sizeof(self)))
+        return nullptr;
+    char* slash = strrchr(self, '/');
+    if (!slash)
+        return nullptr;
+    *slash = 0;
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "/sys/fs/cgroup%s/tuw-%d-%d",
+             self, static_cast<int>(getpid()), static_cast<int>(pid));
+    if (mkdir(dir, 0755) != 0)
+        return nullptr;
+
+    char value[64];
+    bool ok = true;
+    if (limits.memory_limit_mb) {
+        snprintf(value, sizeof(value), "%llu",
+                 static_cast<unsigned long long>(limits.memory_limit_mb) << 20);
+        ok = WriteCgroupFile(dir, "memory.max", value);
+    }
+    if (ok && limits.cpu_limit) {
+        // Quota per 100ms
+        snprintf(value, sizeof(value), "%d 100000", limits.cpu_limit * 1000);
+        ok = WriteCgroupFile(dir, "cpu.max", value);
+    }
+    if (ok) {
+        snprintf(value, sizeof(value), "%d", static_cast<int>(pid));
+        ok = WriteCgroupFile(dir, "cgroup.procs", value);
+    }
+    if (!ok) {
+        rmdir(dir);
+        return nullptr;
+    }
+    return strdup(dir);
+}
+#endif  // __linux__
+
+const char* ChildProcess::ApplyLimits(const ProcessLimits& limits) noexcept {
+    if (m_pid <= 0)
+        return "The process is not running.";
+    const char* err = nullptr;
+    // Negative values require privileges.
+    if (limits.use_nice && setpriority(PRIO_PROCESS, m_pid, limits.nice) != 0)
+        err = "Failed to set the priority.";
+    if (limits.cpu_mask) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int i = 0; i < 64; i++) {
+            if (limits.cpu_mask & (1ULL << i))
+                CPU_SET(i, &set);
+        }
+        if (sched_setaffinity(m_pid, sizeof(set), &set) != 0)
+            err = "Failed to set the CPU affinity.";
+#else
+        err = "CPU affinity is not supported on this platform.";
+#endif
+    }
+    if (limits.memory_limit_mb || limits.cpu_limit) {
+#ifdef __linux__
+        if (!m_cgroup_dir)
+            m_cgroup_dir = CreateCgroup(m_pid, limits);
+        if (!m_cgroup_dir)
+            err = "Failed to apply memory and CPU limits. cgroup v2 is not writable.";
+#else
+        err = "Memory and CPU limits are not supported on this platform.";
+#endif
+    }
+    return err;
+}
+
+#ifdef TUW_USE_ZYGOTE
+// Reads the exit status sent by the monitor process of the zygote.
+// Returns false if the process is still running. (Only when block is false.)
+bool ChildProcess::ReadZygoteReport(bool block) noexcept {
+    if (!block) {
+        struct pollfd pfd = { m_status_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 0) == 0)
+            return false;
+    }
+    ZygoteReport report;
+    ssize_t ret;
+    do {
+        ret = read(m_status_fd, &report, sizeof(report));
+    } while (ret < 0 && errno == EINTR);
+    // The report is smaller than PIPE_BUF. It never be split.
+    if (ret == sizeof(report) && report.status >= 0) {
+        m_exit_code = ToExitCode(report.status);
+        SetUsage(report.usage, &m_stats);
+        m_stats.wall_time_us = GetMonotonicTimeUs() - m_start_time_us;
+    }
+    CloseFd(&m_status_fd);
+    m_pid = 0;
+    return true;
+}
+#endif
+
+bool ChildProcess::IsAlive() noexcept {
+#ifdef TUW_USE_ZYGOTE
+    if (m_status_fd >= 0)
+        return !ReadZygoteReport(false);
+#endif
+    if (m_pid <= 0)
+        return false;
+#ifdef WNOWAIT
+    // Join() reaps the process after it kills the rest of the group.
+    if (m_pgid > 0) {
+        int exited = PeekExit(m_pid, false);
+        if (exited == 0)
+            return true;
+        if (exited == 1) {
+            if (!m_stats.wall_time_us)
+                m_stats.wall_time_us = GetMonotonicTimeUs() - m_start_time_us;
+            return false;
+        }
+    }
+#endif
+    int status;
+    pid_t ret = WaitProcess(m_pid, &status, WNOHANG, &m_stats);
+    if (ret == 0)
+        return true;
+    if (ret == m_pid) {
+        m_exit_code = ToExitCode(status);
+        m_stats.wall_time_us = GetMonotonicTimeUs() - m_start_time_us;
+    }
+    m_pid = 0;
+    return false;
+}
+
+bool ChildProcess::Join(int* exit_code) noexcept {
+    if (!m_is_running) {
+        *exit_code = -1;
+        return false;
+    }
+    bool ok = true;
+#ifdef TUW_USE_ZYGOTE
+    if (m_status_fd >= 0)
+        ReadZygoteReport(true);
+#endif
+    if (m_pid > 0) {
+#ifdef WNOWAIT
+        // Descendants that ignored SIGTERM should not outlive the timed out process.
+        // Kill them before reaping the process, or the pgid might be reused by others.
+        if (m_timed_out && m_pgid > 0 && PeekExit(m_pid, true) == 1)
+            kill(-m_pgid, SIGKILL);
+#endif
+        int status;
+        pid_t ret;
+        do {
+            ret = WaitProcess(m_pid, &status, 0, &m_stats);
+        } while (ret < 0 && errno == EINTR);
+        ok = ret == m_pid;
+        m_exit_code = ok ? ToExitCode(status) : -1;
+        if (ok && !m_stats.wall_time_us)
+            m_stats.wall_time_us = GetMonotonicTimeUs() - m_start_time_us;
+        m_pid = 0;
+    } else {
+        ok = m_exit_code >= 0;
+    }
+    CloseFd(&m_stdout_fd);
+    CloseFd(&m_stderr_fd);
+    CloseFd(&m_stdin_fd);
+    CloseFd(&m_input_fd);
+    // The group was killed before reaping the process.
+    // (Not with the zygote. Its monitor reaps the process, so the pgid might be reused.)
+    m_pgid = 0;
+#ifdef __linux__
+    if (m_cgroup_dir) {
+        // Fails when grandchildren are still running.
+        rmdir(m_cgroup_dir);
+        free(m_cgroup_dir);
+        m_cgroup_dir = nullptr;
+    }
+#endif
+    m_is_running = false;
+    *exit_code = m_exit_code;
+    return ok;
+}
+
+#endif  // _WIN32
+
+void ChildProcess::SetTimeout(uint32_t timeout_ms, uint32_t kill_grace_ms) noexcept {
+    m_timeout_us = static_cast<uint64_t>(timeout_ms) * 1000;
+    m_kill_grace_us = static_cast<uint64_t>(kill_grace_ms) * 1000;
+}
+
+bool ChildProcess::CheckTimeout() noexcept {
+    if (!m_is_running || !m_timeout_us || m_killed)
+        return m_timed_out;
+    uint64_t elapsed_us = GetMonotonicTimeUs() - m_start_time_us;
+    if (elapsed_us < m_timeout_us)
+        return false;
+    if (!m_timed_out && m_kill_grace_us) {
+        m_timed_out = true;
+        Interrupt();
+    } else if (elapsed_us >= m_timeout_us + m_kill_grace_us) {
+        m_timed_out = true;
+        m_killed = true;
+        Terminate();
+    }
+    return true;
+}
@@ -0,0 +1,178 @@
+#include "result_cache.h"
+#include "json_utils.h"
+#include "string_utils.h"
+#include <inttypes.h>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+// We should keep the file smaller than JSON_SIZE_MAX even if all characters are escaped.
+#define CACHE_SIZE_MAX (JSON_SIZE_MAX / 4)
+
+noex::string GetFileStamp(const char* path) noexcept {
+    uint64_t size;
+    uint64_t sec;
+    uint64_t nsec;
+#ifdef _WIN32
+    noex::wstring wpath = UTF8toUTF16(path);
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (wpath.empty() ||
+        !GetFileAttributesExW(wpath.c_str(), GetFileExInfoStandard, &data))
+        return "";
+    size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    // FILETIME is in 100ns units.
+    uint64_t mtime = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                     data.ftLastWriteTime.dwLowDateTime;
+    sec = mtime / 10000000;
+    nsec = (mtime % 10000000) * 100;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return "";
+    size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+    sec = static_cast<uint64_t>(st.st_mtimespec.tv_sec);
+    nsec = static_cast<uint64_t>(st.st_mtimespec.tv_nsec);
+#else
+    sec = static_cast<uint64_t>(st.st_mtim.tv_sec);
+    nsec = static_cast<uint64_t>(st.st_mtim.tv_nsec);
+#endif
+#endif
+    // Seconds are not enough. A file can be edited twice in a second.
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%" PRIu64 ":%" PRIu64 ".%09" PRIu64, size, sec, nsec);
+    return buf;
+}
+
+noex::string ArgsToCacheKey(const noex::vector<noex::string>& args) noexcept {
+    noex::string key;
+    for (const noex::string& arg : args) {
+        key += noex::to_string(arg.size());
+        key.push_back(':');
+        key += arg;
+    }
+    return key;
+}
+
+static size_t GetEntrySize(const tuwjson::Value& entry) noexcept {
+    return strlen(entry["key"].GetString()) +
+           strlen(entry["err_msg"].GetString()) +
+           strlen(entry["last_line"].GetString()) + 64;
+}
+
+static bool IsValidEntry(const tuwjson::Value& entry) noexcept {
+    if (!entry.IsObject())
+        return false;
+    tuwjson::Value* key = entry.GetMemberPtr("key");
+    tuwjson::Value* exit_code = entry.GetMemberPtr("exit_code");
+    tuwjson::Value* err_msg = entry.GetMemberPtr("err_msg");
+    tuwjson::Value* last_line = entry.GetMemberPtr("last_line");
+    return key && key->IsString() &&
+           exit_code && exit_code->IsInt() &&
+           err_msg && err_msg->IsString() &&
+           last_line && last_line->IsString();
+}
+
+void ResultCache::Load() noexcept {
+    m_is_loaded = true;
+    m_entries.SetArray();
+
+    tuwjson::Value json;
+    noex::string err = json_utils::LoadJson(m_path, json);
+    if (!err.empty())
+        return;
+    tuwjson::Value* entries = json.GetMemberPtr("entries");
+    if (!entries || !entries->IsArray())
+        return;
+    for (tuwjson::Value& entry : *entries) {
+        if (IsValidEntry(entry))
+            m_entries.MoveAndPush(entry);
+    }
+    // Remove old entries if the file is too large.
+    Touch(m_entries.GetArraySize());
+}
+
+void ResultCache::Touch(size_t id) noexcept {
+    size_t entry_count = m_entries.GetArraySize();
+
+    // Count entries we can keep from the newest one.
+    size_t total_size = 0;
+    bool keep_id = false;
+    if (id < entry_count) {
+        total_size = GetEntrySize(m_entries[id]);
+        keep_id = total_size <= CACHE_SIZE_MAX;
+        if (!keep_id)
+            total_size = 0;
+    }
+    size_t first = entry_count;
+    while (first > 0) {
+        if (first - 1 != id) {
+            size_t size = GetEntrySize(m_entries[first - 1]);
+            if (total_size + size > CACHE_SIZE_MAX)
+                break;
+            total_size += size;
+        }
+        first--;
+    }
+
+    tuwjson::Value new_entries;
+    new_entries.SetArray();
+    for (size_t i = first; i < entry_count; i++) {
+        if (i != id)
+            new_entries.MoveAndPush(m_entries[i]);
+    }
+    if (keep_id)
+        new_entries.MoveAndPush(m_entries[id]);
+    m_entries.MoveFrom(new_entries);
+}
+
+int ResultCache::Find(const noex::string& key) noexcept {
+    if (!m_is_loaded)
+        Load();
+    int entry_count = static_cast<int>(m_entries.GetArraySize());
+    for (int i = 0; i < entry_count; i++) {
+        if (key == m_entries[i]["key"].GetString())
+            return i;
+    }
+    return -1;
+}
+
+bool ResultCache::Get(const noex::string& key, ExecuteResult* result) noexcept {
+    int id = Find(key);
+    if (id < 0)
+        return false;
+    tuwjson::Value& entry = m_entries[id];
+    result->exit_code = entry["exit_code"].GetInt();
+    result->err_msg = entry["err_msg"].GetString();
+    result->last_line = entry["last_line"].GetString();
+    result->stats = ProcessStats();
+    // Note: We don't save the cache here. The order might be lost when closing the GUI.
+    Touch(static_cast<size_t>(id));
+    return true;
+}
+
+noex::string ResultCache::Put(const noex::string& key, const ExecuteResult& result) noexcept {
+    int id = Find(key);
+    if (id < 0) {
+        tuwjson::Value entry;
+        entry.SetObject();
+        entry["key"].SetString(key);
+        m_entries.MoveAndPush(entry);
+        id = static_cast<int>(m_entries.GetArraySize()) - 1;
+    }
+    tuwjson::Value& entry = m_entries[id];
+    entry["exit_code"].SetInt(result.exit_code);
+    entry["err_msg"].SetString(result.err_msg);
+    entry["last_line"].SetString(result.last_line);
+    Touch(static_cast<size_t>(id));
+
+    tuwjson::Value json;
+    json.SetObject();
+    json["entries"].CopyFrom(m_entries);
+    return json_utils::SaveJson(json, m_path, true);
+}
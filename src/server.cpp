@@ -0,0 +1,473 @@
+#include "server.h"
+#include "command.h"
+#include "json_utils.h"
+#include "process.h"
+#include "noex/new.hpp"
+#include "noex/vector.hpp"
+
+#ifdef _WIN32
+
+noex::string Serve(const tuwjson::Value& definition,
+                   const char* socket_path, int max_parallel) noexcept {
+    UNUSED(definition);
+    UNUSED(socket_path);
+    UNUSED(max_parallel);
+    return "The serve command is not supported on Windows.";
+}
+
+#else  // _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define READ_CHUNK_SIZE 4096
+// Stop reading outputs while the client is slower than the command.
+#define PENDING_OUTPUT_MAX (64 * 1024)
+
+enum ServeJobState : int {
+    SERVE_JOB_READING = 0,  // Waiting for the request line
+    SERVE_JOB_QUEUED,  // Waiting for a free slot
+    SERVE_JOB_RUNNING,
+    SERVE_JOB_CLOSING,  // Sending the rest of the response
+};
+
+struct ServeJob {
+    int fd;
+    ServeJobState state;
+    noex::string request;
+    noex::string response;
+    const tuwjson::Value* sub_definition;
+    noex::string cmd;
+    noex::vector<noex::string> args;
+    bool use_shell;
+    ChildProcess process;
+    // Incomplete UTF-8 characters at the end of the last chunks of stdout and stderr
+    noex::string out_tail;
+    noex::string err_tail;
+
+    explicit ServeJob(int client_fd) noexcept :
+        fd(client_fd), state(SERVE_JOB_READING), request(), response(),
+        sub_definition(nullptr), cmd(), args(), use_shell(true), process(),
+        out_tail(), err_tail() {}
+    ~ServeJob() noexcept {
+        close(fd);
+    }
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void OnSignal(int sig) {
+    UNUSED(sig);
+    g_stop = 1;
+}
+
+static void SetNonBlocking(int fd) noexcept {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+// Appends a JSON object to the response as a line.
+static void PushJson(ServeJob* job, tuwjson::Value& msg) noexcept {
+    // A chunk of 4KB is 24KB at most after escaping. (\u00XX for control characters)
+    char buffer[READ_CHUNK_SIZE * 8];
+    tuwjson::Writer writer("", 0, false);
+    char* end = writer.WriteJson(&msg, buffer, sizeof(buffer) - 1);
+    if (!end) {
+        // Tell the client that some outputs are missing.
+        job->response += "{\"error\": \"Failed to convert a message to JSON.\"}\n";
+        return;
+    }
+    *end = '\n';
+    job->response += noex::string(buffer, static_cast<size_t>(end + 1 - buffer));
+}
+
+static void PushMessage(ServeJob* job, const char* key,
+                        const char* str, size_t size) noexcept {
+    tuwjson::Value msg;
+    msg.SetObject();
+    msg[key].SetString(str, size);
+    PushJson(job, msg);
+}
+
+static void PushMessage(ServeJob* job, const char* key, const char* str) noexcept {
+    PushMessage(job, key, str, strlen(str));
+}
+
+static void PushResult(ServeJob* job, int exit_code, double wall_ms,
+                       bool timed_out = false) noexcept {
+    tuwjson::Value msg;
+    msg.SetObject();
+    msg["exit_code"].SetInt(exit_code);
+    msg["wall_ms"].SetDouble(wall_ms);
+    if (timed_out)
+        msg["timed_out"].SetBool(true);
+    PushJson(job, msg);
+    job->state = SERVE_JOB_CLOSING;
+}
+
+static void FailJob(ServeJob* job, const noex::string& err) noexcept {
+    PushMessage(job, "error", err.c_str());
+    job->state = SERVE_JOB_CLOSING;
+}
+
+// Parses the request and makes the command.
+static noex::string ParseRequest(const tuwjson::Value& definition, ServeJob* job) noexcept {
+    tuwjson::Value request;
+    tuwjson::Parser parser;
+    parser.ParseJson(job->request, &request);
+    if (parser.HasError())
+        return noex::concat_cstr("Failed to parse JSON: ", parser.GetErrMsg());
+    if (!request.IsObject())
+        return "Request should be a JSON object.";
+
+    int mode = 0;
+    tuwjson::Value* mode_ptr = request.GetMemberPtr("mode");
+    if (mode_ptr) {
+        if (!mode_ptr->IsInt())
+            return "\"mode\" should be an integer.";
+        mode = mode_ptr->GetInt();
+    }
+    if (mode < 0 || mode >= static_cast<int>(definition["gui"].GetArraySize()))
+        return "Invalid definition index. (" + noex::to_string(mode) + ")";
+    const tuwjson::Value& sub_definition = definition["gui"][mode];
+    if (sub_definition.HasMember("worker"))
+        return "The serve command does not support \"worker\".";
+
+    tuwjson::Value config;
+    config.SetObject();
+    tuwjson::Value* values_ptr = request.GetMemberPtr("values");
+    if (values_ptr && !values_ptr->IsObject())
+        return "\"values\" should be a JSON object.";
+    if (values_ptr) {
+        for (const tuwjson::Item& item : *values_ptr->GetObject()) {
+            const tuwjson::Value& v = *item.val;
+            noex::string value;
+            if (v.IsString())
+                value = v.GetString();
+            else if (v.IsBool())
+                value = v.GetBool() ? "true" : "false";
+            else if (v.IsInt())
+                value = noex::to_string(v.GetInt());
+            else if (v.IsDouble())
+                value = noex::to_string(v.GetDouble());
+            else
+                return noex::concat_cstr("Invalid value for \"", item.key.c_str(), "\".");
+            noex::string id_value = noex::concat_cstr(item.key.c_str(), "=", value.c_str());
+            noex::string err = SetConfigValue(sub_definition, config, id_value.c_str());
+            if (!err.empty())
+                return err;
+        }
+    }
+
+    ConfigValues config_values(sub_definition, config);
+    noex::string err = config_values.Validate();
+    if (!err.empty())
+        return err;
+
+    if (sub_definition.HasMember("stdin"))
+        return "\"stdin\" is not supported by serve.";
+    if (sub_definition.HasMember("pipeline"))
+        return "\"pipeline\" is not supported by serve.";
+
+    job->sub_definition = &sub_definition;
+    job->use_shell = json_utils::GetBool(sub_definition, "shell", true);
+    if (job->use_shell) {
+        job->cmd = BuildCommand(sub_definition, config_values, &err);
+    } else {
+        job->args = BuildCommandArgs(sub_definition, config_values, &err);
+        job->cmd = ArgsToString(job->args);
+    }
+    return err;
+}
+
+static void ReadRequest(const tuwjson::Value& definition, ServeJob* job) noexcept {
+    char buf[READ_CHUNK_SIZE];
+    ssize_t size = read(job->fd, buf, sizeof(buf));
+    if (size < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+    if (size <= 0) {
+        // Closed before sending a request
+        job->state = SERVE_JOB_CLOSING;
+        return;
+    }
+    job->request += noex::string(buf, static_cast<size_t>(size));
+    const char* line_end = strchr(job->request.c_str(), '\n');
+    if (!line_end) {
+        if (job->request.size() >= JSON_SIZE_MAX)
+            FailJob(job, "Request should be smaller than " JSON_SIZE_MAX_STR ".");
+        return;
+    }
+    job->request = noex::string(job->request.c_str(),
+                                static_cast<size_t>(line_end - job->request.c_str()));
+    noex::string err = ParseRequest(definition, job);
+    if (err.empty())
+        job->state = SERVE_JOB_QUEUED;
+    else
+        FailJob(job, err);
+}
+
+static void StartJob(ServeJob* job) noexcept {
+    PrintFmt("[Serve] Command: %s\n", job->cmd.c_str());
+    noex::vector<const char*> argv;
+    if (job->use_shell) {
+        argv.push_back("/bin/sh");
+        argv.push_back("-c");
+        argv.push_back(job->cmd.c_str());
+    } else {
+        for (const noex::string& arg : job->args)
+            argv.push_back(arg.c_str());
+    }
+    argv.push_back(nullptr);
+
+    if (argv.size() == 1 || (job->use_shell && job->cmd.empty())) {
+        // Nothing to run
+        PushResult(job, 0, 0);
+        return;
+    }
+    ProcessLimits limits;
+    bool use_limits = GetProcessLimits(*job->sub_definition, &limits);
+    job->process.SetTimeout(limits.timeout_ms, limits.kill_grace_ms);
+    if (!job->process.Spawn(argv.data())) {
+        FailJob(job, "Failed to create a subprocess.");
+        return;
+    }
+    if (use_limits) {
+        const char* err = job->process.ApplyLimits(limits);
+        if (err)
+            PrintFmt("[Serve] Warning: %s\n", err);
+    }
+    job->state = SERVE_JOB_RUNNING;
+}
+
+// Returns the size of an incomplete UTF-8 character at the end of the buffer.
+static size_t GetIncompleteUtf8Size(const char* buf, size_t size) noexcept {
+    for (size_t i = 1; i <= size && i <= 4; i++) {
+        unsigned char c = static_cast<unsigned char>(buf[size - i]);
+        if ((c & 0xC0) == 0x80)
+            continue;  // Continuation byte
+        size_t len = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 1;
+        return i < len ? i : 0;
+    }
+    return 0;
+}
+
+// Forwards outputs of stdout or stderr to the client.
+// Characters split by chunks are sent with the next chunk.
+// Returns false when the client has too many pending outputs.
+static bool ForwardOutput(ServeJob* job, bool is_stderr) noexcept {
+    noex::string& tail = is_stderr ? job->err_tail : job->out_tail;
+    const char* key = is_stderr ? "stderr" : "stdout";
+    char buf[READ_CHUNK_SIZE + 4];
+    for (;;) {
+        size_t tail_size = tail.size();
+        memcpy(buf, tail.c_str(), tail_size);
+        unsigned size = is_stderr ? job->process.ReadStderr(buf + tail_size, READ_CHUNK_SIZE)
+                                  : job->process.ReadStdout(buf + tail_size, READ_CHUNK_SIZE);
+        if (size == 0)
+            return true;
+        size += static_cast<unsigned>(tail_size);
+        size_t rest = GetIncompleteUtf8Size(buf, size);
+        tail = noex::string(buf + size - rest, rest);
+        if (size > rest)
+            PushMessage(job, key, buf, size - rest);
+        if (job->response.size() >= PENDING_OUTPUT_MAX)
+            return false;
+    }
+}
+
+// Forwards outputs to the client. Finishes the job when the process exits.
+static void UpdateJob(ServeJob* job) noexcept {
+    // The timeout should work even when the client doesn't read outputs.
+    job->process.CheckTimeout();
+    if (job->response.size() >= PENDING_OUTPUT_MAX)
+        return;
+    bool is_alive = job->process.IsAlive();
+    if (!ForwardOutput(job, false) || !ForwardOutput(job, true) || is_alive)
+        return;
+    // Broken characters at the end of outputs
+    if (!job->out_tail.empty())
+        PushMessage(job, "stdout", job->out_tail.c_str(), job->out_tail.size());
+    if (!job->err_tail.empty())
+        PushMessage(job, "stderr", job->err_tail.c_str(), job->err_tail.size());
+
+    ExecuteResult result(-1, "", "");
+    if (!job->process.Join(&result.exit_code))
+        result.err_msg = "Failed to manage subprocess.";
+    result.stats = job->process.GetStats();
+    result.timed_out = job->process.TimedOut();
+    WriteHistory(*job->sub_definition, job->cmd, result);
+    if (!result.err_msg.empty()) {
+        FailJob(job, result.err_msg);
+        return;
+    }
+
+    PushResult(job, result.exit_code, result.stats.wall_time_us / 1000.0, result.timed_out);
+}
+
+// Returns false when the client is gone.
+static bool WriteResponse(ServeJob* job) noexcept {
+    if (job->response.empty())
+        return true;
+    ssize_t size = write(job->fd, job->response.c_str(), job->response.size());
+    if (size < 0)
+        return errno == EAGAIN || errno == EINTR;
+    job->response = noex::string(job->response.c_str() + size,
+                                 job->response.size() - static_cast<size_t>(size));
+    return true;
+}
+
+static int OpenSocket(const char* socket_path, noex::string* err) noexcept {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        *err = noex::concat_cstr("Socket path is too long. (", socket_path, ")");
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        *err = "Failed to create a socket.";
+        return -1;
+    }
+    // Remove the socket file only when nobody uses it.
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0) {
+        close(fd);
+        *err = noex::concat_cstr("Another server is running. (", socket_path, ")");
+        return -1;
+    }
+    close(fd);
+    unlink(socket_path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    // Allow only the current user to connect.
+    mode_t old_mask = umask(077);
+    bool ok = fd >= 0 &&
+              bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 &&
+              listen(fd, 64) == 0;
+    umask(old_mask);
+    if (!ok) {
+        if (fd >= 0)
+            close(fd);
+        *err = noex::concat_cstr("Failed to listen on the socket. (", socket_path, ")");
+        return -1;
+    }
+    SetNonBlocking(fd);
+    return fd;
+}
+
+noex::string Serve(const tuwjson::Value& definition,
+                   const char* socket_path, int max_parallel) noexcept {
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    noex::string err;
+    int listen_fd = OpenSocket(socket_path, &err);
+    if (listen_fd < 0)
+        return err;
+    PrintFmt("[Serve] Listening on %s\n", socket_path);
+
+    noex::vector<ServeJob*> jobs;
+    noex::vector<struct pollfd> fds;
+    while (!g_stop) {
+        // Start queued jobs in order.
+        int running = 0;
+        for (ServeJob* job : jobs) {
+            if (job->state == SERVE_JOB_RUNNING)
+                running++;
+        }
+        for (ServeJob* job : jobs) {
+            if (running >= max_parallel)
+                break;
+            if (job->state == SERVE_JOB_QUEUED) {
+                StartJob(job);
+                if (job->state == SERVE_JOB_RUNNING)
+                    running++;
+            }
+        }
+
+        fds.clear();
+        struct pollfd pfd = { listen_fd, POLLIN, 0 };
+        fds.push_back(pfd);
+        for (ServeJob* job : jobs) {
+            pfd.fd = job->fd;
+            pfd.events = job->state == SERVE_JOB_READING ? POLLIN : 0;
+            if (!job->response.empty())
+                pfd.events |= POLLOUT;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+        }
+        // ChildProcess doesn't expose its pipes. Check outputs every 10ms while running.
+        int timeout = running > 0 ? 10 : -1;
+        if (poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout) < 0 && errno != EINTR)
+            break;
+
+        if (fds[0].revents & POLLIN) {
+            int client_fd = accept(listen_fd, nullptr, nullptr);
+            if (client_fd >= 0) {
+                SetNonBlocking(client_fd);
+                ServeJob* job = noex::new_ref<ServeJob>(noex::ALLOC_OTHER, client_fd);
+                if (job)
+                    jobs.push_back(job);
+                else
+                    close(client_fd);
+            }
+        }
+
+        // Remove finished jobs in place.
+        size_t alive_count = 0;
+        for (size_t i = 0; i < jobs.size(); i++) {
+            ServeJob* job = jobs[i];
+            // New jobs don't have pollfd yet.
+            short revents = i + 1 < fds.size() ? fds[i + 1].revents : 0;
+            bool closed = false;
+            if (job->state == SERVE_JOB_READING && (revents & POLLIN))
+                ReadRequest(definition, job);
+            if (job->state == SERVE_JOB_RUNNING)
+                UpdateJob(job);
+            // POLLHUP is always reported. Polling the fd again would return immediately.
+            if (revents & (POLLERR | POLLHUP | POLLNVAL))
+                closed = true;
+            else if (revents & POLLOUT)
+                closed = !WriteResponse(job);
+            if (job->state == SERVE_JOB_CLOSING && job->response.empty())
+                closed = true;
+
+            if (closed) {
+                if (job->state == SERVE_JOB_RUNNING) {
+                    // The client is gone.
+                    int exit_code;
+                    job->process.Terminate();
+                    job->process.Join(&exit_code);
+                }
+                noex::del_ref(job);
+            } else {
+                jobs[alive_count] = job;
+                alive_count++;
+            }
+        }
+        while (jobs.size() > alive_count)
+            jobs.pop_back();
+    }
+
+    for (ServeJob* job : jobs) {
+        int exit_code;
+        job->process.Terminate();
+        job->process.Join(&exit_code);
+        noex::del_ref(job);
+    }
+    close(listen_fd);
+    unlink(socket_path);
+    PrintFmt("[Serve] Stopped.\n");
+    return "";
+}
+
+#endif  // _WIN32
@@ -44,6 +44,122 @@ uint32_t Fnv1Hash32(const char* str) noexcept {
     return hash;
 }
 
+static const uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t RotL64(uint64_t x, int r) noexcept {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Reads little-endian integers.
+static inline uint64_t ReadLE64(const unsigned char* p) noexcept {
+    uint64_t x;
+    memcpy(&x, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+static inline uint32_t ReadLE32(const unsigned char* p) noexcept {
+    uint32_t x;
+    memcpy(&x, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap32(x);
+#endif
+    return x;
+}
+
+static inline uint64_t XxhRound(uint64_t acc, uint64_t input) noexcept {
+    acc += input * XXH_PRIME64_2;
+    return RotL64(acc, 31) * XXH_PRIME64_1;
+}
+
+static inline uint64_t XxhMergeRound(uint64_t acc, uint64_t val) noexcept {
+    acc ^= XxhRound(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// Consumes 32-byte stripes.
+static const unsigned char* XxhStripes(uint64_t* acc, const unsigned char* p,
+                                       const unsigned char* end) noexcept {
+    while (end - p >= 32) {
+        acc[0] = XxhRound(acc[0], ReadLE64(p));
+        acc[1] = XxhRound(acc[1], ReadLE64(p + 8));
+        acc[2] = XxhRound(acc[2], ReadLE64(p + 16));
+        acc[3] = XxhRound(acc[3], ReadLE64(p + 24));
+        p += 32;
+    }
+    return p;
+}
+
+XxHash64::XxHash64() noexcept : m_total_size(0), m_buf_size(0) {
+    m_acc[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+    m_acc[1] = XXH_PRIME64_2;
+    m_acc[2] = 0;
+    m_acc[3] = 0 - XXH_PRIME64_1;
+}
+
+void XxHash64::Update(const void* data, size_t size) noexcept {
+    if (size == 0)
+        return;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    m_total_size += size;
+
+    // Fill the buffer with the rest of the previous chunk.
+    if (m_buf_size > 0) {
+        size_t copy_size = 32 - m_buf_size;
+        if (size < copy_size) {
+            memcpy(m_buf + m_buf_size, p, size);
+            m_buf_size += size;
+            return;
+        }
+        memcpy(m_buf + m_buf_size, p, copy_size);
+        XxhStripes(m_acc, m_buf, m_buf + 32);
+        p += copy_size;
+        m_buf_size = 0;
+    }
+
+    p = XxhStripes(m_acc, p, end);
+    m_buf_size = static_cast<size_t>(end - p);
+    memcpy(m_buf, p, m_buf_size);
+}
+
+uint64_t XxHash64::Digest() const noexcept {
+    uint64_t h;
+    if (m_total_size >= 32) {
+        h = RotL64(m_acc[0], 1) + RotL64(m_acc[1], 7) +
+            RotL64(m_acc[2], 12) + RotL64(m_acc[3], 18);
+        for (int i = 0; i < 4; i++)
+            h = XxhMergeRound(h, m_acc[i]);
+    } else {
+        h = XXH_PRIME64_5;
+    }
+    h += m_total_size;
+
+    const unsigned char* p = m_buf;
+    const unsigned char* end = m_buf + m_buf_size;
+    for (; end - p >= 8; p += 8)
+        h = RotL64(h ^ XxhRound(0, ReadLE64(p)), 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    if (end - p >= 4) {
+        h = RotL64(h ^ (ReadLE32(p) * XXH_PRIME64_1), 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++)
+        h = RotL64(h ^ (*p * XXH_PRIME64_5), 11) * XXH_PRIME64_1;
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
 #ifdef _WIN32
 noex::string UTF16toUTF8(const wchar_t* str) noexcept {
     char* uchar = toUTF8(str);
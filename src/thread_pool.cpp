@@ -0,0 +1,96 @@
+#include "thread_pool.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "noex/vector.hpp"
+
+// Tasks can have large buffers on the stack. (e.g. JSON_SIZE_MAX)
+// Note: macOS uses 512KB for threads by default.
+#define TASK_STACK_SIZE (4 * 1024 * 1024)
+
+struct TaskPool {
+    TaskFunc func;
+    size_t count;
+    void* data;
+#ifdef _WIN32
+    volatile LONG next;
+#else
+    size_t next;
+#endif
+};
+
+static size_t TakeTask(TaskPool* pool) noexcept {
+#ifdef _WIN32
+    return static_cast<size_t>(InterlockedIncrement(&pool->next) - 1);
+#else
+    return __atomic_fetch_add(&pool->next, static_cast<size_t>(1), __ATOMIC_RELAXED);
+#endif
+}
+
+static void RunPool(TaskPool* pool) noexcept {
+    for (size_t id = TakeTask(pool); id < pool->count; id = TakeTask(pool))
+        pool->func(id, pool->data);
+}
+
+#ifdef _WIN32
+typedef HANDLE Thread;
+
+static DWORD WINAPI ThreadMain(LPVOID pool) {
+    RunPool(static_cast<TaskPool*>(pool));
+    return 0;
+}
+
+static bool StartThread(Thread* thread, TaskPool* pool) noexcept {
+    *thread = CreateThread(nullptr, TASK_STACK_SIZE, ThreadMain, pool,
+                           STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr);
+    return *thread != nullptr;
+}
+
+static void JoinThread(Thread thread) noexcept {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+typedef pthread_t Thread;
+
+static void* ThreadMain(void* pool) {
+    RunPool(static_cast<TaskPool*>(pool));
+    return nullptr;
+}
+
+static bool StartThread(Thread* thread, TaskPool* pool) noexcept {
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr) != 0)
+        return false;
+    pthread_attr_setstacksize(&attr, TASK_STACK_SIZE);
+    bool ok = pthread_create(thread, &attr, ThreadMain, pool) == 0;
+    pthread_attr_destroy(&attr);
+    return ok;
+}
+
+static void JoinThread(Thread thread) noexcept {
+    pthread_join(thread, nullptr);
+}
+#endif
+
+void RunTasks(TaskFunc func, size_t count, int max_threads, void* data) noexcept {
+    TaskPool pool = { func, count, data, 0 };
+    // The calling thread is one of the workers.
+    size_t thread_count = max_threads > 1 ? static_cast<size_t>(max_threads - 1) : 0;
+    if (thread_count > count)
+        thread_count = count > 0 ? count - 1 : 0;
+
+    noex::vector<Thread> threads;
+    for (size_t i = 0; i < thread_count; i++) {
+        Thread thread;
+        // Run tasks with fewer threads when it fails.
+        if (!StartThread(&thread, &pool))
+            break;
+        threads.push_back(thread);
+    }
+    RunPool(&pool);
+    for (Thread thread : threads)
+        JoinThread(thread);
+}
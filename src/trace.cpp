@@ -0,0 +1,179 @@
+#include "trace.h"
+
+#ifndef TUW_NO_TRACE
+#include <errno.h>
+#include <inttypes.h>
+#include <cstdio>
+#include <cstdlib>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "json_utils.h"
+#include "process.h"
+
+// Max number of events for each thread
+#define TRACE_BUFFER_EVENTS 8192
+
+struct TraceEvent {
+    const char* name;
+    uint64_t begin_us;
+    uint64_t dur_us;
+};
+
+// Buffers are never freed. Threads can record events until the process exits.
+struct TraceBuffer {
+    TraceBuffer* next;
+    uint32_t tid;
+    // Number of recorded events. It can exceed the max to count dropped events.
+    // Only the owner thread writes events and updates the size.
+    uint32_t size;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+};
+
+bool g_trace_enabled = false;
+static FILE* g_trace_file = nullptr;
+static noex::string g_trace_path;
+static uint64_t g_trace_start_us = 0;
+static TraceBuffer* g_trace_buffers = nullptr;
+static uint32_t g_trace_tid_count = 0;
+static thread_local TraceBuffer* t_trace_buffer = nullptr;
+
+#ifdef _WIN32
+static uint32_t NewTid() noexcept {
+    return static_cast<uint32_t>(
+        InterlockedIncrement(reinterpret_cast<volatile LONG*>(&g_trace_tid_count)));
+}
+
+static void PushBuffer(TraceBuffer* buf) noexcept {
+    void* head;
+    do {
+        head = g_trace_buffers;
+        buf->next = static_cast<TraceBuffer*>(head);
+    } while (InterlockedCompareExchangePointer(
+                reinterpret_cast<void* volatile*>(&g_trace_buffers), buf, head) != head);
+}
+
+static void SetEnabled(bool enabled) noexcept {
+    *static_cast<volatile bool*>(&g_trace_enabled) = enabled;
+}
+
+static TraceBuffer* LoadBuffers() noexcept {
+    MemoryBarrier();
+    return g_trace_buffers;
+}
+
+static void StoreSize(TraceBuffer* buf, uint32_t size) noexcept {
+    MemoryBarrier();
+    *static_cast<volatile uint32_t*>(&buf->size) = size;
+}
+
+static uint32_t LoadSize(TraceBuffer* buf) noexcept {
+    uint32_t size = *static_cast<volatile uint32_t*>(&buf->size);
+    MemoryBarrier();
+    return size;
+}
+#else
+static uint32_t NewTid() noexcept {
+    return __atomic_add_fetch(&g_trace_tid_count, 1, __ATOMIC_RELAXED);
+}
+
+static void PushBuffer(TraceBuffer* buf) noexcept {
+    buf->next = __atomic_load_n(&g_trace_buffers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&g_trace_buffers, &buf->next, buf, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+}
+
+static void SetEnabled(bool enabled) noexcept {
+    __atomic_store_n(&g_trace_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+static TraceBuffer* LoadBuffers() noexcept {
+    return __atomic_load_n(&g_trace_buffers, __ATOMIC_ACQUIRE);
+}
+
+static void StoreSize(TraceBuffer* buf, uint32_t size) noexcept {
+    __atomic_store_n(&buf->size, size, __ATOMIC_RELEASE);
+}
+
+static uint32_t LoadSize(TraceBuffer* buf) noexcept {
+    return __atomic_load_n(&buf->size, __ATOMIC_ACQUIRE);
+}
+#endif
+
+uint64_t TraceNowUs() noexcept {
+    return GetMonotonicTimeUs();
+}
+
+noex::string TraceStart(const char* path) noexcept {
+    if (g_trace_file)
+        return "Tracing has already started.";
+    errno = 0;
+    g_trace_file = FileOpen(path, FILE_MODE_WRITE);
+    if (!g_trace_file)
+        return GetFileError(path);
+    g_trace_path = path;
+    g_trace_start_us = TraceNowUs();
+    SetEnabled(true);
+    return "";
+}
+
+void TraceRecord(const char* name, uint64_t begin_us, uint64_t end_us) noexcept {
+    TraceBuffer* buf = t_trace_buffer;
+    if (!buf) {
+        buf = static_cast<TraceBuffer*>(calloc(1, sizeof(TraceBuffer)));
+        if (!buf)
+            return;
+        buf->tid = NewTid();
+        PushBuffer(buf);
+        t_trace_buffer = buf;
+    }
+    if (buf->size < TRACE_BUFFER_EVENTS) {
+        TraceEvent& event = buf->events[buf->size];
+        event.name = name;
+        event.begin_us = begin_us;
+        event.dur_us = end_us - begin_us;
+    }
+    StoreSize(buf, buf->size + 1);
+}
+
+noex::string TraceStop() noexcept {
+    if (!g_trace_file)
+        return "";
+    SetEnabled(false);
+    FILE* out = g_trace_file;
+    g_trace_file = nullptr;
+
+    uint32_t dropped = 0;
+    fputs("{\"traceEvents\":[\n", out);
+    bool first = true;
+    for (TraceBuffer* buf = LoadBuffers(); buf; buf = buf->next) {
+        uint32_t size = LoadSize(buf);
+        if (size > TRACE_BUFFER_EVENTS) {
+            dropped += size - TRACE_BUFFER_EVENTS;
+            size = TRACE_BUFFER_EVENTS;
+        }
+        for (uint32_t i = 0; i < size; i++) {
+            const TraceEvent& event = buf->events[i];
+            // Skip events of the previous session.
+            if (event.begin_us < g_trace_start_us)
+                continue;
+            uint64_t ts = event.begin_us - g_trace_start_us;
+            // Names are string literals. They don't need escaping.
+            fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                    "\"ts\":%" PRIu64 ",\"dur\":%" PRIu64 "}",
+                    first ? "" : ",\n", event.name, buf->tid, ts, event.dur_us);
+            first = false;
+        }
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", out);
+    bool failed = ferror(out) != 0;
+    failed = fclose(out) != 0 || failed;
+    if (failed)
+        return "Failed to write " + g_trace_path;
+    if (dropped > 0)
+        return noex::concat_cstr("Dropped ", noex::to_string(dropped).c_str(),
+                                 " trace events. (buffers are full)");
+    return "";
+}
+
+#endif  // TUW_NO_TRACE
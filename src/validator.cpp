@@ -18,7 +18,7 @@ void Validator::Initialize(const tuwjson::Value& j) noexcept {
     m_error_msg = "";
 }
 
-static int IsUnsupportedPattern(const char *pattern) noexcept {
+int IsUnsupportedPattern(const char *pattern) noexcept {
     // () operators are unsupported in tiny-regex-c
     // https://github.com/matyalatte/tiny-str-match?tab=readme-ov-file#supported-regex-operators
     const char* p = pattern;
@@ -0,0 +1,376 @@
+#ifdef TUW_USE_ZYGOTE
+#include "zygote.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include "process.h"
+
+static int g_zygote_sock = -1;
+
+struct ZygoteRequest {
+    uint32_t options;
+    uint32_t size;  // Size of "cwd\0arg0\0arg1\0..."
+};
+
+#define ZYGOTE_FD_MAX 4
+
+static bool ReadAll(int fd, void* buf, size_t size) noexcept {
+    char* ptr = static_cast<char*>(buf);
+    while (size > 0) {
+        ssize_t ret = read(fd, ptr, size);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        ptr += ret;
+        size -= static_cast<size_t>(ret);
+    }
+    return true;
+}
+
+static bool WriteAll(int fd, const void* buf, size_t size) noexcept {
+    const char* ptr = static_cast<const char*>(buf);
+    while (size > 0) {
+        ssize_t ret = write(fd, ptr, size);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        ptr += ret;
+        size -= static_cast<size_t>(ret);
+    }
+    return true;
+}
+
+static void CloseFd(int* fd) noexcept {
+    if (*fd < 0)
+        return;
+    close(*fd);
+    *fd = -1;
+}
+
+static bool OpenPipe(int fds[2]) noexcept {
+    if (pipe(fds) != 0)
+        return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+}
+
+// Runs in the monitor process. Never returns.
+static void RunMonitor(char** argv, const char* cwd, int options,
+                       int out_fd, int err_fd, int in_fd, int status_fd) noexcept {
+    signal(SIGCHLD, SIG_DFL);
+    ZygoteReport report;
+    memset(&report, 0, sizeof(report));
+    report.status = -1;
+    report.pid = fork();
+    if (report.pid == 0) {
+        // Child process
+        signal(SIGPIPE, SIG_DFL);
+        if (options & PROCESS_NEW_GROUP)
+            setpgid(0, 0);
+        if (options & PROCESS_REDIRECT_OUTPUT) {
+            dup2(out_fd, STDOUT_FILENO);
+            dup2(err_fd, STDERR_FILENO);
+        }
+        if (options & PROCESS_PIPE_STDIN) {
+            dup2(in_fd, STDIN_FILENO);
+        } else if (options & PROCESS_REDIRECT_OUTPUT) {
+            int null_fd = open("/dev/null", O_RDONLY);
+            if (null_fd >= 0)
+                dup2(null_fd, STDIN_FILENO);
+        }
+        if (chdir(cwd) == 0)
+            execvp(argv[0], argv);
+        _exit(127);
+    }
+    // Set it in both processes. The GUI might send signals to the group before the child runs.
+    if (report.pid > 0 && (options & PROCESS_NEW_GROUP))
+        setpgid(report.pid, report.pid);
+    CloseFd(&out_fd);
+    CloseFd(&err_fd);
+    CloseFd(&in_fd);
+    WriteAll(status_fd, &report, sizeof(report));
+    if (report.pid < 0)
+        _exit(1);
+
+    pid_t ret;
+    do {
+#ifdef __HAIKU__
+        ret = waitpid(report.pid, &report.status, 0);
+#else
+        ret = wait4(report.pid, &report.status, 0, &report.usage);
+#endif
+    } while (ret < 0 && errno == EINTR);
+    if (ret != report.pid)
+        _exit(1);
+    WriteAll(status_fd, &report, sizeof(report));
+    _exit(0);
+}
+
+static bool SendFds(int sock, const int* fds, int fd_count) noexcept {
+    char payload = 0;
+    struct iovec iov;
+    iov.iov_base = &payload;
+    iov.iov_len = 1;
+
+    char control[CMSG_SPACE(sizeof(int) * ZYGOTE_FD_MAX)];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fd_count);
+
+    ssize_t ret;
+    do {
+        ret = sendmsg(sock, &msg, 0);
+    } while (ret < 0 && errno == EINTR);
+    return ret == 1;
+}
+
+// Returns 1 on success, 0 if the zygote failed to spawn, or -1 if the zygote is dead.
+static int RecvFds(int sock, int* fds, int fd_count) noexcept {
+    char payload;
+    struct iovec iov;
+    iov.iov_base = &payload;
+    iov.iov_len = 1;
+
+    char control[CMSG_SPACE(sizeof(int) * ZYGOTE_FD_MAX)];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+
+    ssize_t ret;
+    do {
+        ret = recvmsg(sock, &msg, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret != 1)
+        return -1;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+            cmsg->cmsg_len != CMSG_LEN(sizeof(int) * fd_count))
+        return 0;
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * fd_count);
+    for (int i = 0; i < fd_count; i++)
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    return 1;
+}
+
+static int GetFdCount(int options) noexcept {
+    int count = 1;  // status
+    if (options & PROCESS_REDIRECT_OUTPUT)
+        count += 2;
+    if (options & PROCESS_PIPE_STDIN)
+        count++;
+    return count;
+}
+
+// Handles a spawn request. Returns false when the GUI process is closed.
+static bool HandleRequest(int sock) noexcept {
+    ZygoteRequest req;
+    if (!ReadAll(sock, &req, sizeof(req)))
+        return false;
+    char* buf = static_cast<char*>(malloc(req.size + 1));
+    if (!buf || !ReadAll(sock, buf, req.size)) {
+        free(buf);
+        return false;
+    }
+    buf[req.size] = 0;
+
+    // Parse "cwd\0arg0\0arg1\0..."
+    // Reject too many arguments. Dropping some of them would run another command.
+    char* argv[ZYGOTE_ARGC_MAX + 1];
+    int argc = 0;
+    const char* cwd = buf;
+    char* ptr = buf + strlen(buf) + 1;
+    while (ptr < buf + req.size && argc <= ZYGOTE_ARGC_MAX) {
+        if (argc < ZYGOTE_ARGC_MAX)
+            argv[argc] = ptr;
+        argc++;
+        ptr += strlen(ptr) + 1;
+    }
+    if (argc > ZYGOTE_ARGC_MAX)
+        argc = 0;
+    argv[argc] = nullptr;
+
+    int options = static_cast<int>(req.options);
+    int out_pipe[2] = { -1, -1 };
+    int err_pipe[2] = { -1, -1 };
+    int in_pipe[2] = { -1, -1 };
+    int status_pipe[2] = { -1, -1 };
+    bool ok = argc > 0 && OpenPipe(status_pipe);
+    if (ok && (options & PROCESS_REDIRECT_OUTPUT))
+        ok = OpenPipe(out_pipe) && OpenPipe(err_pipe);
+    if (ok && (options & PROCESS_PIPE_STDIN))
+        ok = OpenPipe(in_pipe);
+
+    pid_t monitor = ok ? fork() : -1;
+    if (monitor == 0) {
+        // Close the ends for the GUI. Or the child never gets EOF from stdin.
+        CloseFd(&out_pipe[0]);
+        CloseFd(&err_pipe[0]);
+        CloseFd(&in_pipe[1]);
+        CloseFd(&status_pipe[0]);
+        close(sock);
+        RunMonitor(argv, cwd, options, out_pipe[1], err_pipe[1], in_pipe[0], status_pipe[1]);
+    }
+    free(buf);
+    CloseFd(&out_pipe[1]);
+    CloseFd(&err_pipe[1]);
+    CloseFd(&in_pipe[0]);
+    CloseFd(&status_pipe[1]);
+
+    // Send the ends for the GUI. Send no fds on failure.
+    int fds[ZYGOTE_FD_MAX];
+    int fd_count = 0;
+    if (monitor > 0) {
+        fds[fd_count++] = status_pipe[0];
+        if (options & PROCESS_REDIRECT_OUTPUT) {
+            fds[fd_count++] = out_pipe[0];
+            fds[fd_count++] = err_pipe[0];
+        }
+        if (options & PROCESS_PIPE_STDIN)
+            fds[fd_count++] = in_pipe[1];
+    }
+    bool sent;
+    if (fd_count > 0) {
+        sent = SendFds(sock, fds, fd_count);
+    } else {
+        char payload = 1;
+        sent = WriteAll(sock, &payload, 1);
+    }
+    CloseFd(&out_pipe[0]);
+    CloseFd(&err_pipe[0]);
+    CloseFd(&in_pipe[1]);
+    CloseFd(&status_pipe[0]);
+    return sent;
+}
+
+bool ZygoteStart() noexcept {
+    if (g_zygote_sock >= 0)
+        return true;
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+        return false;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // Zygote process
+        close(sv[0]);
+        signal(SIGCHLD, SIG_IGN);  // Reap monitors automatically
+        signal(SIGPIPE, SIG_IGN);
+        while (HandleRequest(sv[1])) {}
+        _exit(0);
+    }
+    close(sv[1]);
+    fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+    g_zygote_sock = sv[0];
+    return true;
+}
+
+bool ZygoteIsRunning() noexcept {
+    return g_zygote_sock >= 0;
+}
+
+static void StopZygote() noexcept {
+    // The zygote exits when the socket is closed.
+    CloseFd(&g_zygote_sock);
+}
+
+bool ZygoteSpawn(const char* const* argv, int options, ZygoteChild* child) noexcept {
+    child->pid = -1;
+    child->stdout_fd = -1;
+    child->stderr_fd = -1;
+    child->stdin_fd = -1;
+    child->status_fd = -1;
+
+    int argc = 0;
+    while (argv[argc])
+        argc++;
+    if (argc > ZYGOTE_ARGC_MAX)
+        return false;
+
+    char* cwd = getcwd(nullptr, 0);
+    if (!cwd)
+        return false;
+    size_t size = strlen(cwd) + 1;
+    for (const char* const* arg = argv; *arg; arg++)
+        size += strlen(*arg) + 1;
+    char* buf = static_cast<char*>(malloc(size));
+    if (!buf) {
+        free(cwd);
+        return false;
+    }
+    char* ptr = buf;
+    size_t len = strlen(cwd) + 1;
+    memcpy(ptr, cwd, len);
+    ptr += len;
+    free(cwd);
+    for (const char* const* arg = argv; *arg; arg++) {
+        len = strlen(*arg) + 1;
+        memcpy(ptr, *arg, len);
+        ptr += len;
+    }
+
+    ZygoteRequest req;
+    req.options = static_cast<uint32_t>(options);
+    req.size = static_cast<uint32_t>(size);
+    bool ok = WriteAll(g_zygote_sock, &req, sizeof(req)) &&
+              WriteAll(g_zygote_sock, buf, size);
+    free(buf);
+    if (!ok) {
+        StopZygote();
+        return false;
+    }
+
+    int fds[ZYGOTE_FD_MAX];
+    int fd_count = GetFdCount(options);
+    int ret = RecvFds(g_zygote_sock, fds, fd_count);
+    if (ret < 0)
+        StopZygote();
+    if (ret <= 0)
+        return false;
+    int i = 0;
+    child->status_fd = fds[i++];
+    if (options & PROCESS_REDIRECT_OUTPUT) {
+        child->stdout_fd = fds[i++];
+        child->stderr_fd = fds[i++];
+    }
+    if (options & PROCESS_PIPE_STDIN)
+        child->stdin_fd = fds[i++];
+
+    // Get pid of the child
+    ZygoteReport report;
+    if (!ReadAll(child->status_fd, &report, sizeof(report)) || report.pid <= 0) {
+        for (int j = 0; j < fd_count; j++)
+            close(fds[j]);
+        return false;
+    }
+    child->pid = report.pid;
+    return true;
+}
+
+#endif  // TUW_USE_ZYGOTE
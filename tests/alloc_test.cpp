@@ -0,0 +1,88 @@
+// Tests for noex/alloc.cpp
+
+#include "test_utils.h"
+#include "noex/alloc.hpp"
+#include "noex/new.hpp"
+
+static noex::AllocCounter GetCounter(noex::AllocTag tag) {
+    noex::AllocStats stats;
+    noex::get_alloc_stats(&stats);
+    return stats.tags[tag];
+}
+
+TEST(AllocTest, CountString) {
+    noex::AllocCounter before = GetCounter(noex::ALLOC_STRING);
+    {
+        noex::string str = "foo";
+        noex::AllocCounter counter = GetCounter(noex::ALLOC_STRING);
+        EXPECT_EQ(before.alloc_count + 1, counter.alloc_count);
+        EXPECT_EQ(before.alloc_bytes + 4, counter.alloc_bytes);
+        EXPECT_EQ(before.live_bytes + 4, counter.live_bytes);
+        noex::string buf(15);
+        str.clear();
+        counter = GetCounter(noex::ALLOC_STRING);
+        EXPECT_EQ(before.alloc_count + 2, counter.alloc_count);
+        EXPECT_EQ(before.free_count + 1, counter.free_count);
+        EXPECT_EQ(before.live_bytes + 16, counter.live_bytes);
+    }
+    noex::AllocCounter after = GetCounter(noex::ALLOC_STRING);
+    EXPECT_EQ(before.free_count + 2, after.free_count);
+    EXPECT_EQ(before.live_bytes, after.live_bytes);
+}
+
+TEST(AllocTest, CountVector) {
+    noex::AllocCounter before = GetCounter(noex::ALLOC_VECTOR);
+    {
+        noex::vector<int> vec;
+        vec.reserve(4);
+        noex::vector<noex::string> strs;
+        strs.reserve(2);
+        noex::AllocCounter counter = GetCounter(noex::ALLOC_VECTOR);
+        EXPECT_EQ(before.alloc_count + 2, counter.alloc_count);
+        EXPECT_EQ(before.live_bytes + sizeof(int) * 4 + sizeof(noex::string) * 2,
+                  counter.live_bytes);
+    }
+    noex::AllocCounter after = GetCounter(noex::ALLOC_VECTOR);
+    EXPECT_EQ(before.free_count + 2, after.free_count);
+    EXPECT_EQ(before.live_bytes, after.live_bytes);
+}
+
+TEST(AllocTest, NoLeakInJson) {
+    noex::AllocStats before;
+    noex::get_alloc_stats(&before);
+    {
+        tuwjson::Value json;
+        GetTestJson(json);
+        noex::AllocStats stats;
+        noex::get_alloc_stats(&stats);
+        EXPECT_LT(before.tags[noex::ALLOC_JSON].live_bytes,
+                  stats.tags[noex::ALLOC_JSON].live_bytes);
+        EXPECT_LE(stats.total.live_bytes, stats.peak_live_bytes);
+    }
+    noex::AllocStats after;
+    noex::get_alloc_stats(&after);
+    for (int i = 0; i < noex::ALLOC_TAG_MAX; i++)
+        EXPECT_EQ(before.tags[i].live_bytes, after.tags[i].live_bytes);
+    EXPECT_EQ(before.total.live_bytes, after.total.live_bytes);
+}
+
+TEST(AllocTest, NewArray) {
+    noex::AllocCounter before = GetCounter(noex::ALLOC_OTHER);
+    noex::string* arr = noex::new_array<noex::string>(3);
+    ASSERT_NE(nullptr, arr);
+    noex::AllocCounter counter = GetCounter(noex::ALLOC_OTHER);
+    EXPECT_EQ(before.alloc_count + 1, counter.alloc_count);
+    EXPECT_EQ(before.live_bytes + sizeof(noex::string) * 3, counter.live_bytes);
+    EXPECT_TRUE(arr[2].empty());
+    arr[2] = "foo";
+    noex::del_array(arr, 3);
+    noex::AllocCounter after = GetCounter(noex::ALLOC_OTHER);
+    EXPECT_EQ(before.free_count + 1, after.free_count);
+    EXPECT_EQ(before.live_bytes, after.live_bytes);
+}
+
+TEST(AllocTest, TagName) {
+    EXPECT_STREQ("string", noex::get_alloc_tag_name(noex::ALLOC_STRING));
+    EXPECT_STREQ("component", noex::get_alloc_tag_name(noex::ALLOC_COMPONENT));
+    EXPECT_STREQ("unknown", noex::get_alloc_tag_name(noex::ALLOC_TAG_MAX));
+}
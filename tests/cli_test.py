@@ -1,5 +1,6 @@
 """Tests for command-line features of Tuw"""
 import os
+import json
 import subprocess
 import difflib
 
@@ -51,3 +52,64 @@ if __name__ == "__main__":
     if json2[-1][-1] != "\n":
         json2[-1] += "\n"
     compare_text(json1, json2)
+
+    # Test merge and split with a compressed JSON.
+    run_command(f"..{sep}Tuw{ext} merge -j {json_path} -e Tuw.new{ext} -f -z")
+    run_command(f".{sep}Tuw.new{ext} split -j {json_out_path} -e Tuw.orig{ext} -f")
+    json2 = load_text(json_out_path)
+    if json2[-1][-1] != "\n":
+        json2[-1] += "\n"
+    compare_text(json1, json2)
+
+    # Test merge and split with a resource.
+    run_command(f"..{sep}Tuw{ext} merge -j {json_path} -e Tuw.new{ext} -f -r help.json={json_path}")
+    result = run_command(f".{sep}Tuw.new{ext} split -j {json_out_path} -e Tuw.orig{ext} -f")
+    if "Removing embedded resources... (1 files)" not in result.stdout:
+        raise RuntimeError(f"Failed to embed a resource.\n{result.stdout}")
+    json2 = load_text(json_out_path)
+    if json2[-1][-1] != "\n":
+        json2[-1] += "\n"
+    compare_text(json1, json2)
+
+    # Test batch merge. Failed items should not stop the others.
+    with open("manifest.json", "w", encoding="utf-8") as f:
+        f.write('{"items": [{"json": "json/help.json", "exe": "Tuw.b1' + ext + '"},'
+                ' {"json": "json/missing.json", "exe": "Tuw.b2' + ext + '"}]}')
+    result = run_command(f"..{sep}Tuw{ext} merge -b manifest.json -f -p 2", should_succeed=False)
+    if result.returncode != 1 or "Failed to merge 1 of 2 JSON files." not in result.stderr:
+        raise RuntimeError(f"Unexpected result of batch merge.\n{result.stdout}\n{result.stderr}")
+    run_command(f".{sep}Tuw.b1{ext} split -j {json_out_path} -e Tuw.orig{ext} -f")
+    json2 = load_text(json_out_path)
+    if json2[-1][-1] != "\n":
+        json2[-1] += "\n"
+    compare_text(json1, json2)
+
+    # Threads should not write to the same exe.
+    with open("manifest.json", "w", encoding="utf-8") as f:
+        f.write('{"items": [{"json": "json/help.json", "exe": "Tuw.b1' + ext + '"},'
+                ' {"json": "json/help.json", "exe": "Tuw.b1' + ext + '"}]}')
+    result = run_command(f"..{sep}Tuw{ext} merge -b manifest.json -f -p 2", should_succeed=False)
+    if result.returncode != 1 or "Duplicated \"exe\" in the manifest" not in result.stderr:
+        raise RuntimeError(f"Batch merge should reject duplicated exe.\n{result.stderr}")
+
+    # Test if run command returns the exit code of the command.
+    result = run_command(f"..{sep}Tuw{ext} run -j json{sep}run.json -s code=3", should_succeed=False)
+    if result.returncode != 3 or "code: 3" not in result.stdout:
+        raise RuntimeError(f"Unexpected result of run command.\n{result.stdout}\n{result.stderr}")
+    # stderr of the command is not an error of Tuw.
+    result = run_command(f"..{sep}Tuw{ext} run -j json{sep}run.json -m 1 -s code=4", should_succeed=False)
+    if result.returncode != 4 or "error: 4" not in result.stderr or "Error:" in result.stderr:
+        raise RuntimeError(f"Unexpected result of run command.\n{result.stdout}\n{result.stderr}")
+    run_command(f"..{sep}Tuw{ext} run -j json{sep}gui_definition.json -c json{sep}config_ascii.json")
+    result = run_command(f"..{sep}Tuw{ext} run -j json{sep}run.json -s unknown=3", should_succeed=False)
+    if result.returncode != 1 or "Unknown component id" not in result.stderr:
+        raise RuntimeError(f"Run command should fail with unknown ids.\n{result.stderr}")
+    print("Succeed in running commands without GUI.")
+
+    # Test if --trace writes events in Chrome trace event format.
+    run_command(f"..{sep}Tuw{ext} run -j json{sep}gui_definition.json -c json{sep}config_ascii.json --trace trace.json")
+    with open("trace.json", "r", encoding="utf-8") as f:
+        events = json.load(f)["traceEvents"]
+    if not any(event["name"] == "Execute" for event in events):
+        raise RuntimeError(f"Failed to trace the command.\n{events}")
+    print("Succeed in tracing a command.")
@@ -0,0 +1,421 @@
+// Tests for command.cpp
+
+#include "test_utils.h"
+#include "command.h"
+
+static void GetCheckedTestJson(tuwjson::Value& test_json) {
+    GetTestJson(test_json);
+    noex::string err;
+    json_utils::CheckDefinition(err, test_json);
+    EXPECT_STREQ("", err.c_str());
+}
+
+TEST(CommandTest, BuildCommandWithDefaults) {
+    tuwjson::Value test_json;
+    GetCheckedTestJson(test_json);
+    tuwjson::Value config;
+    config.SetObject();
+    ConfigValues values(test_json["gui"][0], config);
+    noex::string expected = "echo file:  & echo folder:  & echo combo: value1 & echo radio: value1";
+    expected += " & echo check:  & echo check_array:  & echo textbox: ";
+    expected += " & echo int: 0 & echo float: 0.0";
+    EXPECT_STREQ(expected.c_str(), BuildCommand(test_json["gui"][0], values).c_str());
+}
+
+TEST(CommandTest, BuildCommandWithOptionalKeys) {
+    tuwjson::Value test_json;
+    GetCheckedTestJson(test_json);
+    tuwjson::Value config;
+    config.SetObject();
+    ConfigValues values(test_json["gui"][1], config);
+    noex::string expected = "echo file: \"test.txt\" & echo folder: \"testdir\"";
+    expected += " & echo combo: value3 & echo radio: value3 & echo check: flag!";
+    expected += " & echo check_array:  --f2 & echo textbox: remove this text!";
+    expected += " & echo int: 10 & echo float: 0.01";
+    EXPECT_STREQ(expected.c_str(), BuildCommand(test_json["gui"][1], values).c_str());
+}
+
+TEST(CommandTest, BuildCommandWithConfig) {
+    tuwjson::Value test_json;
+    GetCheckedTestJson(test_json);
+    tuwjson::Value config;
+    GetTestJson(config, JSON_CONFIG_ASCII);
+    ConfigValues values(test_json["gui"][0], config);
+    noex::string expected = "echo file: test.txt & echo folder: testdir";
+    expected += " & echo combo: value3 & echo radio: value3 & echo check: flag!";
+    expected += " & echo check_array: flag3 & echo textbox: remove this text!";
+    expected += " & echo int: 2 & echo float: 0.1";
+    EXPECT_STREQ(expected.c_str(), BuildCommand(test_json["gui"][0], values).c_str());
+}
+
+TEST(CommandTest, SetConfigValue) {
+    tuwjson::Value test_json;
+    GetCheckedTestJson(test_json);
+    tuwjson::Value& sub_definition = test_json["gui"][1];
+    tuwjson::Value config;
+    config.SetObject();
+    const char* id_values[] = {
+        "file=a b.txt", "combo=item1", "radio=value2", "check=false",
+        "options=item1, --f3", "text=x=y", "integer=200", "double=0.5"
+    };
+    for (const char* id_value : id_values)
+        EXPECT_STREQ("", SetConfigValue(sub_definition, config, id_value).c_str());
+    ConfigValues values(sub_definition, config);
+    noex::string expected = "echo file: \"a b.txt\" & echo folder: \"testdir\"";
+    expected += " & echo combo: value1 & echo radio: value2 & echo check: ";
+    expected += " & echo check_array:  --f1 --f3 & echo textbox: x=y";
+    expected += " & echo int: 50 & echo float: 0.50";
+    EXPECT_STREQ(expected.c_str(), BuildCommand(sub_definition, values).c_str());
+}
+
+TEST(CommandTest, SetConfigValueFail) {
+    tuwjson::Value test_json;
+    GetCheckedTestJson(test_json);
+    tuwjson::Value& sub_definition = test_json["gui"][1];
+    tuwjson::Value config;
+    config.SetObject();
+    EXPECT_STREQ("Value should be formatted as id=value. (file)",
+                 SetConfigValue(sub_definition, config, "file").c_str());
+    EXPECT_STREQ("Unknown component id. (unknown)",
+                 SetConfigValue(sub_definition, config, "unknown=1").c_str());
+    EXPECT_STREQ("Invalid value for \"combo\". (item4)",
+                 SetConfigValue(sub_definition, config, "combo=item4").c_str());
+    EXPECT_STREQ("Invalid value for \"integer\". (1.5)",
+                 SetConfigValue(sub_definition, config, "integer=1.5").c_str());
+    EXPECT_STREQ("Unknown item for \"options\". (item4)",
+                 SetConfigValue(sub_definition, config, "options=item1,item4").c_str());
+    EXPECT_TRUE(config.IsEmptyObject());
+}
+
+TEST(CommandTest, BuildCommandArgs) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][1]["shell"].SetBool(false);
+    test_json["gui"][1]["command"].SetString(
+        "echo --file=%file% \"%folder%/x\" %combo% %radio% %check%"
+        " %options% %text% %integer% %double% 100%%");
+    noex::string err;
+    json_utils::CheckDefinition(err, test_json);
+    EXPECT_STREQ("", err.c_str());
+    tuwjson::Value config;
+    config.SetObject();
+    ConfigValues values(test_json["gui"][1], config);
+    noex::vector<noex::string> args = BuildCommandArgs(test_json["gui"][1], values);
+    const char* expected[] = {
+        "echo", "--file=test.txt", "testdir/x", "value3", "value3", "flag!",
+        " --f2", "remove this text!", "10", "0.01", "100%"
+    };
+    ASSERT_EQ(sizeof(expected) / sizeof(expected[0]), args.size());
+    for (size_t i = 0; i < args.size(); i++)
+        EXPECT_STREQ(expected[i], args[i].c_str());
+}
+
+static const char* PIPELINE_JSON =
+    "{\"command_name\": \"test\", \"components\": ["
+    "{\"type\": \"text\", \"id\": \"word\", \"label\": \"Word\", \"default\": \"a b\"}],"
+    "\"pipeline\": [\"grep -v %word%\", \"sort -r\", \"head -n 1\"]}";
+
+static void CheckPipelineError(const char* json, const char* expected) {
+    tuwjson::Parser parser;
+    tuwjson::Value definition;
+    parser.ParseJson(json, &definition);
+    ASSERT_FALSE(parser.HasError());
+    noex::string err;
+    json_utils::CheckDefinition(err, definition);
+    EXPECT_STREQ(expected, err.c_str());
+}
+
+TEST(CommandTest, BuildPipeline) {
+    tuwjson::Parser parser;
+    tuwjson::Value definition;
+    parser.ParseJson(PIPELINE_JSON, &definition);
+    ASSERT_FALSE(parser.HasError());
+    noex::string err;
+    json_utils::CheckDefinition(err, definition);
+    ASSERT_STREQ("", err.c_str());
+    tuwjson::Value& sub_definition = definition["gui"][0];
+    EXPECT_STREQ("grep -v %word% | sort -r | head -n 1",
+                 sub_definition["command"].GetString());
+
+    // Checking the definition twice should not fail.
+    json_utils::CheckDefinition(err, definition);
+    ASSERT_STREQ("", err.c_str());
+
+    tuwjson::Value config;
+    config.SetObject();
+    ConfigValues values(sub_definition, config);
+    Pipeline pipeline;
+#ifdef _WIN32
+    EXPECT_FALSE(BuildPipeline(sub_definition, values, &pipeline));
+#else
+    ASSERT_TRUE(BuildPipeline(sub_definition, values, &pipeline));
+    ASSERT_EQ(3u, pipeline.GetStageCount());
+    noex::vector<noex::string> args = pipeline.GetStage(0);
+    ASSERT_EQ(3u, args.size());
+    EXPECT_STREQ("grep", args[0].c_str());
+    EXPECT_STREQ("-v", args[1].c_str());
+    EXPECT_STREQ("a b", args[2].c_str());
+    args = pipeline.GetStage(2);
+    ASSERT_EQ(3u, args.size());
+    EXPECT_STREQ("head", args[0].c_str());
+    EXPECT_STREQ("1", args[2].c_str());
+#endif
+}
+
+TEST(CommandTest, BuildPipelineFail) {
+    CheckPipelineError(
+        "{\"components\": [], \"pipeline\": [], \"command_name\": \"test\"}",
+        "\"pipeline\" should NOT be empty. (line: 1, column: 32)");
+    CheckPipelineError(
+        "{\"components\": [], \"pipeline\": [\"cat\", \" \"]}",
+        "\"pipeline\" has an empty command. (line: 1, column: 40)");
+    CheckPipelineError(
+        "{\"components\": [], \"pipeline\": [\"cat %x%\"]}",
+        "There is undefined id \"x\" in the command. (line: 1, column: 33)");
+    CheckPipelineError(
+        "{\"components\": [], \"pipeline\": [\"cat\"], \"worker\": \"x\"}",
+        "\"pipeline\" can NOT be used with \"worker\". (line: 1, column: 32)");
+    CheckPipelineError(
+        "{\"components\": [], \"pipeline\": [\"cat %__resource:../x%\"]}",
+        "Invalid resource name \"../x\" in the command. (line: 1, column: 33)");
+}
+
+TEST(CommandTest, BuildCommandWithResource) {
+    FILE* fp = FileOpen("cmd_res.txt", FILE_MODE_WRITE);
+    ASSERT_NE(nullptr, fp);
+    fwrite("res", 1, 3, fp);
+    fclose(fp);
+    {
+        tuwjson::Value test_json;
+        GetTestJson(test_json);
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(JSON_ALL_KEYS).c_str());
+        exe.SetJson(test_json);
+        EXPECT_STREQ("", exe.AddResource("res.txt", "cmd_res.txt").c_str());
+        EXPECT_STREQ("", exe.Write("cmd_res.bin").c_str());
+    }
+    SetResourceExePath("cmd_res.bin");
+
+    tuwjson::Parser parser;
+    tuwjson::Value definition;
+    parser.ParseJson(
+        "{\"gui\": [{\"components\": [],"
+        " \"command\": \"cat %__resource:res.txt% %__resource:res.txt%\"}]}",
+        &definition);
+    ASSERT_FALSE(parser.HasError());
+    noex::string err;
+    json_utils::CheckDefinition(err, definition);
+    ASSERT_STREQ("", err.c_str());
+    tuwjson::Value& sub_definition = definition["gui"][0];
+    EXPECT_EQ(1u, sub_definition["resource_names"].GetArraySize());
+
+    tuwjson::Value config;
+    config.SetObject();
+    ConfigValues values(sub_definition, config);
+    noex::string path = GetResourcePath("res.txt", &err);
+    ASSERT_STREQ("", err.c_str());
+    // Paths are quoted in shell commands.
+    noex::string quoted = "\"" + path + "\"";
+    EXPECT_STREQ(("cat " + quoted + " " + quoted).c_str(),
+                 BuildCommand(sub_definition, values, &err).c_str());
+    EXPECT_STREQ("", err.c_str());
+    SetResourceExePath("");
+}
+
+TEST(CommandTest, BuildCommandWithMissingResource) {
+    tuwjson::Parser parser;
+    tuwjson::Value definition;
+    parser.ParseJson(
+        "{\"gui\": [{\"components\": [],"
+        " \"command\": \"cat %__resource:missing.txt%\"}]}",
+        &definition);
+    ASSERT_FALSE(parser.HasError());
+    noex::string err;
+    json_utils::CheckDefinition(err, definition);
+    ASSERT_STREQ("", err.c_str());
+    tuwjson::Value config;
+    config.SetObject();
+    ConfigValues values(definition["gui"][0], config);
+    BuildCommand(definition["gui"][0], values, &err);
+    EXPECT_FALSE(err.empty());
+}
+
+TEST(CommandTest, Validate) {
+    tuwjson::Value test_json;
+    GetCheckedTestJson(test_json);
+    tuwjson::Value config;
+    config.SetObject();
+    ConfigValues values(test_json["gui"][1], config);
+    EXPECT_STREQ("PNG or JPG: PNG or JPG.", values.Validate().c_str());
+    EXPECT_STREQ("", SetConfigValue(test_json["gui"][1], config, "file=").c_str());
+    EXPECT_STREQ("PNG or JPG: Empty string...", values.Validate().c_str());
+}
+
+TEST(CommandTest, BuildStdin) {
+    tuwjson::Value test_json;
+    GetCheckedTestJson(test_json);
+    tuwjson::Value config;
+    config.SetObject();
+    ConfigValues values(test_json["gui"][1], config);
+    StdinContent input;
+    EXPECT_FALSE(BuildStdin(test_json["gui"][1], values, &input));
+
+    GetTestJson(test_json);
+    test_json["gui"][1]["stdin"].SetString("text");
+    // Components for stdin don't need to be in the command.
+    test_json["gui"][1]["command"].SetString(
+        "echo %file% %folder% %combo% %radio% %check% %options% %integer% %double%");
+    noex::string err;
+    json_utils::CheckDefinition(err, test_json);
+    EXPECT_STREQ("", err.c_str());
+    // GetTestJson() frees the components that values refers to.
+    ConfigValues text_values(test_json["gui"][1], config);
+    EXPECT_TRUE(BuildStdin(test_json["gui"][1], text_values, &input));
+    EXPECT_STREQ("remove this text!", input.str.c_str());
+    EXPECT_FALSE(input.is_file);
+
+    GetTestJson(test_json);
+    test_json["gui"][1]["stdin"].SetString("file");
+    json_utils::CheckDefinition(err, test_json);
+    EXPECT_STREQ("", err.c_str());
+    ConfigValues file_values(test_json["gui"][1], config);
+    EXPECT_TRUE(BuildStdin(test_json["gui"][1], file_values, &input));
+    EXPECT_STREQ("test.txt", input.str.c_str());
+    EXPECT_TRUE(input.is_file);
+}
+
+TEST(CommandTest, GetProcessLimits) {
+    tuwjson::Value test_json;
+    GetCheckedTestJson(test_json);
+    ProcessLimits limits;
+    EXPECT_FALSE(GetProcessLimits(test_json["gui"][1], &limits));
+
+    tuwjson::Value& sub_definition = test_json["gui"][1];
+    sub_definition["nice"].SetInt(0);
+    sub_definition["cpu_affinity"].SetArray();
+    tuwjson::Value cpu;
+    cpu.SetInt(0);
+    sub_definition["cpu_affinity"].MoveAndPush(cpu);
+    cpu.SetInt(3);
+    sub_definition["cpu_affinity"].MoveAndPush(cpu);
+    sub_definition["memory_limit_mb"].SetInt(512);
+    noex::string err;
+    json_utils::CheckDefinition(err, test_json);
+    EXPECT_STREQ("", err.c_str());
+    EXPECT_TRUE(GetProcessLimits(test_json["gui"][1], &limits));
+    EXPECT_TRUE(limits.use_nice);
+    EXPECT_EQ(0, limits.nice);
+    EXPECT_EQ(9u, limits.cpu_mask);
+    EXPECT_EQ(512, limits.memory_limit_mb);
+    EXPECT_EQ(0, limits.cpu_limit);
+}
+
+#ifndef _WIN32
+TEST(CommandTest, ExecuteWithNice) {
+    ProcessLimits limits;
+    limits.nice = 5;
+    limits.use_nice = true;
+    // Limits are applied right after spawning the shell.
+    // Wait a bit so that "nice" starts after that.
+    ExecuteResult result = Execute("sleep 0.1; nice", false, nullptr, nullptr, nullptr, &limits);
+    EXPECT_EQ(0, result.exit_code);
+    EXPECT_STREQ("5", result.last_line.c_str());
+}
+
+TEST(CommandTest, ExecuteWithTimeout) {
+    ProcessLimits limits;
+    limits.timeout_ms = 100;
+    limits.kill_grace_ms = 1000;
+    ExecuteResult result = Execute("echo start; sleep 10", false,
+                                   nullptr, nullptr, nullptr, &limits);
+    EXPECT_TRUE(result.timed_out);
+    EXPECT_STREQ("Timed out after 100ms.", result.err_msg.c_str());
+    EXPECT_STREQ("start", result.last_line.c_str());
+    EXPECT_GT(1000000u, result.stats.wall_time_us);
+}
+
+static void AddStage(Pipeline& pipeline, const char* const* argv) {
+    noex::vector<noex::string> args;
+    for (; *argv; argv++)
+        args.emplace_back(*argv);
+    pipeline.AddStage(args);
+}
+
+TEST(CommandTest, ExecutePipeline) {
+    // Larger than the pipe buffer
+    const char* seq[] = { "seq", "1", "200000", nullptr };
+    const char* tail[] = { "tail", "-n", "1", nullptr };
+    Pipeline pipeline;
+    AddStage(pipeline, seq);
+    AddStage(pipeline, tail);
+    ExecuteResult result = Execute(pipeline);
+    EXPECT_EQ(0, result.exit_code);
+    EXPECT_STREQ("200000", result.last_line.c_str());
+    ASSERT_EQ(2u, result.stages.size());
+    EXPECT_EQ(0, result.stages[0].exit_code);
+    EXPECT_EQ(0, result.stages[1].exit_code);
+}
+
+TEST(CommandTest, ExecutePipelineExitCode) {
+    // The exit code is from the last command as shell does.
+    const char* fail[] = { "sh", "-c", "exit 3", nullptr };
+    const char* cat[] = { "cat", nullptr };
+    Pipeline pipeline;
+    AddStage(pipeline, fail);
+    AddStage(pipeline, cat);
+    ExecuteResult result = Execute(pipeline);
+    EXPECT_EQ(0, result.exit_code);
+    ASSERT_EQ(2u, result.stages.size());
+    EXPECT_EQ(3, result.stages[0].exit_code);
+
+    pipeline.Clear();
+    AddStage(pipeline, cat);
+    AddStage(pipeline, fail);
+    result = Execute(pipeline);
+    EXPECT_EQ(3, result.exit_code);
+}
+
+TEST(CommandTest, ExecutePipelineWithStdin) {
+    const char* cat[] = { "cat", nullptr };
+    const char* wc[] = { "wc", "-l", nullptr };
+    Pipeline pipeline;
+    AddStage(pipeline, cat);
+    AddStage(pipeline, wc);
+    StdinContent input;
+    input.str = "a\nb\nc\n";
+    ExecuteResult result = Execute(pipeline, false, nullptr, nullptr, &input);
+    EXPECT_EQ(0, result.exit_code);
+    EXPECT_STREQ("3", result.last_line.c_str());
+}
+
+TEST(CommandTest, ExecuteWithStdinText) {
+    StdinContent input;
+    input.str = "first\nlast\n";
+    ExecuteResult result = Execute("cat", false, nullptr, nullptr, &input);
+    EXPECT_EQ(0, result.exit_code);
+    EXPECT_STREQ("last", result.last_line.c_str());
+}
+
+TEST(CommandTest, ExecuteWithStdinFile) {
+    // Larger than the pipe buffer
+    const char* path = "stdin_test.txt";
+    FILE* fp = fopen(path, "wb");
+    ASSERT_NE(nullptr, fp);
+    for (int i = 0; i < 200000; i++)
+        fprintf(fp, "line %d\n", i);
+    fclose(fp);
+
+    StdinContent input;
+    input.str = path;
+    input.is_file = true;
+    ExecuteResult result = Execute("tail -n 1", false, nullptr, nullptr, &input);
+    EXPECT_EQ(0, result.exit_code);
+    EXPECT_STREQ("line 199999", result.last_line.c_str());
+
+    input.str = "not_found.txt";
+    result = Execute("cat", false, nullptr, nullptr, &input);
+    EXPECT_EQ(-1, result.exit_code);
+    EXPECT_STREQ("Failed to open stdin: No such file or directory: not_found.txt",
+                 result.err_msg.c_str());
+}
+#endif
@@ -28,3 +28,426 @@ TEST(JsonEmbeddingTest, Embed) {
         EXPECT_EQ(embedded_json, test_json);
     }
 }
+
+TEST(JsonEmbeddingTest, EmbedLargeExe) {
+    // Larger than the old size limit (20MB)
+    const char* exe_path = "large_exe.bin";
+    FILE* fp = FileOpen(exe_path, FILE_MODE_WRITE);
+    ASSERT_NE(nullptr, fp);
+    char buf[4096] = { 'a' };
+    for (int i = 0; i < 6000; i++)
+        fwrite(buf, 1, sizeof(buf), fp);
+    fwrite(buf, 1, 3, fp);
+    fclose(fp);
+
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(exe_path).c_str());
+        EXPECT_FALSE(exe.HasJson());
+        exe.SetJson(test_json);
+        EXPECT_STREQ("", exe.Write("large_embedded.bin").c_str());
+    }
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read("large_embedded.bin").c_str());
+        tuwjson::Value embedded_json;
+        exe.GetJson(embedded_json);
+        EXPECT_EQ(embedded_json, test_json);
+
+        // Remove the json and check the exe size.
+        exe.RemoveJson();
+        EXPECT_STREQ("", exe.Write("large_removed.bin").c_str());
+    }
+    fp = FileOpen("large_removed.bin", FILE_MODE_READ);
+    ASSERT_NE(nullptr, fp);
+    fseek(fp, 0, SEEK_END);
+    EXPECT_EQ(6000 * 4096 + 3, ftell(fp));
+    fclose(fp);
+}
+
+TEST(JsonEmbeddingTest, ReadSmallFile) {
+    const char* exe_path = "small_exe.bin";
+    FILE* fp = FileOpen(exe_path, FILE_MODE_WRITE);
+    ASSERT_NE(nullptr, fp);
+    fwrite("JSON", 1, 4, fp);
+    fclose(fp);
+    ExeContainer exe;
+    EXPECT_STREQ("", exe.Read(exe_path).c_str());
+    EXPECT_FALSE(exe.HasJson());
+}
+
+TEST(JsonEmbeddingTest, OverwriteExe) {
+    // The original exe can be the output.
+    const char* exe_path = "overwritten.bin";
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(JSON_ALL_KEYS).c_str());
+        EXPECT_STREQ("", exe.Write(exe_path).c_str());
+    }
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    for (int i = 0; i < 2; i++) {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(exe_path).c_str());
+        exe.SetJson(test_json);
+        EXPECT_STREQ("", exe.Write(exe_path).c_str());
+    }
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(exe_path).c_str());
+        tuwjson::Value embedded_json;
+        exe.GetJson(embedded_json);
+        EXPECT_EQ(embedded_json, test_json);
+    }
+    EXPECT_FALSE(envuFileExists("overwritten.bin.tmp"));
+}
+
+static void WriteUint32(FILE* fp, uint32_t num) {
+    unsigned char bin[4] = {
+        static_cast<unsigned char>(num & 0xFF),
+        static_cast<unsigned char>((num >> 8) & 0xFF),
+        static_cast<unsigned char>((num >> 16) & 0xFF),
+        static_cast<unsigned char>((num >> 24) & 0xFF)
+    };
+    fwrite(bin, 1, 4, fp);
+}
+
+static noex::string ReadBinaryFile(const char* path) {
+    FILE* fp = FileOpen(path, FILE_MODE_READ);
+    if (!fp)
+        return "";
+    fseek(fp, 0, SEEK_END);
+    noex::string data(static_cast<size_t>(ftell(fp)));
+    fseek(fp, 0, SEEK_SET);
+    if (fread(data.data(), 1, data.size(), fp) != data.size())
+        data.clear();
+    fclose(fp);
+    return data;
+}
+
+// Writes a journal that restores data after the first exe_size bytes of exe.
+static void WriteJournal(const char* path, const noex::string& exe, long exe_size,
+                         const noex::string& data) {
+    uint64_t hash = XxHash64::Hash(exe.data(), static_cast<size_t>(exe_size));
+    FILE* fp = FileOpen(path, FILE_MODE_WRITE);
+    ASSERT_NE(nullptr, fp);
+    WriteUint32(fp, 0x4A534F4E);
+    WriteUint32(fp, static_cast<uint32_t>(exe_size));
+    WriteUint32(fp, 0);
+    WriteUint32(fp, static_cast<uint32_t>(data.size()));
+    WriteUint32(fp, static_cast<uint32_t>(hash & 0xFFFFFFFF));
+    WriteUint32(fp, static_cast<uint32_t>(hash >> 32));
+    fwrite(data.data(), 1, data.size(), fp);
+    WriteUint32(fp, 0x4A534F4E);
+    fclose(fp);
+}
+
+TEST(JsonEmbeddingTest, RecoverFromJournal) {
+    // Make an exe with json, and get its embedded data.
+    const char* exe_path = "journal_test.bin";
+    long exe_size;
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(JSON_ALL_KEYS).c_str());
+        EXPECT_STREQ("", exe.Write(exe_path).c_str());
+        FILE* fp = FileOpen(exe_path, FILE_MODE_READ);
+        ASSERT_NE(nullptr, fp);
+        fseek(fp, 0, SEEK_END);
+        exe_size = ftell(fp);
+        fclose(fp);
+    }
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(exe_path).c_str());
+        exe.SetJson(test_json);
+        EXPECT_STREQ("", exe.Write(exe_path).c_str());
+    }
+    noex::string exe_data = ReadBinaryFile(exe_path);
+    ASSERT_LT(exe_size, static_cast<long>(exe_data.size()));
+    noex::string data(exe_data.data() + exe_size, exe_data.size() - exe_size);
+
+    // Simulate a crash while updating the exe.
+    WriteJournal("journal_test.bin.journal", exe_data, exe_size, data);
+    FILE* fp = FileOpen(exe_path, FILE_MODE_UPDATE);
+    ASSERT_NE(nullptr, fp);
+    fseek(fp, exe_size + 32, SEEK_SET);
+    fwrite("broken", 1, 6, fp);
+    fclose(fp);
+
+    ExeContainer exe;
+    EXPECT_STREQ("", exe.Read(exe_path).c_str());
+    tuwjson::Value embedded_json;
+    exe.GetJson(embedded_json);
+    EXPECT_EQ(embedded_json, test_json);
+    EXPECT_FALSE(envuFileExists("journal_test.bin.journal"));
+}
+
+TEST(JsonEmbeddingTest, RemoveIncompleteJournal) {
+    const char* exe_path = "journal_test2.bin";
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(JSON_ALL_KEYS).c_str());
+        EXPECT_STREQ("", exe.Write(exe_path).c_str());
+    }
+    FILE* fp = FileOpen("journal_test2.bin.journal", FILE_MODE_WRITE);
+    ASSERT_NE(nullptr, fp);
+    WriteUint32(fp, 0x4A534F4E);
+    WriteUint32(fp, 0);
+    fclose(fp);
+
+    ExeContainer exe;
+    EXPECT_STREQ("", exe.Read(exe_path).c_str());
+    EXPECT_FALSE(exe.HasJson());
+    EXPECT_FALSE(envuFileExists("journal_test2.bin.journal"));
+}
+
+TEST(JsonEmbeddingTest, IgnoreJournalOfAnotherExe) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    const char* exe_path = "journal_test3.bin";
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(JSON_BROKEN).c_str());
+        EXPECT_STREQ("", exe.Write(exe_path).c_str());
+    }
+    noex::string exe_data = ReadBinaryFile(exe_path);
+
+    // A complete journal left by another exe that had the same path.
+    noex::string other_exe = ReadBinaryFile(JSON_ALL_KEYS);
+    ASSERT_LT(0u, other_exe.size());
+    long exe_size = static_cast<long>(other_exe.size() / 2);
+    WriteJournal("journal_test3.bin.journal", other_exe, exe_size, "JSON");
+
+    ExeContainer exe;
+    EXPECT_STREQ("", exe.Read(exe_path).c_str());
+    EXPECT_FALSE(exe.HasJson());
+    EXPECT_TRUE(exe_data == ReadBinaryFile(exe_path));
+    EXPECT_FALSE(envuFileExists("journal_test3.bin.journal"));
+}
+
+TEST(JsonEmbeddingTest, HasSameExe) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    ExeContainer exe;
+    EXPECT_STREQ("", exe.Read(JSON_ALL_KEYS).c_str());
+    exe.SetJson(test_json);
+    EXPECT_STREQ("", exe.Write("same_exe.bin").c_str());
+
+    ExeContainer base;
+    EXPECT_STREQ("", base.Read(JSON_ALL_KEYS).c_str());
+    ExeContainer merged;
+    EXPECT_STREQ("", merged.Read("same_exe.bin").c_str());
+    EXPECT_TRUE(merged.HasJson());
+    EXPECT_TRUE(merged.HasSameExe(base));
+
+    ExeContainer other;
+    EXPECT_STREQ("", other.Read(JSON_BROKEN).c_str());
+    EXPECT_FALSE(merged.HasSameExe(other));
+}
+
+TEST(JsonEmbeddingTest, HasSameExeWithDifferentMiddle) {
+    // Executables that differ only in the middle
+    char buf[4096];
+    memset(buf, 'a', sizeof(buf));
+    const char* paths[2] = { "same_size_a.bin", "same_size_b.bin" };
+    for (int i = 0; i < 2; i++) {
+        FILE* fp = FileOpen(paths[i], FILE_MODE_WRITE);
+        ASSERT_NE(nullptr, fp);
+        for (int j = 0; j < 64; j++) {
+            buf[0] = (i == 1 && j == 32) ? 'b' : 'a';
+            fwrite(buf, 1, sizeof(buf), fp);
+        }
+        fclose(fp);
+    }
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    ExeContainer exe;
+    EXPECT_STREQ("", exe.Read(paths[0]).c_str());
+    exe.SetJson(test_json);
+    EXPECT_STREQ("", exe.Write("same_size_merged.bin").c_str());
+
+    ExeContainer merged;
+    EXPECT_STREQ("", merged.Read("same_size_merged.bin").c_str());
+    ExeContainer base_a;
+    EXPECT_STREQ("", base_a.Read(paths[0]).c_str());
+    EXPECT_TRUE(merged.HasSameExe(base_a));
+    ExeContainer base_b;
+    EXPECT_STREQ("", base_b.Read(paths[1]).c_str());
+    EXPECT_FALSE(merged.HasSameExe(base_b));
+}
+
+TEST(JsonEmbeddingTest, EmbedCompressed) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    long sizes[2];
+    const char* paths[2] = { "raw.bin", "compressed.bin" };
+    for (int i = 0; i < 2; i++) {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(JSON_ALL_KEYS).c_str());
+        exe.SetJson(test_json);
+        exe.SetCompression(i == 1);
+        EXPECT_STREQ("", exe.Write(paths[i]).c_str());
+        FILE* fp = FileOpen(paths[i], FILE_MODE_READ);
+        ASSERT_NE(nullptr, fp);
+        fseek(fp, 0, SEEK_END);
+        sizes[i] = ftell(fp);
+        fclose(fp);
+    }
+    EXPECT_GT(sizes[0], sizes[1]);
+
+    ExeContainer exe;
+    EXPECT_STREQ("", exe.Read("compressed.bin").c_str());
+    tuwjson::Value embedded_json;
+    exe.GetJson(embedded_json);
+    EXPECT_EQ(embedded_json, test_json);
+
+    // Update the compressed json in place.
+    exe.SetCompression(false);
+    EXPECT_STREQ("", exe.Write("compressed.bin").c_str());
+    ExeContainer exe2;
+    EXPECT_STREQ("", exe2.Read("compressed.bin").c_str());
+    exe2.GetJson(embedded_json);
+    EXPECT_EQ(embedded_json, test_json);
+}
+
+static void WriteTextFile(const char* path, const char* text) {
+    FILE* fp = FileOpen(path, FILE_MODE_WRITE);
+    ASSERT_NE(nullptr, fp);
+    fwrite(text, 1, strlen(text), fp);
+    fclose(fp);
+}
+
+static noex::string ReadTextFile(const noex::string& path) {
+    FILE* fp = FileOpen(path.c_str(), FILE_MODE_READ);
+    if (!fp)
+        return "";
+    char buf[256];
+    size_t size = fread(buf, 1, sizeof(buf), fp);
+    fclose(fp);
+    return noex::string(buf, size);
+}
+
+TEST(JsonEmbeddingTest, EmbedResources) {
+    WriteTextFile("res_a.txt", "resource a");
+    WriteTextFile("res_b.txt", "b");
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(JSON_ALL_KEYS).c_str());
+        exe.SetJson(test_json);
+        EXPECT_STREQ("", exe.AddResource("a.txt", "res_a.txt").c_str());
+        EXPECT_STREQ("", exe.AddResource("b.txt", "res_b.txt").c_str());
+        EXPECT_STREQ("Duplicated resource name: a.txt",
+                     exe.AddResource("a.txt", "res_b.txt").c_str());
+        EXPECT_STREQ("Invalid resource name: ../a",
+                     exe.AddResource("../a", "res_a.txt").c_str());
+        EXPECT_STREQ("", exe.Write("resources.bin").c_str());
+        // Resources can be extracted after writing them.
+        EXPECT_STREQ("", exe.ExtractResource("b.txt", "extracted_b.txt").c_str());
+        EXPECT_STREQ("b", ReadTextFile("extracted_b.txt").c_str());
+    }
+
+    ExeContainer exe;
+    EXPECT_STREQ("", exe.Read("resources.bin").c_str());
+    tuwjson::Value embedded_json;
+    exe.GetJson(embedded_json);
+    EXPECT_EQ(embedded_json, test_json);
+    ASSERT_EQ(2u, exe.GetResourceCount());
+    EXPECT_STREQ("a.txt", exe.GetResource(0).name.c_str());
+    EXPECT_EQ(10u, exe.GetResource(0).size);
+    EXPECT_EQ(0u, exe.GetResource(1).offset % 8);
+    EXPECT_STREQ("", exe.ExtractResource("a.txt", "extracted_a.txt").c_str());
+    EXPECT_STREQ("resource a", ReadTextFile("extracted_a.txt").c_str());
+    EXPECT_STREQ("Resource not found: c.txt",
+                 exe.ExtractResource("c.txt", "extracted_c.txt").c_str());
+
+    // The base exe is the same as the original one.
+    ExeContainer base;
+    EXPECT_STREQ("", base.Read(JSON_ALL_KEYS).c_str());
+    EXPECT_TRUE(exe.HasSameExe(base));
+
+    // Update only the json. Resources should be kept.
+    tuwjson::Value new_json;
+    tuwjson::Parser parser;
+    parser.ParseJson("{\"gui\": []}", &new_json);
+    ASSERT_FALSE(parser.HasError());
+    exe.SetJson(new_json);
+    EXPECT_STREQ("", exe.Write("resources.bin").c_str());
+    ExeContainer updated;
+    EXPECT_STREQ("", updated.Read("resources.bin").c_str());
+    EXPECT_EQ(2u, updated.GetResourceCount());
+    EXPECT_STREQ("", updated.ExtractResource("a.txt", "extracted_a.txt").c_str());
+    EXPECT_STREQ("resource a", ReadTextFile("extracted_a.txt").c_str());
+
+    // Remove resources.
+    updated.ClearResources();
+    EXPECT_STREQ("", updated.Write("no_resources.bin").c_str());
+    ExeContainer removed;
+    EXPECT_STREQ("", removed.Read("no_resources.bin").c_str());
+    EXPECT_TRUE(removed.HasJson());
+    EXPECT_EQ(0u, removed.GetResourceCount());
+    EXPECT_TRUE(removed.HasSameExe(base));
+}
+
+TEST(JsonEmbeddingTest, GetResourcePath) {
+    WriteTextFile("res_c.txt", "resource c");
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    {
+        ExeContainer exe;
+        EXPECT_STREQ("", exe.Read(JSON_ALL_KEYS).c_str());
+        exe.SetJson(test_json);
+        EXPECT_STREQ("", exe.AddResource("c.txt", "res_c.txt").c_str());
+        EXPECT_STREQ("", exe.Write("resources2.bin").c_str());
+    }
+    SetResourceExePath("resources2.bin");
+    noex::string err;
+    noex::string path = GetResourcePath("c.txt", &err);
+    EXPECT_STREQ("", err.c_str());
+    EXPECT_STREQ("resource c", ReadTextFile(path).c_str());
+    // Extracted files are reused.
+    EXPECT_STREQ(path.c_str(), GetResourcePath("c.txt", &err).c_str());
+    GetResourcePath("d.txt", &err);
+    EXPECT_STREQ("Resource not found: d.txt", err.c_str());
+    // Files are removed when the exe is changed.
+    SetResourceExePath(JSON_ALL_KEYS);
+    EXPECT_FALSE(envuFileExists(path.c_str()));
+}
+
+TEST(JsonEmbeddingTest, ReadOldHeader) {
+    // Embedded data made by old versions of Tuw has a 32-bit hash (FNV-1).
+    const char* json_str = "{\"gui\":[]}";
+    uint32_t json_size = static_cast<uint32_t>(strlen(json_str));
+    const char* exe_path = "old_header.bin";
+    FILE* fp = FileOpen(exe_path, FILE_MODE_WRITE);
+    ASSERT_NE(nullptr, fp);
+    fwrite("exe", 1, 3, fp);
+    WriteUint32(fp, 0x4A534F4E);
+    WriteUint32(fp, json_size);
+    WriteUint32(fp, Fnv1Hash32(json_str));
+    fwrite(json_str, 1, json_size, fp);
+    long pos = ftell(fp);
+    for (; pos % 8 != 0; pos++)
+        fputc(0, fp);
+    WriteUint32(fp, static_cast<uint32_t>(3 - pos - 8));
+    WriteUint32(fp, 0x4A534F4E);
+    fclose(fp);
+
+    ExeContainer exe;
+    EXPECT_STREQ("", exe.Read(exe_path).c_str());
+    ASSERT_TRUE(exe.HasJson());
+    tuwjson::Value embedded_json;
+    exe.GetJson(embedded_json);
+    EXPECT_TRUE(embedded_json["gui"].IsEmptyArray());
+
+    // It writes the new header when updating the json.
+    EXPECT_STREQ("", exe.Write(exe_path).c_str());
+    ExeContainer updated;
+    EXPECT_STREQ("", updated.Read(exe_path).c_str());
+    EXPECT_TRUE(updated.HasJson());
+}
@@ -0,0 +1,85 @@
+// Tests for JobQueue
+
+#include "test_utils.h"
+#include "job_queue.h"
+
+// Polls the queue for 5 seconds at most.
+static Job* WaitJob(JobQueue& queue, size_t max_running) {
+    uint64_t start = GetMonotonicTimeUs();
+    while (GetMonotonicTimeUs() - start < 5000000) {
+        Job* job = queue.Update();
+        EXPECT_GE(max_running, queue.GetRunningCount());
+        if (job)
+            return job;
+    }
+    return nullptr;
+}
+
+TEST(JobQueueTest, RunJobs) {
+    tuwjson::Value sub_definition;
+    sub_definition.SetObject();
+    sub_definition["max_parallel"].SetInt(2);
+    JobQueue queue;
+    noex::vector<noex::string> args;
+    EXPECT_EQ(1, queue.Push(sub_definition, "exit 1", args, ""));
+    EXPECT_EQ(2, queue.Push(sub_definition, "exit 2", args, ""));
+    EXPECT_EQ(3, queue.Push(sub_definition, "exit 3", args, "key"));
+    EXPECT_EQ(3u, queue.GetQueuedCount());
+    EXPECT_EQ(0u, queue.GetRunningCount());
+
+    int id_sum = 0;
+    for (int i = 0; i < 3; i++) {
+        Job* job = WaitJob(queue, 2);
+        ASSERT_NE(nullptr, job);
+        EXPECT_EQ(job->id, job->result.exit_code);
+        EXPECT_STREQ(job->id == 3 ? "key" : "", job->cache_key.c_str());
+        id_sum += job->id;
+        JobQueue::DeleteJob(job);
+    }
+    EXPECT_EQ(6, id_sum);
+    EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(JobQueueTest, RunInOrder) {
+    tuwjson::Value sub_definition;
+    sub_definition.SetObject();
+    JobQueue queue;
+    noex::vector<noex::string> args;
+    for (int i = 0; i < 3; i++)
+        queue.Push(sub_definition, "exit " + noex::to_string(i), args, "");
+    for (int i = 0; i < 3; i++) {
+        Job* job = WaitJob(queue, 1);
+        ASSERT_NE(nullptr, job);
+        EXPECT_EQ(i, job->result.exit_code);
+        JobQueue::DeleteJob(job);
+    }
+}
+
+TEST(JobQueueTest, Clear) {
+    tuwjson::Value sub_definition;
+    sub_definition.SetObject();
+    JobQueue queue;
+    noex::vector<noex::string> args;
+    queue.Push(sub_definition, "exit 1", args, "");
+    queue.Push(sub_definition, "exit 2", args, "");
+    JobQueue::DeleteJob(queue.Update());
+    EXPECT_EQ(1u, queue.GetQueuedCount());
+    queue.Clear();
+    EXPECT_TRUE(queue.IsEmpty());
+}
+
+#ifndef _WIN32
+TEST(JobQueueTest, Progress) {
+    tuwjson::Value sub_definition;
+    sub_definition.SetObject();
+    sub_definition["progress_regex"].SetString("\\d+%");
+    JobQueue queue;
+    noex::vector<noex::string> args;
+    queue.Push(sub_definition, "echo 10%; echo 42% done; echo finished", args, "");
+    Job* job = WaitJob(queue, 1);
+    ASSERT_NE(nullptr, job);
+    EXPECT_EQ(42, job->execution->GetProgress());
+    EXPECT_STREQ("finished", job->result.last_line.c_str());
+    JobQueue::DeleteJob(job);
+}
+#endif
@@ -40,6 +40,28 @@ TEST(JsonCheckTest, LoadJsonWithComments) {
     EXPECT_TRUE(err.empty());
 }
 
+TEST(JsonCheckTest, AppendJsonLine) {
+    const char* file = "history_test.jsonl";
+    remove(file);
+    tuwjson::Value record;
+    record.SetObject();
+    record["exit_code"].SetInt(0);
+    record["label"].SetString("a\nb");
+    EXPECT_STREQ("", json_utils::AppendJsonLine(record, file).c_str());
+    record["exit_code"].SetInt(1);
+    EXPECT_STREQ("", json_utils::AppendJsonLine(record, file).c_str());
+
+    FILE* fp = fopen(file, "rb");
+    ASSERT_NE(nullptr, fp);
+    char buf[256];
+    size_t size = fread(buf, 1, 255, fp);
+    fclose(fp);
+    remove(file);
+    buf[size] = 0;
+    EXPECT_STREQ("{\"exit_code\": 0,\"label\": \"a\\nb\"}\n"
+                 "{\"exit_code\": 1,\"label\": \"a\\nb\"}\n", buf);
+}
+
 TEST(JsonCheckTest, LoadJsonSuccess) {
     tuwjson::Value test_json;
     GetTestJson(test_json);
@@ -359,3 +381,139 @@ TEST(JsonCheckTest, checkHelpWithoutGUI) {
     EXPECT_TRUE(test_json.HasMember("help"));
     EXPECT_TRUE(test_json.HasMember("legacy_renderer"));
 }
+
+TEST(JsonCheckTest, checkGUIShellFalse) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    tuwjson::Value& sub_definition = test_json["gui"][0];
+    sub_definition["shell"].SetBool(false);
+    sub_definition["command"].SetString(
+        "tool \"a b\" --f=%file% %folder%'x y' %combo% %radio% %check%"
+        " %options% %text% %integer% %double% 100%%");
+    noex::string err_msg;
+    json_utils::CheckDefinition(err_msg, test_json);
+    EXPECT_TRUE(err_msg.empty());
+
+    tuwjson::Value& argv = sub_definition["command_argv"];
+    ASSERT_EQ(12, argv.GetArraySize());
+    EXPECT_STREQ("tool", argv[0][0].GetString());
+    EXPECT_STREQ("a b", argv[1][0].GetString());
+    EXPECT_STREQ("--f=", argv[2][0].GetString());
+    EXPECT_EQ(1, argv[2][1].GetInt());
+    EXPECT_EQ(2, argv[3][0].GetInt());
+    EXPECT_STREQ("x y", argv[3][1].GetString());
+    EXPECT_EQ(1, argv[4].GetArraySize());
+    EXPECT_STREQ("100", argv[11][0].GetString());
+    EXPECT_EQ(CMD_ID_PERCENT, argv[11][1].GetInt());
+}
+
+TEST(JsonCheckTest, checkGUIFailUnclosedQuote) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    tuwjson::Value& sub_definition = test_json["gui"][0];
+    sub_definition["shell"].SetBool(false);
+    sub_definition["command"].SetString(
+        "tool \"%file% %folder% %combo% %radio% %check%"
+        " %options% %text% %integer% %double%");
+    CheckGUIError(test_json,
+        "Found an unclosed quote in the command. (line: 7, column: 24)");
+}
+
+TEST(JsonCheckTest, checkGUIWorker) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    tuwjson::Value& sub_definition = test_json["gui"][0];
+    sub_definition["worker"].SetString("python3 worker.py");
+    noex::string err_msg;
+    json_utils::CheckDefinition(err_msg, test_json);
+    EXPECT_TRUE(err_msg.empty());
+    EXPECT_TRUE(sub_definition.HasMember("command_argv"));
+}
+
+TEST(JsonCheckTest, checkGUIFailWorker) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0]["worker"].SetBool(true);
+    CheckGUIError(test_json,
+        "\"worker\" should be a string");
+}
+
+TEST(JsonCheckTest, checkGUIFailMaxParallel) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0]["max_parallel"].SetInt(0);
+    CheckGUIError(test_json,
+        "\"max_parallel\" should be a positive integer.");
+}
+
+TEST(JsonCheckTest, checkGUIFailProgressRegex) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0]["progress_regex"].SetString("(\\d+)%");
+    CheckGUIError(test_json,
+        "\"progress_regex\" doesn't support () operators.");
+}
+
+TEST(JsonCheckTest, checkGUIFailStdin) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0]["stdin"].SetString("missing");
+    CheckGUIError(test_json,
+        "There is undefined id \"missing\" in \"stdin\".");
+
+    GetTestJson(test_json);
+    test_json["gui"][0]["stdin"].SetString("text");
+    test_json["gui"][0]["worker"].SetString("python worker.py");
+    CheckGUIError(test_json,
+        "\"stdin\" can NOT be used with \"worker\".");
+}
+
+TEST(JsonCheckTest, checkGUIFailProcessLimits) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0]["nice"].SetInt(20);
+    CheckGUIError(test_json,
+        "\"nice\" should be an integer from -20 to 19.");
+
+    GetTestJson(test_json);
+    test_json["gui"][0]["cpu_affinity"].SetInt(64);
+    CheckGUIError(test_json,
+        "\"cpu_affinity\" only supports CPU numbers from 0 to 63.");
+
+    GetTestJson(test_json);
+    test_json["gui"][0]["cpu_affinity"].SetString("0");
+    CheckGUIError(test_json,
+        "\"cpu_affinity\" should be an array of ints");
+
+    GetTestJson(test_json);
+    test_json["gui"][0]["memory_limit_mb"].SetInt(0);
+    CheckGUIError(test_json,
+        "\"memory_limit_mb\" should be a positive integer.");
+
+    GetTestJson(test_json);
+    test_json["gui"][0]["cpu_limit"].SetInt(50);
+    test_json["gui"][0]["worker"].SetString("python worker.py");
+    CheckGUIError(test_json,
+        "\"cpu_limit\" can NOT be used with \"worker\".");
+}
+
+TEST(JsonCheckTest, checkGUIFailTimeout) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0]["timeout_ms"].SetInt(0);
+    CheckGUIError(test_json,
+        "\"timeout_ms\" should be a positive integer.");
+
+    GetTestJson(test_json);
+    test_json["gui"][0]["kill_grace_ms"].SetInt(-1);
+    CheckGUIError(test_json,
+        "\"kill_grace_ms\" should NOT be negative.");
+}
+
+TEST(JsonCheckTest, checkGUIFailPipeline) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0]["pipeline"].SetArray();
+    CheckGUIError(test_json,
+        "\"pipeline\" can NOT be used with \"command\".");
+}
@@ -372,6 +372,14 @@ TEST_F(JsonWriteTest, WriteEscape) {
     EXPECT_STREQ(buffer, "\"\\\"\\\\/\\b\\f\\n\\r\\t\"");
 }
 
+TEST_F(JsonWriteTest, WriteControlChars) {
+    root.SetString("\x1b[0m\0\x1f", 6);
+    char buffer[30];
+    char* end = writer.WriteJson(&root, buffer, 30);
+    EXPECT_EQ(end, buffer + 23);
+    EXPECT_STREQ(buffer, "\"\\u001b[0m\\u0000\\u001f\"");
+}
+
 TEST_F(JsonWriteTest, WriteStringUTF) {
     root.SetString("\xc2\x80\xe0\x80\xbf\xf0\x80\xbf\xa0");
     char buffer[20];
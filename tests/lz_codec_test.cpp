@@ -0,0 +1,61 @@
+// Tests for lz_codec.cpp
+
+#include "test_utils.h"
+#include "lz_codec.h"
+
+static void CheckRoundTrip(const noex::string& str) {
+    noex::string compressed(LzCompressBound(str.size()));
+    size_t size = LzCompress(str.data(), str.size(), compressed.data(), compressed.size());
+    ASSERT_NE(0u, size);
+    noex::string decompressed(str.size());
+    EXPECT_TRUE(LzDecompress(compressed.data(), size, decompressed.data(), str.size()));
+    EXPECT_STREQ(str.c_str(), decompressed.c_str());
+}
+
+TEST(LzCodecTest, RoundTrip) {
+    CheckRoundTrip("");
+    CheckRoundTrip("a");
+    CheckRoundTrip("abcabcabcabcabcabcabcabcabcabcabcabc");
+    CheckRoundTrip("{\"gui\": [{\"label\": \"a\"}, {\"label\": \"b\"}]}");
+    noex::string long_str;
+    for (int i = 0; i < 5000; i++)
+        long_str += noex::to_string(i % 300) + (i % 7 ? "," : "\n");
+    CheckRoundTrip(long_str);
+    // Long runs need extra length bytes.
+    noex::string run(1000);
+    for (size_t i = 0; i < run.size(); i++)
+        run.data()[i] = 'x';
+    CheckRoundTrip(run);
+}
+
+TEST(LzCodecTest, CompressJson) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    char json[JSON_SIZE_MAX];
+    tuwjson::Writer writer;
+    char* end = writer.WriteJson(&test_json, json, JSON_SIZE_MAX);
+    ASSERT_NE(nullptr, end);
+    size_t json_size = static_cast<size_t>(end - json);
+    noex::string compressed(LzCompressBound(json_size));
+    size_t size = LzCompress(json, json_size, compressed.data(), compressed.size());
+    EXPECT_LT(0u, size);
+    EXPECT_GT(json_size * 2 / 3, size);
+}
+
+TEST(LzCodecTest, DecompressFail) {
+    const char* str = "abcdabcdabcdabcdabcd";
+    char compressed[64];
+    size_t size = LzCompress(str, 20, compressed, sizeof(compressed));
+    ASSERT_NE(0u, size);
+    char out[32];
+    // Wrong sizes
+    EXPECT_FALSE(LzDecompress(compressed, size, out, 19));
+    EXPECT_FALSE(LzDecompress(compressed, size, out, 21));
+    // Truncated data
+    EXPECT_FALSE(LzDecompress(compressed, size - 2, out, 20));
+    // Offset out of the output
+    const char broken[] = { 0x10, 'a', 0x05, 0x00 };
+    EXPECT_FALSE(LzDecompress(broken, sizeof(broken), out, 8));
+    // dst too small for compression
+    EXPECT_EQ(0u, LzCompress(str, 20, compressed, 4));
+}
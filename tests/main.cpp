@@ -1,4 +1,7 @@
 #include <gtest/gtest.h>
+#ifndef _WIN32
+#include <signal.h>
+#endif
 
 // test json files
 #include "test_utils.h"
@@ -27,6 +30,11 @@ int main(int argc, char* argv[]) {
 #endif
     ::testing::InitGoogleTest(&argc, argv);
 
+#ifndef _WIN32
+    // Tuw ignores SIGPIPE at startup. See main() in main.cpp.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
     char *exe_dir = envuGetExecutableDir();
     envuSetCwd(exe_dir);
     envuFree(exe_dir);
@@ -129,6 +129,44 @@ TEST_F(MainFrameTest, GetCommandEmpty) {
     EXPECT_STREQ("", main_frame->GetCommand().c_str());
 }
 
+TEST_F(MainFrameTest, GetCommandArgs) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0].Swap(test_json["gui"][1]);
+    test_json["gui"][0]["shell"].SetBool(false);
+    test_json["gui"][0]["command"].SetString(
+        "echo --file=%file% \"%folder%/x\" %combo% %radio% %check%"
+        " %options% %text% %integer% %double% 100%%");
+    tuwjson::Value dummy_config;
+    GetDummyConfig(dummy_config);
+    main_frame = new MainFrame(test_json, dummy_config);
+    noex::vector<noex::string> args = main_frame->GetCommandArgs();
+    const char* expected[] = {
+        "echo", "--file=test.txt", "testdir/x", "value3", "value3", "flag!",
+        " --f2", "remove this text!", "10", "0.01", "100%"
+    };
+    ASSERT_EQ(sizeof(expected) / sizeof(expected[0]), args.size());
+    for (size_t i = 0; i < args.size(); i++)
+        EXPECT_STREQ(expected[i], args[i].c_str());
+}
+
+TEST_F(MainFrameTest, GetCommandArgsEmptyValues) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0]["shell"].SetBool(false);
+    test_json["gui"][0]["command"].SetString(
+        "echo %file% %folder% %combo% %radio% %check%"
+        " %options% %text% %integer% %double% \"\"");
+    tuwjson::Value dummy_config;
+    GetDummyConfig(dummy_config);
+    main_frame = new MainFrame(test_json, dummy_config);
+    noex::vector<noex::string> args = main_frame->GetCommandArgs();
+    const char* expected[] = { "echo", "value1", "value1", "0", "0.0", "" };
+    ASSERT_EQ(sizeof(expected) / sizeof(expected[0]), args.size());
+    for (size_t i = 0; i < args.size(); i++)
+        EXPECT_STREQ(expected[i], args[i].c_str());
+}
+
 TEST_F(MainFrameTest, RunCommandSuccess) {
     tuwjson::Value test_json;
     GetTestJson(test_json);
@@ -161,6 +199,29 @@ TEST_F(MainFrameTest, RunCommandFail) {
     EXPECT_STRNE("", result.err_msg.c_str());
 }
 
+#ifndef _WIN32
+// echo is a shell built-in on Windows.
+TEST_F(MainFrameTest, RunCommandWithoutShell) {
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    test_json["gui"][0].Swap(test_json["gui"][1]);
+    test_json["gui"][0]["shell"].SetBool(false);
+    test_json["gui"][0]["command"].SetString(
+        "echo %file% %folder% %combo% %radio% %check%"
+        " %options% %text% %integer% \"; echo %double%\"");
+    tuwjson::Value dummy_config;
+    GetDummyConfig(dummy_config);
+    main_frame = new MainFrame(test_json, dummy_config);
+
+    ExecuteResult result = Execute(main_frame->GetCommandArgs());
+    EXPECT_EQ(0, result.exit_code);
+    EXPECT_STREQ("", result.err_msg.c_str());
+    // The shell should not parse the semicolon.
+    EXPECT_STREQ("test.txt testdir value3 value3 flag!  --f2 remove this text! 10 ; echo 0.01",
+                 result.last_line.c_str());
+}
+#endif  // _WIN32
+
 TEST_F(MainFrameTest, UpdateFrame) {
     tuwjson::Value test_json;
     GetTestJson(test_json);
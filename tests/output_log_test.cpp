@@ -0,0 +1,88 @@
+// Tests for OutputLog
+
+#include "test_utils.h"
+#include "output_log.h"
+#include "exec.h"
+
+constexpr char LOG_FILE[] = "output_log_test.log";
+
+static void AppendStr(OutputLog& log, const char* str) {
+    log.Append(str, strlen(str));
+}
+
+TEST(OutputLogTest, GetLines) {
+    OutputLog log;
+    EXPECT_STREQ("", log.Open(LOG_FILE).c_str());
+    EXPECT_TRUE(log.IsEmpty());
+    EXPECT_EQ(0u, log.GetLineCount());
+    // Lines can be split into chunks.
+    AppendStr(log, "line1\nli");
+    AppendStr(log, "ne2\r\n");
+    AppendStr(log, "\nline4");
+    EXPECT_EQ(4u, log.GetLineCount());
+    EXPECT_STREQ("line1", log.GetLine(0).c_str());
+    EXPECT_STREQ("line2", log.GetLine(1).c_str());
+    EXPECT_STREQ("", log.GetLine(2).c_str());
+    EXPECT_STREQ("line4", log.GetLine(3).c_str());
+    EXPECT_STREQ("", log.GetLine(4).c_str());
+    EXPECT_STREQ("line2\r\n\nline4", log.GetLines(1, 10).c_str());
+
+    // The mapped view should be updated after appending.
+    AppendStr(log, "\n");
+    log.Close();
+    EXPECT_EQ(4u, log.GetLineCount());
+    EXPECT_STREQ("line4", log.GetLine(3).c_str());
+}
+
+TEST(OutputLogTest, FindLineByOffset) {
+    OutputLog log;
+    EXPECT_STREQ("", log.Open(LOG_FILE).c_str());
+    AppendStr(log, "a\nbc\n\nd");
+    EXPECT_EQ(0u, log.FindLineByOffset(0));
+    EXPECT_EQ(0u, log.FindLineByOffset(1));
+    EXPECT_EQ(1u, log.FindLineByOffset(2));
+    EXPECT_EQ(1u, log.FindLineByOffset(4));
+    EXPECT_EQ(2u, log.FindLineByOffset(5));
+    EXPECT_EQ(3u, log.FindLineByOffset(6));
+}
+
+TEST(OutputLogTest, Search) {
+    OutputLog log;
+    EXPECT_STREQ("", log.Open(LOG_FILE).c_str());
+    for (int i = 0; i < 1000; i++)
+        AppendStr(log, ("progress " + noex::to_string(i) + "\n").c_str());
+    EXPECT_EQ(1000u, log.GetLineCount());
+    EXPECT_EQ(500u, log.Search("progress 500"));
+    EXPECT_EQ(999u, log.Search("999", 500));
+    EXPECT_EQ(noex::string::npos, log.Search("500", 501));
+    EXPECT_EQ(noex::string::npos, log.Search("not found"));
+}
+
+TEST(OutputLogTest, GetErrorRegion) {
+    OutputLog log;
+    EXPECT_STREQ("", log.Open(LOG_FILE).c_str());
+    EXPECT_STREQ("", log.GetErrorRegion(3).c_str());
+    for (int i = 1; i <= 10; i++)
+        AppendStr(log, ("line" + noex::to_string(i) + "\n").c_str());
+    EXPECT_STREQ("Lines 8-10 of 10:\nline8\nline9\nline10",
+                 log.GetErrorRegion(3).c_str());
+    EXPECT_STREQ("", log.Open(LOG_FILE).c_str());
+    for (int i = 1; i <= 10; i++)
+        AppendStr(log, (i == 5 ? "Fatal ERROR!\n" : "ok\n"));
+    EXPECT_STREQ("Lines 4-6 of 10:\nok\nFatal ERROR!\nok",
+                 log.GetErrorRegion(3).c_str());
+}
+
+#ifndef _WIN32
+TEST(OutputLogTest, Execute) {
+    OutputLog log;
+    EXPECT_STREQ("", log.Open(LOG_FILE).c_str());
+    ExecuteResult result = Execute("seq 1 10000", false, &log);
+    log.Close();
+    EXPECT_EQ(0, result.exit_code);
+    EXPECT_EQ(10000u, log.GetLineCount());
+    EXPECT_STREQ("1", log.GetLine(0).c_str());
+    EXPECT_STREQ("10000", log.GetLine(9999).c_str());
+    EXPECT_EQ(4999u, log.Search("5000"));
+}
+#endif
@@ -0,0 +1,345 @@
+// Tests for ChildProcess
+
+#include "test_utils.h"
+#include "process.h"
+#include "zygote.h"
+#ifndef _WIN32
+#include <signal.h>
+#include <time.h>
+#endif
+
+#ifndef _WIN32
+static void ReadAvailable(ChildProcess& process, bool use_stderr, noex::string& out) {
+    char buf[256];
+    unsigned size;
+    while ((size = use_stderr ? process.ReadStderr(buf, 255)
+                              : process.ReadStdout(buf, 255)) > 0) {
+        buf[size] = 0;
+        out += buf;
+    }
+}
+
+static noex::string ReadAll(ChildProcess& process, bool use_stderr) {
+    noex::string out;
+    do {
+        ReadAvailable(process, use_stderr, out);
+    } while (process.IsAlive());
+    // The process might write something right before exiting.
+    ReadAvailable(process, use_stderr, out);
+    return out;
+}
+
+TEST(ProcessTest, ReadStdout) {
+    ChildProcess process;
+    const char* argv[] = { "echo", "a  b", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    EXPECT_STREQ("a  b\n", ReadAll(process, false).c_str());
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(0, exit_code);
+}
+
+TEST(ProcessTest, ReadStderr) {
+    ChildProcess process;
+    const char* argv[] = { "/bin/sh", "-c", "echo err 1>&2; exit 3", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    EXPECT_STREQ("err\n", ReadAll(process, true).c_str());
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(3, exit_code);
+}
+
+TEST(ProcessTest, StdinIsEmpty) {
+    ChildProcess process;
+    const char* argv[] = { "cat", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    EXPECT_STREQ("", ReadAll(process, false).c_str());
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(0, exit_code);
+}
+
+TEST(ProcessTest, Stats) {
+    ChildProcess process;
+    const char* argv[] = { "/bin/sh", "-c", "sleep 0.1", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    const ProcessStats& stats = process.GetStats();
+    EXPECT_LE(100000u, stats.wall_time_us);
+    EXPECT_GT(10000000u, stats.wall_time_us);
+#ifndef __HAIKU__
+    EXPECT_LT(0u, stats.max_rss_kb);
+#endif
+}
+
+// Reads outputs while checking the timeout.
+static noex::string ReadAllWithTimeout(ChildProcess& process) {
+    noex::string out;
+    struct timespec ten_ms = { 0, 10 * 1000000 };
+    do {
+        process.CheckTimeout();
+        ReadAvailable(process, false, out);
+        nanosleep(&ten_ms, nullptr);
+    } while (process.IsAlive());
+    ReadAvailable(process, false, out);
+    return out;
+}
+
+TEST(ProcessTest, Timeout) {
+    ChildProcess process;
+    process.SetTimeout(100, 1000);
+    const char* argv[] = { "sleep", "10", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    ReadAllWithTimeout(process);
+    EXPECT_TRUE(process.TimedOut());
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(1, exit_code);
+    // SIGTERM should stop it before SIGKILL.
+    EXPECT_GT(1000000u, process.GetStats().wall_time_us);
+}
+
+TEST(ProcessTest, TimeoutKillsGroup) {
+    ChildProcess process;
+    process.SetTimeout(100, 100);
+    // Both of them ignore SIGTERM.
+    const char* argv[] = { "/bin/sh", "-c", "trap '' TERM; sleep 10 & echo $!; wait", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    noex::string out = ReadAllWithTimeout(process);
+    EXPECT_TRUE(process.TimedOut());
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_GT(5000000u, process.GetStats().wall_time_us);
+
+    // The grandchild should be killed too.
+    pid_t pid = static_cast<pid_t>(atoi(out.c_str()));
+    ASSERT_LT(0, pid);
+    struct timespec ten_ms = { 0, 10 * 1000000 };
+    for (int i = 0; i < 200 && kill(pid, 0) == 0; i++)
+        nanosleep(&ten_ms, nullptr);
+    EXPECT_NE(0, kill(pid, 0));
+}
+
+TEST(ProcessTest, TimeoutKillsGroupAfterExit) {
+    ChildProcess process;
+    process.SetTimeout(100, 1000);
+    // The shell exits with SIGTERM, but the grandchild ignores it.
+    const char* argv[] = {
+        "/bin/sh", "-c", "echo $$; (trap '' TERM; exec sleep 10) & echo $!; wait", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    noex::string out = ReadAllWithTimeout(process);
+    EXPECT_TRUE(process.TimedOut());
+    pid_t pid = static_cast<pid_t>(atoi(out.c_str()));
+    const char* lf = strchr(out.c_str(), '\n');
+    ASSERT_NE(nullptr, lf);
+    pid_t grandchild = static_cast<pid_t>(atoi(lf + 1));
+    ASSERT_LT(0, pid);
+    ASSERT_LT(0, grandchild);
+    // The shell is a zombie until Join(). It keeps the pgid reserved.
+    EXPECT_EQ(0, kill(pid, 0));
+    EXPECT_EQ(0, kill(grandchild, 0));
+
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_GT(1000000u, process.GetStats().wall_time_us);
+    struct timespec ten_ms = { 0, 10 * 1000000 };
+    for (int i = 0; i < 200 && kill(grandchild, 0) == 0; i++)
+        nanosleep(&ten_ms, nullptr);
+    EXPECT_NE(0, kill(grandchild, 0));
+}
+
+TEST(ProcessTest, NoTimeout) {
+    ChildProcess process;
+    process.SetTimeout(5000, 0);
+    const char* argv[] = { "echo", "ok", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    EXPECT_STREQ("ok\n", ReadAllWithTimeout(process).c_str());
+    EXPECT_FALSE(process.TimedOut());
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(0, exit_code);
+}
+
+TEST(ProcessTest, TerminateAfterExit) {
+    ChildProcess process;
+    const char* argv[] = { "/bin/sh", "-c", "exit 3", nullptr };
+    ASSERT_TRUE(process.Spawn(argv, PROCESS_NEW_GROUP));
+    while (process.IsAlive()) {}
+    // The pid and the pgid might be reused. Terminate() should not send signals.
+    process.Terminate();
+    process.Interrupt();
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(3, exit_code);
+}
+
+TEST(ProcessTest, JoinWithoutSpawn) {
+    ChildProcess process;
+    int exit_code;
+    EXPECT_FALSE(process.Join(&exit_code));
+    EXPECT_EQ(-1, exit_code);
+}
+#endif  // _WIN32
+
+#ifndef _WIN32
+// A worker that prints requests and returns the number of requests as exit code.
+#define WORKER_CMD \
+    "i=0; while read -r line; do i=$((i+1)); echo \"$line\"; printf '\\036%d\\n' $i; done"
+
+TEST(WorkerTest, Run) {
+    Worker worker;
+    noex::vector<noex::string> args;
+    args.push_back("a b");
+    args.push_back("\"c\"");
+    ExecuteResult result = worker.Run(WORKER_CMD, args);
+    EXPECT_EQ(1, result.exit_code);
+    EXPECT_STREQ("", result.err_msg.c_str());
+    EXPECT_STREQ("{\"args\": [\"a b\",\"\\\"c\\\"\"]}", result.last_line.c_str());
+
+    // The second request should go to the same process.
+    result = worker.Run(WORKER_CMD, args);
+    EXPECT_EQ(2, result.exit_code);
+    EXPECT_STREQ("", result.err_msg.c_str());
+}
+
+TEST(WorkerTest, Restart) {
+    Worker worker;
+    noex::vector<noex::string> args;
+    ExecuteResult result = worker.Run(WORKER_CMD, args);
+    EXPECT_EQ(1, result.exit_code);
+    // A different command restarts the worker.
+    result = worker.Run(WORKER_CMD " ", args);
+    EXPECT_EQ(1, result.exit_code);
+}
+
+TEST(WorkerTest, OutputsAroundFrame) {
+    Worker worker;
+    noex::vector<noex::string> args;
+    const char* cmd =
+        "i=0; while read -r line; do i=$((i+1)); echo err$i >&2; "
+        "printf 'out\\n\\036%d\\nafter%d\\n' $i $i; done";
+    ExecuteResult result = worker.Run(cmd, args);
+    EXPECT_EQ(1, result.exit_code);
+    EXPECT_STREQ("err1\n", result.err_msg.c_str());
+    // Outputs after the frame should not be dropped.
+    EXPECT_STREQ("after1", result.last_line.c_str());
+
+    // stderr of the first request should not be charged to the second one.
+    result = worker.Run(cmd, args);
+    EXPECT_EQ(2, result.exit_code);
+    EXPECT_STREQ("err2\n", result.err_msg.c_str());
+}
+
+TEST(WorkerTest, LargeRequest) {
+    Worker worker;
+    noex::vector<noex::string> args;
+    args.push_back(noex::string(200000));
+    memset(args[0].data(), 'a', 200000);
+    // The worker fills stdout before reading stdin.
+    const char* cmd =
+        "while true; do head -c 200000 /dev/zero | tr '\\0' b; echo; "
+        "read -r line || break; printf '\\036%d\\n' ${#line}; done";
+    ExecuteResult result = worker.Run(cmd, args);
+    EXPECT_EQ(200014, result.exit_code);
+    EXPECT_STREQ("", result.err_msg.c_str());
+}
+
+TEST(WorkerTest, ExitUnexpectedly) {
+    Worker worker;
+    noex::vector<noex::string> args;
+    ExecuteResult result = worker.Run("read -r line; echo error! >&2", args);
+    EXPECT_EQ(-1, result.exit_code);
+    EXPECT_STREQ("The worker exited unexpectedly.\nerror!\n", result.err_msg.c_str());
+}
+#endif  // _WIN32
+
+#ifdef TUW_USE_ZYGOTE
+TEST(ZygoteTest, Spawn) {
+    ASSERT_TRUE(ZygoteStart());
+    ASSERT_TRUE(ZygoteIsRunning());
+    ChildProcess process;
+    const char* argv[] = { "/bin/sh", "-c", "pwd; echo err 1>&2; exit 3", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    noex::string out;
+    noex::string err;
+    do {
+        ReadAvailable(process, false, out);
+        ReadAvailable(process, true, err);
+    } while (process.IsAlive());
+    ReadAvailable(process, false, out);
+    ReadAvailable(process, true, err);
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(3, exit_code);
+    EXPECT_STREQ("err\n", err.c_str());
+    EXPECT_FALSE(out.empty());
+    EXPECT_LT(0u, process.GetStats().max_rss_kb);
+}
+
+TEST(ZygoteTest, PipeStdin) {
+    ASSERT_TRUE(ZygoteStart());
+    ChildProcess process;
+    const char* argv[] = { "cat", nullptr };
+    ASSERT_TRUE(process.Spawn(argv, PROCESS_REDIRECT_OUTPUT | PROCESS_PIPE_STDIN));
+    EXPECT_TRUE(process.WriteStdin("abc\n", 4));
+    process.CloseStdin();
+    EXPECT_STREQ("abc\n", ReadAll(process, false).c_str());
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(0, exit_code);
+}
+
+TEST(ZygoteTest, Terminate) {
+    ASSERT_TRUE(ZygoteStart());
+    ChildProcess process;
+    const char* argv[] = { "sleep", "10", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    EXPECT_TRUE(process.IsAlive());
+    process.Terminate();
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(1, exit_code);
+}
+
+TEST(ZygoteTest, TooManyArgs) {
+    ASSERT_TRUE(ZygoteStart());
+    const size_t argc = ZYGOTE_ARGC_MAX + 10;
+    noex::vector<const char*> argv;
+    argv.push_back("/bin/sh");
+    argv.push_back("-c");
+    argv.push_back("echo $#");
+    while (argv.size() < argc)
+        argv.push_back("a");
+    argv.push_back(nullptr);
+
+    // The zygote never drops arguments.
+    ZygoteChild child;
+    EXPECT_FALSE(ZygoteSpawn(argv.data(), 0, &child));
+    EXPECT_TRUE(ZygoteIsRunning());
+
+    // The command runs with posix_spawn instead.
+    ChildProcess process;
+    ASSERT_TRUE(process.Spawn(argv.data()));
+    noex::string expected = noex::to_string(argc - 4) + "\n";
+    EXPECT_STREQ(expected.c_str(), ReadAll(process, false).c_str());
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(0, exit_code);
+}
+
+TEST(ZygoteTest, TerminateAfterExit) {
+    ASSERT_TRUE(ZygoteStart());
+    ChildProcess process;
+    const char* argv[] = { "/bin/sh", "-c", "exit 3", nullptr };
+    ASSERT_TRUE(process.Spawn(argv));
+    // The monitor reaps the process. Its pid might be reused after that.
+    struct timespec hundred_ms = { 0, 100 * 1000000 };
+    nanosleep(&hundred_ms, nullptr);
+    process.Terminate();
+    EXPECT_FALSE(process.IsAlive());
+    int exit_code;
+    EXPECT_TRUE(process.Join(&exit_code));
+    EXPECT_EQ(3, exit_code);
+}
+#endif  // TUW_USE_ZYGOTE
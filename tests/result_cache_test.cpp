@@ -0,0 +1,72 @@
+// Tests for ResultCache
+
+#include "test_utils.h"
+#include "result_cache.h"
+
+constexpr char CACHE_FILE[] = "result_cache_test.json";
+
+TEST(ResultCacheTest, GetFileStamp) {
+    EXPECT_STREQ("", GetFileStamp("fake_file.txt").c_str());
+    noex::string stamp = GetFileStamp(JSON_ALL_KEYS);
+    // "<size>:<seconds>.<nanoseconds>"
+    const char* colon = noex::find_chr(stamp.c_str(), ':');
+    ASSERT_NE(nullptr, colon);
+    const char* dot = noex::find_chr(colon, '.');
+    ASSERT_NE(nullptr, dot);
+    EXPECT_EQ(9u, strlen(dot + 1));
+}
+
+TEST(ResultCacheTest, ArgsToCacheKey) {
+    noex::vector<noex::string> args1;
+    args1.push_back("echo");
+    args1.push_back("a b");
+    noex::vector<noex::string> args2;
+    args2.push_back("echo");
+    args2.push_back("a");
+    args2.push_back("b");
+    noex::vector<noex::string> args3;
+    args3.push_back("echo a");
+    args3.push_back("b");
+    EXPECT_STREQ("4:echo3:a b", ArgsToCacheKey(args1).c_str());
+    EXPECT_STRNE(ArgsToCacheKey(args1).c_str(), ArgsToCacheKey(args2).c_str());
+    EXPECT_STRNE(ArgsToCacheKey(args2).c_str(), ArgsToCacheKey(args3).c_str());
+}
+
+TEST(ResultCacheTest, PutAndGet) {
+    remove(CACHE_FILE);
+    ResultCache cache(CACHE_FILE);
+    ExecuteResult result = { 0, "", "" };
+    EXPECT_FALSE(cache.Get("cmd", &result));
+
+    ExecuteResult stored = { 3, "", "last line" };
+    EXPECT_STREQ("", cache.Put("cmd", stored).c_str());
+    EXPECT_TRUE(cache.Get("cmd", &result));
+    EXPECT_EQ(3, result.exit_code);
+    EXPECT_STREQ("last line", result.last_line.c_str());
+
+    // Load the saved cache
+    ResultCache cache2(CACHE_FILE);
+    result = { 0, "", "" };
+    EXPECT_TRUE(cache2.Get("cmd", &result));
+    EXPECT_EQ(3, result.exit_code);
+    EXPECT_STREQ("last line", result.last_line.c_str());
+    EXPECT_FALSE(cache2.Get("cmd2", &result));
+    remove(CACHE_FILE);
+}
+
+TEST(ResultCacheTest, Eviction) {
+    remove(CACHE_FILE);
+    ResultCache cache(CACHE_FILE);
+    noex::string line(static_cast<size_t>(1000));
+    memset(line.data(), 'a', 1000);
+    ExecuteResult stored = { 0, "", line };
+    for (int i = 0; i < 100; i++)
+        EXPECT_STREQ("", cache.Put("cmd" + noex::to_string(i), stored).c_str());
+
+    // Recently used entries should remain.
+    ExecuteResult result = { 0, "", "" };
+    EXPECT_TRUE(cache.Get("cmd99", &result));
+    EXPECT_TRUE(cache.Get("cmd80", &result));
+    EXPECT_FALSE(cache.Get("cmd0", &result));
+    remove(CACHE_FILE);
+}
@@ -71,3 +71,58 @@ TEST(RingStrBufferTest, PushBackNull) {
     EXPECT_FALSE(buf.IsFull());
     EXPECT_STREQ("", buf.ToString().c_str());
 }
+
+TEST(RingStrBufferTest, Clear) {
+    RingStrBuffer<10> buf;
+    buf.PushBack("0123456789test", 14);
+    buf.Clear();
+    EXPECT_TRUE(buf.IsEmpty());
+    EXPECT_FALSE(buf.IsFull());
+    buf.PushBack("test", 4);
+    EXPECT_STREQ("test", buf.ToString().c_str());
+}
+
+// Test LineSplitter
+static void PushStr(LineSplitter& splitter, const char* str) {
+    splitter.Push(str, strlen(str));
+}
+
+TEST(LineSplitterTest, GetLastLine) {
+    LineSplitter splitter;
+    EXPECT_STREQ("", splitter.GetLastLine().c_str());
+    PushStr(splitter, "first\nsec");
+    EXPECT_STREQ("sec", splitter.GetLastLine().c_str());
+    PushStr(splitter, "ond\r\n\r\n");
+    EXPECT_STREQ("second", splitter.GetLastLine().c_str());
+    PushStr(splitter, "\n\nlast");
+    EXPECT_STREQ("last", splitter.GetLastLine().c_str());
+}
+
+TEST(LineSplitterTest, GetLastLineLong) {
+    LineSplitter splitter;
+    noex::string line;
+    for (int i = 0; i < LAST_CHARS_MAX_LEN; i++)
+        line.push_back('a');
+    line += "bc\n";
+    PushStr(splitter, line.c_str());
+    noex::string actual = splitter.GetLastLine();
+    EXPECT_EQ(static_cast<size_t>(LAST_CHARS_MAX_LEN), actual.size());
+    EXPECT_STREQ("...", actual.substr(0, 3).c_str());
+    EXPECT_STREQ("abc", actual.substr(actual.size() - 3, 3).c_str());
+}
+
+TEST(LineSplitterTest, GetProgress) {
+    LineSplitter splitter;
+    splitter.SetProgressRegex("^Progress:");
+    EXPECT_EQ(-1, splitter.GetProgress());
+    PushStr(splitter, "Progress: 10%\nProgress: 2");
+    EXPECT_EQ(10, splitter.GetProgress());
+    PushStr(splitter, "5%\r");
+    EXPECT_EQ(25, splitter.GetProgress());
+    PushStr(splitter, "Other: 50%\n");
+    EXPECT_EQ(25, splitter.GetProgress());
+    PushStr(splitter, "Progress: 99% (100%, 3/3)\n");
+    EXPECT_EQ(99, splitter.GetProgress());
+    PushStr(splitter, "Progress: 12.5% done\n");
+    EXPECT_EQ(12, splitter.GetProgress());
+}
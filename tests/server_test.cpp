@@ -0,0 +1,197 @@
+// Tests for server.cpp
+
+#include "test_utils.h"
+#include "server.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+static const char* SOCKET_PATH = "server_test.sock";
+
+static const char* SERVER_JSON =
+    "{\"gui\": [{"
+    "\"label\": \"Exit with a code\","
+    "\"command\": \"echo code: %code% && exit %code%\","
+    "\"components\": [{\"type\": \"int\", \"id\": \"code\", \"label\": \"Exit code\"}]"
+    "}, {"
+    "\"label\": \"Sleep\","
+    "\"command\": \"echo $$ && exec sleep 10\","
+    "\"components\": []"
+    "}, {"
+    "\"label\": \"Colors\","
+    "\"command\": \"printf '\\\\033[31mred\\\\033[0m\\\\n'\","
+    "\"components\": []"
+    "}, {"
+    "\"label\": \"Null\","
+    "\"command\": \"printf 'a\\\\000b\\\\n'\","
+    "\"components\": []"
+    "}, {"
+    "\"label\": \"Multibyte characters\","
+    "\"command\": \"head -c 10000 /dev/zero | tr '\\\\000' x | sed 's/x/\xe2\x82\xac/g'\","
+    "\"components\": []"
+    "}]}";
+
+class ServerTest : public ::testing::Test {
+ protected:
+    pid_t m_pid;
+    tuwjson::Value m_definition;
+
+    void SetUp() override {
+        tuwjson::Parser parser;
+        parser.ParseJson(SERVER_JSON, &m_definition);
+        ASSERT_FALSE(parser.HasError());
+        noex::string err;
+        json_utils::CheckDefinition(err, m_definition);
+        ASSERT_STREQ("", err.c_str());
+
+        m_pid = fork();
+        ASSERT_LE(0, m_pid);
+        if (m_pid == 0) {
+            ExecuteDisableGui();
+            err = Serve(m_definition, SOCKET_PATH, 2);
+            _exit(err.empty() ? 0 : 1);
+        }
+    }
+
+    void TearDown() override {
+        kill(m_pid, SIGTERM);
+        int status;
+        waitpid(m_pid, &status, 0);
+        EXPECT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(0, WEXITSTATUS(status));
+        EXPECT_FALSE(envuFileExists(SOCKET_PATH));
+    }
+
+    // Connects to the server and sends a request.
+    int Connect(const char* request) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, SOCKET_PATH);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        // Wait for the server to listen.
+        for (int i = 0; i < 100; i++) {
+            if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0)
+                break;
+            usleep(10000);
+        }
+        EXPECT_EQ(static_cast<ssize_t>(strlen(request)), write(fd, request, strlen(request)));
+        return fd;
+    }
+
+    // Sends a request and returns the whole response.
+    noex::string Request(const char* request) {
+        int fd = Connect(request);
+        noex::string response;
+        char buf[1024];
+        ssize_t size;
+        while ((size = read(fd, buf, sizeof(buf))) > 0)
+            response += noex::string(buf, static_cast<size_t>(size));
+        close(fd);
+        return response;
+    }
+};
+
+TEST_F(ServerTest, Run) {
+    noex::string response = Request("{\"mode\": 0, \"values\": {\"code\": 3}}\n");
+    EXPECT_TRUE(response.starts_with("{\"stdout\": \"code: 3\\n\"}\n"));
+    EXPECT_NE(nullptr, strstr(response.c_str(), "{\"exit_code\": 3,"));
+}
+
+TEST_F(ServerTest, RunTwice) {
+    EXPECT_NE(nullptr, strstr(Request("{\"values\": {\"code\": \"1\"}}\n").c_str(),
+                              "{\"exit_code\": 1,"));
+    EXPECT_NE(nullptr, strstr(Request("{}\n").c_str(), "{\"exit_code\": 0,"));
+}
+
+TEST_F(ServerTest, RunFail) {
+    EXPECT_STREQ("{\"error\": \"Unknown component id. (unknown)\"}\n",
+                 Request("{\"values\": {\"unknown\": 1}}\n").c_str());
+    EXPECT_STREQ("{\"error\": \"Invalid definition index. (5)\"}\n",
+                 Request("{\"mode\": 5}\n").c_str());
+    EXPECT_STREQ("{\"error\": \"Request should be a JSON object.\"}\n",
+                 Request("[]\n").c_str());
+}
+
+TEST_F(ServerTest, ClientClosedWhileRunning) {
+    int fd = Connect("{\"mode\": 1}\n");
+    // {"stdout": "<pid>\n"}
+    noex::string response;
+    char buf[256];
+    ssize_t size;
+    while (!strchr(response.c_str(), '}') && (size = read(fd, buf, sizeof(buf))) > 0)
+        response += noex::string(buf, static_cast<size_t>(size));
+    const char* pid_str = strstr(response.c_str(), "\"stdout\": \"");
+    ASSERT_NE(nullptr, pid_str);
+    pid_t pid = static_cast<pid_t>(atoi(pid_str + 11));
+    ASSERT_LT(0, pid);
+    close(fd);
+
+    // The server should kill the command.
+    for (int i = 0; i < 200 && kill(pid, 0) == 0; i++)
+        usleep(10000);
+    EXPECT_NE(0, kill(pid, 0));
+    // The server still works.
+    EXPECT_NE(nullptr, strstr(Request("{}\n").c_str(), "{\"exit_code\": 0,"));
+}
+
+TEST_F(ServerTest, ControlChars) {
+    noex::string response = Request("{\"mode\": 2}\n");
+    EXPECT_TRUE(response.starts_with(
+        "{\"stdout\": \"\\u001b[31mred\\u001b[0m\\n\"}\n")) << response.c_str();
+    response = Request("{\"mode\": 3}\n");
+    EXPECT_TRUE(response.starts_with("{\"stdout\": \"a\\u0000b\\n\"}\n")) << response.c_str();
+}
+
+// Returns true when the string has only complete UTF-8 characters.
+static bool IsValidUtf8(const char* str, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        size_t len = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 :
+                     (c & 0xF8) == 0xF0 ? 4 : 0;
+        if (len == 0 || size - i < len)
+            return false;
+        for (size_t j = 1; j < len; j++) {
+            if ((static_cast<unsigned char>(str[i + j]) & 0xC0) != 0x80)
+                return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+TEST_F(ServerTest, SplitMultibyteChars) {
+    // 3-byte characters are split by 4KB chunks.
+    noex::string response = Request("{\"mode\": 4}\n");
+    const char* line = response.c_str();
+    const char* end = line + response.size();
+    int lines = 0;
+    int chars = 0;
+    while (line < end) {
+        const char* lf = strchr(line, '\n');
+        ASSERT_NE(nullptr, lf);
+        EXPECT_TRUE(IsValidUtf8(line, static_cast<size_t>(lf - line)));
+        for (const char* p = line; (p = strstr(p, "\xe2\x82\xac")) && p < lf; p += 3)
+            chars++;
+        lines++;
+        line = lf + 1;
+    }
+    EXPECT_LT(2, lines);
+    EXPECT_EQ(10000, chars);
+    EXPECT_NE(nullptr, strstr(response.c_str(), "{\"exit_code\": 0,"));
+}
+
+TEST_F(ServerTest, AlreadyRunning) {
+    // Wait for the server to listen.
+    Request("{}\n");
+    EXPECT_STREQ("Another server is running. (server_test.sock)",
+                 Serve(m_definition, SOCKET_PATH, 1).c_str());
+}
+
+#endif  // _WIN32
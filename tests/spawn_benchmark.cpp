@@ -0,0 +1,96 @@
+// Measures spawn latency as the RSS of the parent process grows.
+// It compares ChildProcess (posix_spawn) with fork() + execvp().
+// ChildProcess uses the zygote instead when TUW_USE_ZYGOTE is defined.
+// Usage: spawn_benchmark [max_rss_mb] [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "process.h"
+#include "zygote.h"
+
+static const char* ARGV[] = { "true", nullptr };
+
+static double SpawnWithChildProcess() {
+    auto start = std::chrono::steady_clock::now();
+    ChildProcess process;
+    if (!process.Spawn(ARGV)) {
+        fprintf(stderr, "Failed to spawn a process.\n");
+        exit(1);
+    }
+    int exit_code;
+    process.Join(&exit_code);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+static double SpawnWithFork() {
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(ARGV[0], const_cast<char* const*>(ARGV));
+        _exit(127);
+    }
+    if (pid < 0) {
+        fprintf(stderr, "Failed to fork.\n");
+        exit(1);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+static double Average(double (*func)(), int iterations) {
+    double total = 0;
+    for (int i = 0; i < iterations; i++)
+        total += func();
+    return total / iterations;
+}
+
+int main(int argc, char* argv[]) {
+#ifdef TUW_USE_ZYGOTE
+    if (!ZygoteStart()) {
+        fprintf(stderr, "Failed to start the zygote.\n");
+        return 1;
+    }
+    const char* spawn_label = "zygote (us)";
+#else
+    const char* spawn_label = "posix_spawn (us)";
+#endif
+    size_t max_rss_mb = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1024;
+    int iterations = argc > 2 ? atoi(argv[2]) : 50;
+    if (iterations <= 0)
+        iterations = 1;
+
+    const size_t MB = 1024 * 1024;
+    std::vector<char*> blocks;
+    size_t rss_mb = 0;
+
+    printf("%10s %18s %18s\n", "RSS (MB)", spawn_label, "fork+exec (us)");
+    while (true) {
+        printf("%10zu %18.1f %18.1f\n", rss_mb,
+               Average(SpawnWithChildProcess, iterations),
+               Average(SpawnWithFork, iterations));
+        fflush(stdout);
+        if (rss_mb >= max_rss_mb)
+            break;
+
+        // Double the RSS. Touch every page so that they are mapped.
+        size_t grow_mb = rss_mb == 0 ? 64 : rss_mb;
+        char* block = static_cast<char*>(malloc(grow_mb * MB));
+        if (!block)
+            break;
+        memset(block, 1, grow_mb * MB);
+        blocks.push_back(block);
+        rss_mb += grow_mb;
+    }
+
+    for (char* block : blocks)
+        free(block);
+    return 0;
+}
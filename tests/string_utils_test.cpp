@@ -52,3 +52,25 @@ TEST(StringTest, ANSItoUTF8Null) {
     expect_nullstr(ANSItoUTF8(nullstr));
 }
 #endif
+
+TEST(StringTest, XxHash64) {
+    EXPECT_EQ(0xEF46DB3751D8E999ULL, XxHash64::Hash("", 0));
+    EXPECT_EQ(0xD24EC4F1A98C6E5BULL, XxHash64::Hash("a", 1));
+    EXPECT_EQ(0x44BC2CF5AD770999ULL, XxHash64::Hash("abc", 3));
+    const char* str = "Nobody inspects the spammish repetition";
+    EXPECT_EQ(0xFBCEA83C8A378BF1ULL, XxHash64::Hash(str, strlen(str)));
+}
+
+TEST(StringTest, XxHash64Chunks) {
+    unsigned char data[100];
+    for (int i = 0; i < 100; i++)
+        data[i] = static_cast<unsigned char>(i);
+    EXPECT_EQ(0x6AC1E58032166597ULL, XxHash64::Hash(data, 100));
+    // Hashing in chunks should give the same result.
+    for (size_t chunk = 1; chunk < 40; chunk++) {
+        XxHash64 hash;
+        for (size_t i = 0; i < 100; i += chunk)
+            hash.Update(data + i, i + chunk < 100 ? chunk : 100 - i);
+        EXPECT_EQ(0x6AC1E58032166597ULL, hash.Digest());
+    }
+}
@@ -0,0 +1,64 @@
+// Tests for thread_pool.cpp
+
+#include "test_utils.h"
+#include "thread_pool.h"
+
+static void CountTask(size_t id, void* data) {
+    // Each task writes only its own element.
+    static_cast<int*>(data)[id] += static_cast<int>(id) + 1;
+}
+
+TEST(ThreadPoolTest, RunTasks) {
+    int counts[100] = {};
+    RunTasks(CountTask, 100, 4, counts);
+    for (int i = 0; i < 100; i++)
+        EXPECT_EQ(i + 1, counts[i]);
+}
+
+TEST(ThreadPoolTest, RunTasksOnCallingThread) {
+    int counts[3] = {};
+    RunTasks(CountTask, 3, 1, counts);
+    EXPECT_EQ(1, counts[0]);
+    EXPECT_EQ(3, counts[2]);
+    // More threads than tasks
+    RunTasks(CountTask, 3, 16, counts);
+    EXPECT_EQ(2, counts[0]);
+    EXPECT_EQ(6, counts[2]);
+    RunTasks(CountTask, 0, 4, counts);
+}
+
+struct MergeTaskData {
+    const ExeContainer* base;
+    noex::string errors[4];
+};
+
+static void WriteExeTask(size_t id, void* data) {
+    MergeTaskData* task = static_cast<MergeTaskData*>(data);
+    ExeContainer exe;
+    exe.CopyFrom(*task->base);
+    tuwjson::Value json;
+    GetTestJson(json);
+    exe.SetJson(json);
+    noex::string path = "thread_pool_" + noex::to_string(id) + ".bin";
+    task->errors[id] = exe.Write(path);
+}
+
+TEST(ThreadPoolTest, WriteExecutables) {
+    ExeContainer base;
+    ASSERT_STREQ("", base.Read(JSON_ALL_KEYS).c_str());
+    MergeTaskData data;
+    data.base = &base;
+    RunTasks(WriteExeTask, 4, 4, &data);
+    tuwjson::Value test_json;
+    GetTestJson(test_json);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_STREQ("", data.errors[i].c_str());
+        ExeContainer exe;
+        noex::string path = "thread_pool_" + noex::to_string(i) + ".bin";
+        EXPECT_STREQ("", exe.Read(path).c_str());
+        EXPECT_TRUE(exe.HasSameExe(base));
+        tuwjson::Value embedded_json;
+        exe.GetJson(embedded_json);
+        EXPECT_EQ(embedded_json, test_json);
+    }
+}
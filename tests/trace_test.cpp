@@ -0,0 +1,68 @@
+// Tests for trace.cpp
+
+#include <cstdio>
+#include "test_utils.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+#ifndef TUW_NO_TRACE
+static void TraceTask(size_t id, void* data) {
+    TUW_TRACE_SCOPE("TraceTask");
+}
+
+static const tuwjson::Value* FindEvent(const tuwjson::Value& events, const char* name) {
+    for (const tuwjson::Value& event : events) {
+        if (strcmp(event["name"].GetString(), name) == 0)
+            return &event;
+    }
+    return nullptr;
+}
+
+TEST(TraceTest, WriteChromeTrace) {
+    const char* path = "trace_test.json";
+    EXPECT_STREQ("", TraceStart(path).c_str());
+    EXPECT_TRUE(TraceEnabled());
+    {
+        TUW_TRACE_SCOPE("Outer");
+        TUW_TRACE_SCOPE("Inner");
+    }
+    RunTasks(TraceTask, 8, 4, nullptr);
+    EXPECT_STREQ("", TraceStop().c_str());
+    EXPECT_FALSE(TraceEnabled());
+    {
+        TUW_TRACE_SCOPE("Disabled");
+    }
+
+    tuwjson::Value json;
+    EXPECT_STREQ("", json_utils::LoadJson(path, json).c_str());
+    const tuwjson::Value& events = json["traceEvents"];
+    ASSERT_TRUE(events.IsArray());
+    EXPECT_EQ(10u, events.GetArraySize());
+
+    int task_count = 0;
+    for (const tuwjson::Value& event : events) {
+        EXPECT_STREQ("X", event["ph"].GetString());
+        EXPECT_TRUE(event["tid"].IsInt());
+        if (strcmp(event["name"].GetString(), "TraceTask") == 0)
+            task_count++;
+    }
+    EXPECT_EQ(8, task_count);
+    EXPECT_EQ(nullptr, FindEvent(events, "Disabled"));
+
+    const tuwjson::Value* outer = FindEvent(events, "Outer");
+    const tuwjson::Value* inner = FindEvent(events, "Inner");
+    ASSERT_NE(nullptr, outer);
+    ASSERT_NE(nullptr, inner);
+    EXPECT_EQ((*outer)["tid"].GetInt(), (*inner)["tid"].GetInt());
+    EXPECT_LE((*outer)["ts"].GetDouble(), (*inner)["ts"].GetDouble());
+    EXPECT_GE((*outer)["dur"].GetDouble(), (*inner)["dur"].GetDouble());
+    remove(path);
+}
+
+TEST(TraceTest, StartWithInvalidPath) {
+    noex::string err = TraceStart("not_exist_dir/trace.json");
+    EXPECT_FALSE(err.empty());
+    EXPECT_FALSE(TraceEnabled());
+    EXPECT_STREQ("", TraceStop().c_str());
+}
+#endif  // TUW_NO_TRACE
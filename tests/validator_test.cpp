@@ -3,12 +3,16 @@
 
 #include "test_utils.h"
 
+// Validator refers to strings in the JSON. So, we keep the last config alive.
+static tuwjson::Value g_validator_config;
+
 Validator GetValidator(const char* config_str) {
     tuwjson::Value config;
     tuwjson::Parser parser;
     parser.ParseJson(config_str, &config);
+    g_validator_config.MoveFrom(config);
     Validator validator;
-    validator.Initialize(config);
+    validator.Initialize(g_validator_config);
     return validator;
 }
 